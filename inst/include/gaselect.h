@@ -0,0 +1,33 @@
+//
+//  gaselect.h
+//  gaselect
+//
+//  Interface for compiled fitness functions (see ?evaluatorUserFunction).
+//
+
+#ifndef gaselect_gaselect_h
+#define gaselect_gaselect_h
+
+#include <stdint.h>
+
+/**
+ * Fitness function compiled to native code.
+ *
+ * The function is called directly from the worker threads of the genetic algorithm, possibly
+ * from several threads at the same time. It must therefore be thread-safe and must neither call
+ * into R nor allocate R objects (this includes Rcpp vectors and printing with Rcpp::Rcout).
+ *
+ * @param X The covariates in column-major order (nrow x ncol)
+ * @param y The response (nrow values)
+ * @param nrow The number of observations
+ * @param ncol The number of variables
+ * @param columns The 0-based indices of the selected variables (numColumns values)
+ * @param numColumns The number of selected variables
+ * @param state The user state given to evaluatorUserFunction() (NULL if none was given)
+ * @return The fitness of the variable subset (the higher the fitter) or NaN if the subset can
+ *		not be evaluated
+ */
+typedef double (*gaselect_fitness_fun)(const double *X, const double *y, uint32_t nrow, uint32_t ncol,
+									   const uint32_t *columns, uint32_t numColumns, void *state);
+
+#endif
@@ -12,6 +12,7 @@
 #include "Logger.h"
 #include "BICEvaluator.h"
 #include "OnlineStddev.h"
+#include "SimdKernels.h"
 
 #ifdef ENABLE_DEBUG_VERBOSITY
 #define IF_DEBUG(expr) if(this->verbosity == DEBUG_EVAL || this->verbosity == DEBUG_ALL) { expr; }
@@ -21,9 +22,10 @@
 
 BICEvaluator::BICEvaluator(std::unique_ptr<PLS> _pls, uint16_t _maxNComp, const std::vector<uint32_t> &seed,
                            VerbosityLevel _verbosity, uint16_t _numSegments, BICEvaluator::Statistic _stat,
-                           double _sdfact) :
+                           double _sdfact, uint16_t earlyStop) :
 		Evaluator(_verbosity), numSegments(_numSegments),	nrows(_pls->getNumberOfObservations()),
-		sdfact(_sdfact / sqrt((double) _numSegments)), stat(_stat), pls(std::move(_pls)), maxNComp(_maxNComp)
+		sdfact(_sdfact / sqrt((double) _numSegments)), stat(_stat), pls(std::move(_pls)), maxNComp(_maxNComp),
+		componentwiseCV(earlyStop)
 {
 	if(pls->getNumberOfResponseVariables() > 1) {
 		throw std::invalid_argument("PLS evaluator only available for models with 1 response variable");
@@ -40,24 +42,49 @@ BICEvaluator::BICEvaluator(std::unique_ptr<PLS> _pls, uint16_t _maxNComp, const
 		this->maxNComp = this->nrows - 1;
 	}
 
-	this->initSegmentation(seed);
+	this->initSegmentation(this->nrows, seed);
 }
 
 BICEvaluator::BICEvaluator(const BICEvaluator &other) :
 	Evaluator(other.verbosity), numSegments(other.numSegments), nrows(other.nrows),
 	sdfact(other.sdfact), stat(other.stat),
-	maxNComp(other.maxNComp), segmentation(other.segmentation), r2denom(other.r2denom)
+	maxNComp(other.maxNComp), segmentation(other.segmentation), rowWeights(other.rowWeights), r2denom(other.r2denom),
+	componentwiseCV(other.componentwiseCV)
 {
 	this->pls = other.pls->clone();
 }
 
+BICEvaluator::BICEvaluator(const BICEvaluator &other, const arma::vec &y) :
+	Evaluator(other.verbosity), numSegments(other.numSegments), nrows(other.nrows),
+	sdfact(other.sdfact), stat(other.stat),
+	maxNComp(other.maxNComp), segmentation(other.segmentation), rowWeights(other.rowWeights),
+	componentwiseCV(other.componentwiseCV)
+{
+	this->pls = other.pls->cloneWithResponse(y);
+	this->r2denom = this->nrows * arma::var(y, 1); // N * Var(Y)
+}
+
+BICEvaluator::BICEvaluator(const BICEvaluator &other, const RowWeights &rowWeights, const std::vector<uint32_t> &seed) :
+	Evaluator(other.verbosity), numSegments(other.numSegments), nrows(rowWeights.getRows().n_elem),
+	sdfact(other.sdfact), stat(other.stat), maxNComp(other.maxNComp),
+	componentwiseCV(other.componentwiseCV)
+{
+	this->pls = other.pls->cloneWithRows(rowWeights.getRows());
+	this->r2denom = this->nrows * arma::var(this->pls->getY(), 1); // N * Var(Y)
+	this->rowWeights.reset(new RowWeights(rowWeights));
+
+	this->reseedSegmentation(seed);
+}
+
 double BICEvaluator::evaluate(arma::uvec &columnSubset) {
 	if(columnSubset.n_elem == 0) {
 		GAerr << GAerr.lock() << "Can not evaluate empty variable subset" << GAerr.unlock();
 		throw Evaluator::EvaluatorException("Can not evaluate empty variable subset");
 	}
 
+	this->beginPhases();
 	this->pls->viewSelectColumns(columnSubset);
+	this->endPhase(HardwareCounters::PHASE_GATHER);
 
 	double ret = 0.0;
 	double RSS = this->getRSS(((this->maxNComp < columnSubset.n_elem) ? this->maxNComp : columnSubset.n_elem));
@@ -93,18 +120,18 @@ double BICEvaluator::evaluate(arma::uvec &columnSubset) {
 /**
  * Initialize the row-segmentation for each replication and all segmentations
  */
-inline void BICEvaluator::initSegmentation(const std::vector<uint32_t> &seed) {
+inline void BICEvaluator::initSegmentation(arma::uword numRows, const std::vector<uint32_t> &seed) {
 	RNG rng(seed);
-	arma::uvec shuffledRowNumbers = ShuffledSet(this->nrows).shuffleAll(rng);
-	arma::uword segmentLength = this->nrows / this->numSegments;
-	arma::uword segmentLengthRem = this->nrows % this->numSegments;
+	arma::uvec shuffledRowNumbers = ShuffledSet(numRows).shuffleAll(rng);
+	arma::uword segmentLength = numRows / this->numSegments;
+	arma::uword segmentLengthRem = numRows % this->numSegments;
 	arma::uword segLen = 0, n = 0;
 
 
 	this->segmentation.reserve(2 * this->numSegments);
 
-	if((this->nrows - segmentLength - 2) < this->maxNComp) {
-		this->maxNComp = this->nrows - segmentLength - 2;
+	if((numRows - segmentLength - 2) < this->maxNComp) {
+		this->maxNComp = numRows - segmentLength - 2;
 	}
 
 	IF_DEBUG(GAout << "Initialize segments with a segment length of " << segmentLength << std::endl);
@@ -115,14 +142,14 @@ inline void BICEvaluator::initSegmentation(const std::vector<uint32_t> &seed) {
 			++segLen;
 		}
 
-		arma::uvec inSegment(this->nrows - segLen);
+		arma::uvec inSegment(numRows - segLen);
 
 		if(n > 0) {
 			inSegment.rows(0, n - 1) = shuffledRowNumbers.rows(0, n - 1);
 		}
 
-		if(n < this->nrows - segLen) {
-			inSegment.rows(n, inSegment.n_elem - 1) = shuffledRowNumbers.rows(n + segLen, this->nrows - 1);
+		if(n < numRows - segLen) {
+			inSegment.rows(n, inSegment.n_elem - 1) = shuffledRowNumbers.rows(n + segLen, numRows - 1);
 		}
 
 		std::sort(inSegment.begin(), inSegment.end());
@@ -147,34 +174,48 @@ double BICEvaluator::getRSS(uint16_t maxNComp) {
 
 	double cutoff;
 	arma::uword minNComp = 0, optNComp = 0;
+	uint16_t cvNComp = maxNComp;
 
 	arma::mat leftOutX;
 	arma::vec leftOutY;
+	arma::vec fitted;
 
 	uint16_t seg = 0, comp;
 	std::vector<arma::uvec>::const_iterator segmentIter = this->segmentation.begin();
 
 	try {
-		/*
-		 * Fit PLS models to predict the values in each segment once
-		 */
-		while(seg++ < this->numSegments) {
-			/* Segmentation iterator currently points to the `fit` segment */
-			this->pls->viewSelectRows(*(segmentIter));
-			this->pls->fit(maxNComp);
-
-			/* Increment segmentation iterator to point to the `predict` segment */
-			++segmentIter;
-
-			leftOutY = this->pls->getY().rows(*segmentIter);
-			leftOutX = this->pls->getXColumnView().rows(*segmentIter);
-
-			for(comp = 0; comp < maxNComp; ++comp) {
-				trainMSEP.update(arma::mean(arma::square(leftOutY - this->pls->predict(leftOutX, comp + 1))), comp);
+		if(this->componentwiseCV.isEnabled()) {
+			/*
+			 * Add components to the models for all segments until the CV error increases
+			 */
+			cvNComp = this->componentwiseCV.run(*this->pls, segmentIter, this->numSegments, maxNComp, trainMSEP);
+			/* The predictions are interleaved with the fits */
+			this->endPhase(HardwareCounters::PHASE_FIT);
+		} else {
+			/*
+			 * Fit PLS models to predict the values in each segment once
+			 */
+			while(seg++ < this->numSegments) {
+				/* Segmentation iterator currently points to the `fit` segment */
+				this->pls->viewSelectRows(*(segmentIter));
+				this->pls->fit(maxNComp);
+				this->endPhase(HardwareCounters::PHASE_FIT);
+
+				/* Increment segmentation iterator to point to the `predict` segment */
+				++segmentIter;
+
+				leftOutY = this->pls->getY().rows(*segmentIter);
+				leftOutX = this->pls->getXColumnView().rows(*segmentIter);
+
+				for(comp = 0; comp < maxNComp; ++comp) {
+					fitted = this->pls->predict(leftOutX, comp + 1);
+					trainMSEP.update(SimdKernels::sumSquaredDiff(leftOutY.memptr(), fitted.memptr(), fitted.n_elem) / fitted.n_elem, comp);
+				}
+				this->endPhase(HardwareCounters::PHASE_PREDICT);
+
+				/* Increment segmentation iterator to point to the next `fit` segment */
+				++segmentIter;
 			}
-
-			/* Increment segmentation iterator to point to the next `fit` segment */
-			++segmentIter;
 		}
 
 		/*
@@ -182,7 +223,7 @@ double BICEvaluator::getRSS(uint16_t maxNComp) {
 		 */
 		IF_DEBUG(
 			GAout << "EVALUATOR: MSE and SD" << std::endl;
-			for(uint16_t j = 0; j < maxNComp; ++j) {
+			for(uint16_t j = 0; j < cvNComp; ++j) {
 				GAout << "\t (" << j + 1 << " comps.): " << trainMSEP.mean(j) << " +- " << trainMSEP.stddev(j) << std::endl;
 			}
 		)
@@ -190,7 +231,7 @@ double BICEvaluator::getRSS(uint16_t maxNComp) {
 		cutoff = trainMSEP.mean(0);
 		minNComp = 0;
 
-		for(comp = 1; comp < maxNComp; ++comp) {
+		for(comp = 1; comp < cvNComp; ++comp) {
 			if(trainMSEP.mean(comp) < cutoff) {
 				minNComp = comp;
 				cutoff = trainMSEP.mean(comp);
@@ -222,8 +263,11 @@ double BICEvaluator::getRSS(uint16_t maxNComp) {
 		 */
 		this->pls->viewSelectAllRows();
 		this->pls->fit(optNComp);
+		this->endPhase(HardwareCounters::PHASE_FIT);
 
-		RSS = arma::accu(arma::square(this->pls->getY() - this->pls->predict(this->pls->getXColumnView(), optNComp)));
+		fitted = this->pls->predict(this->pls->getXColumnView(), optNComp);
+		RSS = SimdKernels::sumSquaredDiff(this->pls->getY().memptr(), fitted.memptr(), fitted.n_elem);
+		this->endPhase(HardwareCounters::PHASE_PREDICT);
 	} catch(const ::std::underflow_error& ue) {
 		IF_DEBUG(GAout << GAout.lock() << ue.what() << "\n" << GAout.unlock())
 		throw Evaluator::EvaluatorException("Can not evaluate variable subset due to an underflow.");
@@ -232,9 +276,34 @@ double BICEvaluator::getRSS(uint16_t maxNComp) {
 	return RSS;
 }
 
+void BICEvaluator::reseedSegmentation(const std::vector<uint32_t> &seed) {
+	this->segmentation.clear();
+
+	if(this->rowWeights) {
+		this->initSegmentation(this->rowWeights->getNumDistinct(), seed);
+		this->rowWeights->expandSegmentation(this->segmentation);
+	} else {
+		this->initSegmentation(this->nrows, seed);
+	}
+}
+
 Evaluator* BICEvaluator::clone() const {
 	return new BICEvaluator(*this);
 }
 
+Evaluator* BICEvaluator::cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const {
+	if(rowWeights.n_elem != this->nrows) {
+		throw std::invalid_argument("There must be one weight for every observation");
+	}
+	return new BICEvaluator(*this, RowWeights(rowWeights), seed);
+}
+
+Evaluator* BICEvaluator::cloneWithResponse(const arma::vec &y) const {
+	if(y.n_elem != this->nrows) {
+		throw std::invalid_argument("The response must have the same number of observations as the original response");
+	}
+	return new BICEvaluator(*this, y);
+}
+
 
 
@@ -20,6 +20,8 @@
 #include "Evaluator.h"
 #include "Chromosome.h"
 #include "PLS.h"
+#include "ComponentwiseCV.h"
+#include "RowWeights.h"
 
 class BICEvaluator : public Evaluator {
 public:
@@ -31,7 +33,7 @@ public:
 	};
 
 	BICEvaluator(std::unique_ptr<PLS> pls, uint16_t maxNComp, const std::vector<uint32_t> &seed, VerbosityLevel verbosity,
-		uint16_t numSegments = 7, Statistic stat = BIC, double sdfact = 1.0);
+		uint16_t numSegments = 7, Statistic stat = BIC, double sdfact = 1.0, uint16_t earlyStop = 0);
 
 	~BICEvaluator() {};
 
@@ -49,6 +51,10 @@ public:
 	double evaluate(arma::uvec &columnSubset);
 
 	Evaluator* clone() const;
+	Evaluator* cloneWithResponse(const arma::vec &y) const;
+	Evaluator* cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const;
+
+	void reseedSegmentation(const std::vector<uint32_t> &seed);
 
 private:
 	const uint16_t numSegments;
@@ -59,16 +65,24 @@ private:
 	std::unique_ptr<PLS> pls;
 	uint16_t maxNComp;
 	std::vector<arma::uvec> segmentation;
+	/* The weights of the observations (NULL if every observation is used once) */
+	std::shared_ptr<const RowWeights> rowWeights;
 	double r2denom;
+	ComponentwiseCV componentwiseCV;
 
 	BICEvaluator(const BICEvaluator &other);
+	BICEvaluator(const BICEvaluator &other, const arma::vec &y);
+	BICEvaluator(const BICEvaluator &other, const RowWeights &rowWeights, const std::vector<uint32_t> &seed);
 
 	/**
 	 * Estimate the SEP
 	 */
 	double getRSS(uint16_t maxNComp);
 
-	void initSegmentation(const std::vector<uint32_t> &seed);
+	/**
+	 * Initialize the segmentation for the rows 0, ..., numRows - 1
+	 */
+	void initSegmentation(arma::uword numRows, const std::vector<uint32_t> &seed);
 };
 
 #endif
@@ -0,0 +1,165 @@
+//
+//  CascadeEvaluator.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <RcppArmadillo.h>
+
+#include "CascadeEvaluator.h"
+
+CascadeEvaluator::StageCounters::StageCounters(size_t numStages) :
+	evaluated(new std::atomic<uint64_t>[numStages]), passed(new std::atomic<uint64_t>[numStages])
+{
+	for(size_t i = 0; i < numStages; ++i) {
+		this->evaluated[i] = 0;
+		this->passed[i] = 0;
+	}
+}
+
+CascadeEvaluator::CascadeEvaluator(std::vector<std::unique_ptr<Evaluator> > &stages, const std::vector<double> &thresholds,
+								   uint16_t referenceSize, VerbosityLevel verbosity) :
+	Evaluator(verbosity), stages(std::move(stages)), thresholds(thresholds), referenceSize(referenceSize),
+	counters(new StageCounters(this->stages.size())), worstFitness(std::numeric_limits<double>::infinity())
+{
+	if(this->stages.size() < 2) {
+		throw std::invalid_argument("The cascade must have at least two stages");
+	}
+
+	if(this->thresholds.size() != this->stages.size() - 1) {
+		throw std::invalid_argument("Every stage but the last must have an acceptance threshold");
+	}
+
+	if(this->referenceSize < 1) {
+		throw std::invalid_argument("The stage fitness must be compared to at least one subset");
+	}
+}
+
+CascadeEvaluator::CascadeEvaluator(const CascadeEvaluator &other, std::vector<std::unique_ptr<Evaluator> > &stages, bool shareCounters) :
+	Evaluator(other.verbosity), stages(std::move(stages)), thresholds(other.thresholds), referenceSize(other.referenceSize),
+	counters(shareCounters ? other.counters : std::shared_ptr<StageCounters>(new StageCounters(this->stages.size()))),
+	worstFitness(std::numeric_limits<double>::infinity())
+{
+	if(shareCounters) {
+		this->reference = other.reference;
+		this->worstFitness = other.worstFitness;
+	}
+}
+
+double CascadeEvaluator::evaluate(arma::uvec &columnSubset) {
+	const size_t last = this->stages.size() - 1;
+	const bool screen = (this->reference.size() >= this->referenceSize);
+	std::vector<double> stageFitness(last);
+
+	for(size_t s = 0; s < last; ++s) {
+		/* evaluate() may change the subset */
+		arma::uvec stageSubset(columnSubset);
+
+		++this->counters->evaluated[s];
+		stageFitness[s] = this->stages[s]->evaluate(stageSubset);
+
+		if(screen && stageFitness[s] < this->getCutoff(s)) {
+			return this->worstFitness;
+		}
+		++this->counters->passed[s];
+	}
+
+	++this->counters->evaluated[last];
+	double fitness = this->stages[last]->evaluate(columnSubset);
+	++this->counters->passed[last];
+
+	this->updateReference(fitness, stageFitness);
+
+	return fitness;
+}
+
+double CascadeEvaluator::getCutoff(size_t stage) const {
+	double ref = std::numeric_limits<double>::infinity();
+
+	for(std::multimap<double, std::vector<double> >::const_iterator it = this->reference.begin(); it != this->reference.end(); ++it) {
+		if(it->second[stage] < ref) {
+			ref = it->second[stage];
+		}
+	}
+
+	return ref - this->thresholds[stage] * fabs(ref);
+}
+
+void CascadeEvaluator::updateReference(double fitness, const std::vector<double> &stageFitness) {
+	if(fitness < this->worstFitness) {
+		this->worstFitness = fitness;
+	}
+
+	if(this->reference.size() < this->referenceSize) {
+		this->reference.insert(std::make_pair(fitness, stageFitness));
+	} else if(fitness > this->reference.begin()->first) {
+		this->reference.erase(this->reference.begin());
+		this->reference.insert(std::make_pair(fitness, stageFitness));
+	}
+}
+
+Evaluator* CascadeEvaluator::clone() const {
+	std::vector<std::unique_ptr<Evaluator> > stageClones;
+
+	for(std::vector<std::unique_ptr<Evaluator> >::const_iterator it = this->stages.begin(); it != this->stages.end(); ++it) {
+		stageClones.push_back(std::unique_ptr<Evaluator>((*it)->clone()));
+	}
+
+	return new CascadeEvaluator(*this, stageClones, true);
+}
+
+Evaluator* CascadeEvaluator::cloneIndependent() const {
+	std::vector<std::unique_ptr<Evaluator> > stageClones;
+
+	for(std::vector<std::unique_ptr<Evaluator> >::const_iterator it = this->stages.begin(); it != this->stages.end(); ++it) {
+		stageClones.push_back(std::unique_ptr<Evaluator>((*it)->cloneIndependent()));
+	}
+
+	return new CascadeEvaluator(*this, stageClones, false);
+}
+
+Evaluator* CascadeEvaluator::cloneWithResponse(const arma::vec &y) const {
+	std::vector<std::unique_ptr<Evaluator> > stageClones;
+
+	for(std::vector<std::unique_ptr<Evaluator> >::const_iterator it = this->stages.begin(); it != this->stages.end(); ++it) {
+		stageClones.push_back(std::unique_ptr<Evaluator>((*it)->cloneWithResponse(y)));
+	}
+
+	return new CascadeEvaluator(*this, stageClones, false);
+}
+
+Evaluator* CascadeEvaluator::cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const {
+	std::vector<std::unique_ptr<Evaluator> > stageClones;
+
+	for(std::vector<std::unique_ptr<Evaluator> >::const_iterator it = this->stages.begin(); it != this->stages.end(); ++it) {
+		stageClones.push_back(std::unique_ptr<Evaluator>((*it)->cloneWithRowWeights(rowWeights, seed)));
+	}
+
+	return new CascadeEvaluator(*this, stageClones, false);
+}
+
+void CascadeEvaluator::reseedSegmentation(const std::vector<uint32_t> &seed) {
+	this->stages.back()->reseedSegmentation(seed);
+}
+
+void CascadeEvaluator::addCacheStatistics(CacheStatistics &stats) const {
+	for(std::vector<std::unique_ptr<Evaluator> >::const_iterator it = this->stages.begin(); it != this->stages.end(); ++it) {
+		(*it)->addCacheStatistics(stats);
+	}
+}
+
+std::vector<CascadeEvaluator::StageStatistics> CascadeEvaluator::getStageStatistics() const {
+	std::vector<StageStatistics> stats(this->stages.size());
+
+	for(size_t s = 0; s < this->stages.size(); ++s) {
+		stats[s].evaluated = this->counters->evaluated[s].load();
+		stats[s].passed = this->counters->passed[s].load();
+	}
+
+	return stats;
+}
@@ -0,0 +1,113 @@
+//
+//  CascadeEvaluator.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_CascadeEvaluator_h
+#define gaselect_CascadeEvaluator_h
+
+#include "config.h"
+
+#include <map>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <RcppArmadillo.h>
+
+#include "Evaluator.h"
+#include "Chromosome.h"
+
+/**
+ * Chain of evaluators from the cheapest to the most expensive one.
+ *
+ * A variable subset is only passed on to the next stage if its fitness in the current stage is
+ * not much worse than the fitness the best subsets had in this stage. The best subsets are the
+ * `referenceSize` subsets with the highest final fitness evaluated so far, and a subset passes
+ * stage s if its fitness f_s is at least ref_s - threshold_s * |ref_s|, where ref_s is the
+ * lowest stage fitness of the best subsets (the same rule as the `badSolutionThreshold` for the
+ * parents). Until enough subsets have passed all stages, no subset is rejected.
+ *
+ * The fitness of a subset always comes from the last stage. Rejected subsets get the worst final
+ * fitness seen so far, so they never enter the elite and are usually discarded during mating.
+ *
+ * Every thread uses its own clone with its own best subsets, but all clones count the number of
+ * subsets entering and passing every stage together.
+ */
+class CascadeEvaluator : public Evaluator {
+public:
+	struct StageStatistics {
+		uint64_t evaluated;		// Subsets evaluated by the stage
+		uint64_t passed;		// Subsets passed on to the next stage (successfully evaluated in the last stage)
+	};
+
+	/**
+	 * @param stages The evaluators from the cheapest to the most expensive one (at least two)
+	 * @param thresholds The acceptance threshold of every stage but the last
+	 * @param referenceSize The number of best subsets the stage fitness is compared to
+	 */
+	CascadeEvaluator(std::vector<std::unique_ptr<Evaluator> > &stages, const std::vector<double> &thresholds,
+					 uint16_t referenceSize, VerbosityLevel verbosity);
+
+	double evaluate(Chromosome &ch) {
+		arma::uvec columnSubset = ch.toColumnSubset();
+		double fitness = this->evaluate(columnSubset);
+		ch.setFitness(fitness);
+		return fitness;
+	};
+
+	double evaluate(arma::uvec &columnSubset);
+
+	Evaluator* clone() const;
+	Evaluator* cloneIndependent() const;
+	Evaluator* cloneWithResponse(const arma::vec &y) const;
+	Evaluator* cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const;
+
+	/**
+	 * Only the last stage is reseeded (the fitness comes from this stage)
+	 */
+	void reseedSegmentation(const std::vector<uint32_t> &seed);
+
+	std::vector<arma::uvec> getSegmentation() const {
+		return this->stages.back()->getSegmentation();
+	}
+
+	void addCacheStatistics(CacheStatistics &stats) const;
+
+	/**
+	 * The number of subsets evaluated and passed by every stage (summed over all clones)
+	 */
+	std::vector<StageStatistics> getStageStatistics() const;
+
+private:
+	/* Shared by all clones */
+	struct StageCounters {
+		std::unique_ptr<std::atomic<uint64_t>[]> evaluated;
+		std::unique_ptr<std::atomic<uint64_t>[]> passed;
+
+		StageCounters(size_t numStages);
+	};
+
+	std::vector<std::unique_ptr<Evaluator> > stages;
+	const std::vector<double> thresholds;
+	const uint16_t referenceSize;
+	std::shared_ptr<StageCounters> counters;
+
+	/* The stage fitness of the best subsets, ordered by their final fitness */
+	std::multimap<double, std::vector<double> > reference;
+	double worstFitness;
+
+	/**
+	 * The minimum fitness a subset must have in the given stage to be passed on
+	 */
+	double getCutoff(size_t stage) const;
+
+	/**
+	 * Remember the stage fitness of the subset if it is one of the best subsets
+	 */
+	void updateReference(double fitness, const std::vector<double> &stageFitness);
+
+	CascadeEvaluator(const CascadeEvaluator &other, std::vector<std::unique_ptr<Evaluator> > &stages, bool shareCounters);
+};
+
+#endif
@@ -14,6 +14,8 @@
 
 #include "Logger.h"
 #include "Chromosome.h"
+#include "EDAModel.h"
+#include "SimdKernels.h"
 #include "GenAlg.h"
 
 #ifdef HAVE_STRINGS_H
@@ -96,6 +98,33 @@ void Chromosome::copyFrom(const Chromosome &other, bool copyChromosomeParts) {
 	}
 }
 
+void Chromosome::setVariables(const arma::uvec &positions) {
+	std::fill(this->chromosomeParts.begin(), this->chromosomeParts.end(), 0);
+
+	for(arma::uword i = 0; i < positions.n_elem; ++i) {
+		if(!this->isVariableSet(positions[i])) {
+			this->toggleVariable(positions[i]);
+		}
+	}
+
+	this->fitness = 0.0;
+	this->updateCurrentlySetBits();
+}
+
+bool Chromosome::flipVariable(uint16_t var) {
+	const bool isSet = this->isVariableSet(var);
+
+	if((isSet && this->currentlySetBits <= this->ctrl.minVariables) ||
+	   (!isSet && this->currentlySetBits >= this->ctrl.maxVariables)) {
+		return false;
+	}
+
+	this->toggleVariable(var);
+	this->fitness = 0.0;
+	this->updateCurrentlySetBits();
+	return true;
+}
+
 void Chromosome::randomlyReset(RNG& rng, ShuffledSet &shuffledSet) {
 	this->fitness = 0.0;
 	this->initChromosomeParts(rng, shuffledSet);
@@ -213,7 +242,45 @@ void Chromosome::mateWith(const Chromosome &other, RNG& rng, Chromosome& child1,
 	child2.updateCurrentlySetBits();
 }
 
-bool Chromosome::mutate(RNG& rng) {
+void Chromosome::sampleFrom(const EDAModel &model, RNG& rng) {
+	IntChromosome word;
+	int32_t numChangeBits = 0;
+
+	/*
+	 * A bit is set with probability 0.b_(k-1)...b_1b_0 (in binary) if, going from the least to the most
+	 * significant bit of the probability, the bit is OR-ed with a random bit if b_l = 1 and AND-ed otherwise.
+	 * This samples all bits of a part at once with one random word per (non-trivial) level.
+	 */
+	for(uint16_t i = 0; i < this->numParts; ++i) {
+		word = 0;
+		for(uint8_t level = model.getLowestLevel(i); level < EDAModel::PROBABILITY_BITS; ++level) {
+			const IntChromosome plane = model.getPlane(i, level);
+			const IntChromosome rand = this->rbits(rng);
+			word = (plane & (word | rand)) | (~plane & word & rand);
+		}
+		this->chromosomeParts[i] = word;
+	}
+
+	this->fitness = 0.0;
+	this->updateCurrentlySetBits();
+
+	if(this->currentlySetBits < this->ctrl.minVariables) {
+		numChangeBits = this->ctrl.minVariables - this->currentlySetBits;
+	} else if(this->currentlySetBits > this->ctrl.maxVariables) {
+		numChangeBits = this->ctrl.maxVariables - this->currentlySetBits;
+	}
+
+	if(numChangeBits != 0) {
+		this->mutateWeighted(numChangeBits, rng, model.getSampler());
+		this->currentlySetBits += numChangeBits;
+	}
+
+	IF_DEBUG(
+		GAout << GAout.lock() << "Sampled chromosome: " << *this << std::endl << GAout.unlock();
+	)
+}
+
+bool Chromosome::mutate(RNG& rng, const WeightedSampler *sampler) {
 	if(this->ctrl.mutationProbability == 0.0) {
 		return false;
 	}
@@ -265,6 +332,8 @@ bool Chromosome::mutate(RNG& rng) {
 
 	if(numChangeBits == 0) {
 		return false;
+	} else if(sampler != NULL) {
+		this->mutateWeighted(numChangeBits, rng, *sampler);
 	} else if(numChangeBits < 0) {
 		/*
 		 * We have to unset -numChangeBits bits, i.e. flip from 1 to 0
@@ -373,6 +442,117 @@ bool Chromosome::mutate(RNG& rng) {
 	return true;
 }
 
+/*
+ * The number of draws from the weighted sampler that hit an already set variable
+ * before the remaining variables are added uniformly at random
+ */
+#define MAX_WEIGHTED_REJECTIONS 32
+
+void Chromosome::mutateWeighted(int32_t numChangeBits, RNG& rng, const WeightedSampler &sampler) {
+	if(numChangeBits < 0) {
+		/*
+		 * Remove variables with probability inversely proportional to their weight
+		 * by sequentially drawing without replacement
+		 */
+		arma::uvec setVariables = this->getSetPositions();
+		std::vector<double> inverseWeights(setVariables.n_elem);
+		double totalWeight = 0.0, u;
+		uint16_t i;
+
+		for(i = 0; i < setVariables.n_elem; ++i) {
+			inverseWeights[i] = 1.0 / sampler.getWeight(setVariables[i]);
+			totalWeight += inverseWeights[i];
+		}
+
+		for(int32_t removed = 0; removed > numChangeBits; --removed) {
+			u = rng(0.0, totalWeight);
+
+			for(i = 0; i < setVariables.n_elem - 1; ++i) {
+				if(u < inverseWeights[i]) {
+					break;
+				}
+				u -= inverseWeights[i];
+			}
+
+			/* The last variable may be chosen due to rounding errors even if it was already removed */
+			while(inverseWeights[i] == 0.0) {
+				--i;
+			}
+
+			this->toggleVariable(setVariables[i]);
+			totalWeight -= inverseWeights[i];
+			inverseWeights[i] = 0.0;
+		}
+	} else {
+		/*
+		 * Add variables with probability proportional to their weight.
+		 * Already set variables are rejected -- if this happens too often (i.e., almost
+		 * all of the weight is concentrated on the set variables) the remaining variables
+		 * are chosen uniformly among the unset variables.
+		 */
+		uint16_t rejections = 0, var;
+		int32_t added = 0;
+
+		while(added < numChangeBits && rejections < MAX_WEIGHTED_REJECTIONS) {
+			var = sampler(rng);
+			if(this->isVariableSet(var)) {
+				++rejections;
+			} else {
+				this->toggleVariable(var);
+				++added;
+			}
+		}
+
+		for(; added < numChangeBits; ++added) {
+			const uint16_t numUnset = this->ctrl.chromosomeSize - this->currentlySetBits - added;
+			uint16_t unsetPos = (uint16_t) rng(0.0, (double) numUnset);
+
+			if(unsetPos >= numUnset) {
+				unsetPos = numUnset - 1;
+			}
+
+			for(var = 0; var < this->ctrl.chromosomeSize; ++var) {
+				if(!this->isVariableSet(var)) {
+					if(unsetPos == 0) {
+						break;
+					}
+					--unsetPos;
+				}
+			}
+
+			this->toggleVariable(var);
+		}
+	}
+}
+
+inline bool Chromosome::isVariableSet(uint16_t var) const {
+	const uint32_t pos = (uint32_t) var + this->unusedBits;
+	return (this->chromosomeParts[pos / Chromosome::BITS_PER_PART] & (((IntChromosome) 1) << (pos % Chromosome::BITS_PER_PART))) > 0;
+}
+
+inline void Chromosome::toggleVariable(uint16_t var) {
+	const uint32_t pos = (uint32_t) var + this->unusedBits;
+	this->chromosomeParts[pos / Chromosome::BITS_PER_PART] ^= (((IntChromosome) 1) << (pos % Chromosome::BITS_PER_PART));
+}
+
+void Chromosome::addToInclusionCounts(std::vector<double> &counts) const {
+	IntChromosome mask = ((IntChromosome) 1) << this->unusedBits;
+	uint16_t found = 0;
+	uint32_t truePos = 0;
+
+	for (uint16_t i = 0; i < this->numParts && found < this->currentlySetBits; ++i) {
+		do {
+			if((this->chromosomeParts[i] & mask) > 0) {
+				counts[truePos] += 1.0;
+				++found;
+			}
+			++truePos;
+			mask <<= 1;
+		} while(mask > 0 && found < this->currentlySetBits);
+		mask = (IntChromosome) 1;
+	}
+}
+
 
 std::ostream& operator<<(std::ostream &os, const Chromosome &ch) {
 	ch.printBits(os, ch.chromosomeParts[0], ch.unusedBits);
@@ -402,6 +582,16 @@ inline std::ostream& Chromosome::printBits(std::ostream &os, IntChromosome bits,
 }
 
 Rcpp::LogicalVector Chromosome::toLogicalVector() const {
+	if(this->ctrl.numColumns != this->ctrl.chromosomeSize || !this->ctrl.freeColumns.empty()) {
+		LogicalVector columns(this->ctrl.numColumns, false);
+		arma::uvec columnSubset = this->toColumnSubset();
+
+		for(arma::uword i = 0; i < columnSubset.n_elem; ++i) {
+			columns[columnSubset[i]] = true;
+		}
+		return columns;
+	}
+
 	LogicalVector varVector;
 	IntChromosome mask = ((IntChromosome) 1) << this->unusedBits;
 
@@ -416,25 +606,52 @@ Rcpp::LogicalVector Chromosome::toLogicalVector() const {
 	return varVector;
 }
 
-arma::uvec Chromosome::toColumnSubset() const {
-	arma::uvec columnSubset(this->currentlySetBits);
+void Chromosome::packBits(uint8_t *row) const {
+	arma::uvec positions = this->getSetPositions();
+
+	for(arma::uword i = 0; i < positions.n_elem; ++i) {
+		row[positions[i] / BITS_PER_BYTE] |= (uint8_t) (1 << (positions[i] % BITS_PER_BYTE));
+	}
+}
+
+arma::uvec Chromosome::toColumnSubset(bool includeForced) const {
+	arma::uvec columnSubset = this->getSetPositions();
+
+	if(!this->ctrl.freeColumns.empty()) {
+		for(arma::uword i = 0; i < columnSubset.n_elem; ++i) {
+			columnSubset[i] = this->ctrl.freeColumns[columnSubset[i]];
+		}
+	}
+
+	if(includeForced && !this->ctrl.forcedColumns.empty()) {
+		const arma::uword numFree = columnSubset.n_elem;
+		columnSubset.resize(numFree + this->ctrl.forcedColumns.size());
+		for(arma::uword i = 0; i < this->ctrl.forcedColumns.size(); ++i) {
+			columnSubset[numFree + i] = this->ctrl.forcedColumns[i];
+		}
+	}
+
+	return columnSubset;
+}
+
+arma::uvec Chromosome::getSetPositions() const {
+	arma::uvec positions(this->currentlySetBits);
 	IntChromosome mask = ((IntChromosome) 1) << this->unusedBits;
 	uint16_t csIndex = 0;
 	arma::uword truePos = 0;
 
-	for (uint16_t i = 0; i < this->numParts && csIndex < columnSubset.n_elem; ++i) {
+	for (uint16_t i = 0; i < this->numParts && csIndex < positions.n_elem; ++i) {
 		do {
 			if((this->chromosomeParts[i] & mask) > 0) {
-				columnSubset[csIndex++] = truePos;
+				positions[csIndex++] = truePos;
 			}
 			++truePos;
 			mask <<= 1;
-		} while(mask > 0 && csIndex < columnSubset.n_elem);
+		} while(mask > 0 && csIndex < positions.n_elem);
 		mask = (IntChromosome) 1;
 	}
 
-	return columnSubset;
-
+	return positions;
 }
 
 bool Chromosome::operator==(const Chromosome &ch) const {
@@ -468,9 +685,7 @@ inline void Chromosome::updateCurrentlySetBits() {
 	this->currentlySetBits = 0;
 	
 #ifdef HAVE_BUILTIN_POPCOUNTLL
-	for(uint16_t i = 0; i < this->numParts; ++i) {
-		this->currentlySetBits += __builtin_popcountll(this->chromosomeParts[i]);
-	}
+	this->currentlySetBits = SimdKernels::popcount(&this->chromosomeParts[0], this->numParts);
 #elif (defined HAVE_BUILTIN_POPCOUNTL && !(defined HAVE_UNSIGNED_LONG_LONG))
 	for(uint16_t i = 0; i < this->numParts; ++i) {
 		this->currentlySetBits += __builtin_popcountl(this->chromosomeParts[i]);
@@ -564,8 +779,8 @@ inline IntChromosome Chromosome::rbits(RNG& rng) const {
 	if(partsPerRand > 1) {
 		IntChromosome rand = 0;
 
-		for(int8_t i = partsPerRand; i >= 0; --i) {
-			rand |= ((IntChromosome) (rng() << (i * RNG::RANDOM_BITS)));
+		for(int8_t i = partsPerRand - 1; i >= 0; --i) {
+			rand |= (((IntChromosome) rng()) << (i * RNG::RANDOM_BITS));
 		}
 
 		return rand;
@@ -18,6 +18,9 @@
 #include "TruncatedGeomGenerator.h"
 #include "ShuffledSet.h"
 #include "RNG.h"
+#include "WeightedSampler.h"
+
+class EDAModel;
 
 class InvalidCopulationException : public Rcpp::exception {
 
@@ -38,16 +41,49 @@ public:
 	void randomlyReset(RNG& rng, ShuffledSet &shuffledSet);
 
 	/**
+	 * @param sampler If not NULL, the variables to add are drawn with probability proportional
+	 *			to their weight in the sampler and the variables to remove with probability
+	 *			inversely proportional to their weight. Otherwise all variables are equally likely.
 	 * @return bool Returns true if mutation occurred, false otherwise
 	 */
-	bool mutate(RNG& rng);
+	bool mutate(RNG& rng, const WeightedSampler *sampler = NULL);
 	void mateWith(const Chromosome &other, RNG& rng, Chromosome& child1, Chromosome& child2);
 
+	/**
+	 * Draw the chromosome from the probability model of an EDA.
+	 * If too few/many variables are drawn, variables are added/removed according to the
+	 * probabilities of the model.
+	 */
+	void sampleFrom(const EDAModel &model, RNG& rng);
+
+	/**
+	 * Select exactly the given variables (positions in the chromosome, i.e., indices of the free variables)
+	 */
+	void setVariables(const arma::uvec &positions);
+
+	/**
+	 * Select the given variable if it is not selected and vice versa, unless the number of
+	 * selected variables would leave the range [minVariables, maxVariables].
+	 *
+	 * @return true if the variable was flipped
+	 */
+	bool flipVariable(uint16_t var);
+
 	void setFitness(double fitness) { this->fitness = fitness; };
 	double getFitness() const { return this->fitness; };
 
+	/**
+	 * The selected columns of the data as logical vector (including the columns that are always selected)
+	 */
 	Rcpp::LogicalVector toLogicalVector() const;
-	arma::uvec toColumnSubset() const;
+
+	/**
+	 * The indices of the selected columns of the data
+	 *
+	 * @param includeForced If true, the columns that are always selected (see Control::forcedColumns)
+	 *			are appended
+	 */
+	arma::uvec toColumnSubset(bool includeForced = true) const;
 
 	bool isFitterThan(const Chromosome &ch) const;
 
@@ -57,6 +93,18 @@ public:
 	
 	uint16_t getVariableCount() const { return this->currentlySetBits; };
 
+	/**
+	 * Write the chromosome as packed bits, where bit i (least significant bit first) is variable i
+	 *
+	 * @param row At least (chromosomeSize + 7) / 8 bytes which must be zero
+	 */
+	void packBits(uint8_t *row) const;
+
+	/**
+	 * Increment the count of every variable that is set in this chromosome
+	 */
+	void addToInclusionCounts(std::vector<double> &counts) const;
+
 	friend std::ostream& operator<<(std::ostream &os, const Chromosome &ch);
 private:
 	static const uint8_t BITS_PER_PART = sizeof(IntChromosome) * BITS_PER_BYTE;
@@ -108,6 +156,20 @@ private:
 
 	void copyFrom(const Chromosome& ch, bool copyChromosomeParts);
 
+	/*
+	 * The positions of the set bits (i.e. the indices of the selected free variables)
+	 */
+	arma::uvec getSetPositions() const;
+
+	/*
+	 * Set (numChangeBits > 0) or unset (numChangeBits < 0) the given number of bits
+	 * according to the weights of the sampler
+	 */
+	void mutateWeighted(int32_t numChangeBits, RNG& rng, const WeightedSampler &sampler);
+
+	inline bool isVariableSet(uint16_t var) const;
+	inline void toggleVariable(uint16_t var);
+
 #if !(defined HAVE_BUILTIN_POPCOUNTLL | defined HAVE_BUILTIN_POPCOUNTL)
 	static const IntChromosome M1 = 0x5555555555555555; // binary: 010101010101... (1 zero, 1 one)
 	static const IntChromosome M2 = 0x3333333333333333; // binary: 001100110011... (2 zeros, 2 ones)
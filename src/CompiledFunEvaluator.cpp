@@ -0,0 +1,51 @@
+//
+//  CompiledFunEvaluator.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <RcppArmadillo.h>
+
+#include "CompiledFunEvaluator.h"
+#include "RowWeights.h"
+
+CompiledFunEvaluator::CompiledFunEvaluator(const arma::mat &X, const arma::vec &y, gaselect_fitness_fun fun, void *state,
+										   const VerbosityLevel &verbosity) :
+	Evaluator(verbosity), X(new arma::mat(const_cast<double*>(X.memptr()), X.n_rows, X.n_cols, false, true)),
+	y(new arma::vec(y)), fun(fun), state(state)
+{
+}
+
+double CompiledFunEvaluator::evaluate(arma::uvec &columnSubset) {
+	this->columns.assign(columnSubset.begin(), columnSubset.end());
+
+	this->beginPhases();
+	double fitness = this->fun(this->X->memptr(), this->y->memptr(), (uint32_t) this->X->n_rows, (uint32_t) this->X->n_cols,
+							   this->columns.data(), (uint32_t) this->columns.size(), this->state);
+	this->endPhase(HardwareCounters::PHASE_FIT);
+
+	if(std::isnan(fitness)) {
+		throw Evaluator::EvaluatorException("The compiled evaluation function could not evaluate the variable subset.");
+	}
+
+	return fitness;
+}
+
+Evaluator* CompiledFunEvaluator::cloneWithResponse(const arma::vec &y) const {
+	return new CompiledFunEvaluator(*this, this->X, std::shared_ptr<const arma::vec>(new arma::vec(y)));
+}
+
+Evaluator* CompiledFunEvaluator::cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const {
+	if(rowWeights.n_elem != this->y->n_elem) {
+		throw std::invalid_argument("There must be one weight for every observation");
+	}
+
+	RowWeights weights(rowWeights);
+
+	return new CompiledFunEvaluator(*this, std::shared_ptr<const arma::mat>(new arma::mat(this->X->rows(weights.getRows()))),
+									std::shared_ptr<const arma::vec>(new arma::vec(this->y->elem(weights.getRows()))));
+}
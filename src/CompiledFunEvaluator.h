@@ -0,0 +1,76 @@
+//
+//  CompiledFunEvaluator.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_CompiledFunEvaluator_h
+#define gaselect_CompiledFunEvaluator_h
+
+#include "config.h"
+
+#include <memory>
+#include <vector>
+#include <RcppArmadillo.h>
+#include <gaselect.h>
+
+#include "Evaluator.h"
+#include "Chromosome.h"
+
+/**
+ * Evaluator calling a user supplied fitness function compiled to native code (see gaselect.h).
+ *
+ * Unlike the UserFunEvaluator, no R code is involved, so the evaluator can be cloned and used
+ * by several threads at the same time. The data is shared by all clones.
+ */
+class CompiledFunEvaluator : public Evaluator {
+public:
+	/**
+	 * @param X The data (not copied, it must outlive the evaluator and all its clones)
+	 * @param fun The fitness function
+	 * @param state The user state passed on to the fitness function (may be NULL)
+	 */
+	CompiledFunEvaluator(const arma::mat &X, const arma::vec &y, gaselect_fitness_fun fun, void *state,
+						 const VerbosityLevel &verbosity);
+
+	double evaluate(Chromosome &ch) {
+		arma::uvec columnSubset = ch.toColumnSubset();
+		double fitness = this->evaluate(columnSubset);
+		ch.setFitness(fitness);
+		return fitness;
+	};
+
+	/**
+	 * @throws Evaluator::EvaluatorException if the function returns NaN
+	 */
+	double evaluate(arma::uvec &columnSubset);
+
+	Evaluator* clone() const {
+		return new CompiledFunEvaluator(*this);
+	}
+
+	Evaluator* cloneWithResponse(const arma::vec &y) const;
+
+	/**
+	 * The fitness function only sees the data, therefore the observations are copied as often as
+	 * given by their weight.
+	 */
+	Evaluator* cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const;
+
+private:
+	std::shared_ptr<const arma::mat> X;
+	std::shared_ptr<const arma::vec> y;
+	const gaselect_fitness_fun fun;
+	void * const state;
+
+	/* The selected columns as passed to the function (every clone has its own buffer) */
+	std::vector<uint32_t> columns;
+
+	CompiledFunEvaluator(const CompiledFunEvaluator &other) :
+		Evaluator(other.verbosity), X(other.X), y(other.y), fun(other.fun), state(other.state) {}
+
+	CompiledFunEvaluator(const CompiledFunEvaluator &other, std::shared_ptr<const arma::mat> X, std::shared_ptr<const arma::vec> y) :
+		Evaluator(other.verbosity), X(X), y(y), fun(other.fun), state(other.state) {}
+};
+
+#endif
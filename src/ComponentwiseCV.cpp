@@ -0,0 +1,67 @@
+//
+//  ComponentwiseCV.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <RcppArmadillo.h>
+
+#include "ComponentwiseCV.h"
+#include "SimdKernels.h"
+
+uint16_t ComponentwiseCV::run(PLS &pls, std::vector<arma::uvec>::const_iterator &segmentIter, uint16_t numSegments,
+							  uint16_t maxNComp, OnlineStddev &msep) {
+	uint16_t seg, comp, rises = 0;
+	arma::vec fitted;
+
+	while(this->steppers.size() < numSegments) {
+		this->steppers.push_back(pls.createStepper());
+	}
+
+	if(this->leftOutX.size() < numSegments) {
+		this->leftOutX.resize(numSegments);
+		this->leftOutY.resize(numSegments);
+	}
+
+	/*
+	 * Initialize the fit for every segment
+	 */
+	for(seg = 0; seg < numSegments; ++seg) {
+		/* Segmentation iterator currently points to the `fit` segment */
+		pls.viewSelectRows(*segmentIter);
+		pls.initStepper(*this->steppers[seg], maxNComp);
+
+		/* Increment segmentation iterator to point to the `predict` segment */
+		++segmentIter;
+
+		this->leftOutY[seg] = pls.getY().rows(*segmentIter);
+		this->leftOutX[seg] = pls.getXColumnView().rows(*segmentIter);
+
+		/* Increment segmentation iterator to point to the next `fit` segment */
+		++segmentIter;
+	}
+
+	/*
+	 * Add one component at a time to all segments
+	 */
+	for(comp = 0; comp < maxNComp; ++comp) {
+		for(seg = 0; seg < numSegments; ++seg) {
+			this->steppers[seg]->step();
+			fitted = this->steppers[seg]->predict(this->leftOutX[seg]);
+			msep.update(SimdKernels::sumSquaredDiff(this->leftOutY[seg].memptr(), fitted.memptr(), fitted.n_elem) / fitted.n_elem, comp);
+		}
+
+		if(comp > 0 && msep.mean(comp) > msep.mean(comp - 1)) {
+			if(++rises >= this->earlyStop) {
+				++comp;
+				break;
+			}
+		} else {
+			rises = 0;
+		}
+	}
+
+	return comp;
+}
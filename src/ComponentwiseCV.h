@@ -0,0 +1,63 @@
+//
+//  ComponentwiseCV.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_ComponentwiseCV_h
+#define gaselect_ComponentwiseCV_h
+
+#include "config.h"
+
+#include <memory>
+#include <vector>
+#include <RcppArmadillo.h>
+
+#include "PLS.h"
+#include "OnlineStddev.h"
+
+/**
+ * Estimate the CV error curve of PLS models by processing all segments component-wise,
+ * i.e., one component is added to the models of all segments before the next
+ * component is considered.
+ * This allows to stop as soon as the mean CV error increased for `earlyStop` consecutive
+ * components, instead of always fitting the maximum number of components.
+ */
+class ComponentwiseCV {
+public:
+	/**
+	 * @param earlyStop The number of consecutive components with increasing CV error after which
+	 *			no more components are added (0 means early stopping is disabled)
+	 */
+	ComponentwiseCV(uint16_t earlyStop) : earlyStop(earlyStop) {};
+
+	/* The working memory is not copied */
+	ComponentwiseCV(const ComponentwiseCV &other) : earlyStop(other.earlyStop) {};
+
+	bool isEnabled() const { return this->earlyStop > 0; }
+
+	uint16_t getEarlyStop() const { return this->earlyStop; }
+
+	/**
+	 * Compute the MSEP for 1, 2, ... components for `numSegments` segments. The segmentation iterator
+	 * must point to the first `fit` segment and is advanced past the last `predict` segment.
+	 *
+	 * @param pls The PLS object with the columns already selected
+	 * @param msep The MSEP for k components is stored in dimension k - 1
+	 * @return The number of components the MSEP was computed for (at most maxNComp)
+	 * @throws std::underflow_error if a component can not be computed
+	 */
+	uint16_t run(PLS &pls, std::vector<arma::uvec>::const_iterator &segmentIter, uint16_t numSegments,
+				 uint16_t maxNComp, OnlineStddev &msep);
+
+private:
+	const uint16_t earlyStop;
+
+	std::vector<std::unique_ptr<PLSStepper> > steppers;
+	std::vector<arma::mat> leftOutX;
+	std::vector<arma::vec> leftOutY;
+
+	ComponentwiseCV& operator=(const ComponentwiseCV&);
+};
+
+#endif
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <vector>
+#include <string>
 #include <RcppArmadillo.h>
 
 enum VerbosityLevel {
@@ -31,6 +32,28 @@ enum FitnessScaling {
 	EXP = 1
 };
 
+enum MutationWeighting {
+	MUTATION_UNIFORM = 0,
+	MUTATION_UNIVARIATE = 1,
+	MUTATION_FREQUENCY = 2
+};
+
+enum SearchEngine {
+	ENGINE_GA = 0,
+	ENGINE_EDA = 1
+};
+
+enum IdleTask {
+	IDLE_NONE = 0,
+	IDLE_REEVALUATE = 1,
+	IDLE_LOCAL_SEARCH = 2
+};
+
+enum EvaluationOrder {
+	ORDER_MATING = 0,
+	ORDER_LOCALITY = 1
+};
+
 class Control {
 public:
 	Control(const uint16_t chromosomeSize,
@@ -45,7 +68,20 @@ public:
 			const double badSolutionThreshold,
 			const enum CrossoverType crossover,
 			const enum FitnessScaling fitnessScaling,
-			const enum VerbosityLevel verbosity) :
+			const enum VerbosityLevel verbosity,
+			const std::string &telemetryFile = std::string(),
+			const enum MutationWeighting mutationWeighting = MUTATION_UNIFORM,
+			const enum SearchEngine engine = ENGINE_GA,
+			const double learningRate = 1.0,
+			const double selectionRatio = 0.5,
+			const std::vector<uint16_t> &freeColumns = std::vector<uint16_t>(),
+			const std::vector<uint16_t> &forcedColumns = std::vector<uint16_t>(),
+			const uint16_t numColumns = 0,
+			const uint16_t minPopulationSize = 0,
+			const enum IdleTask idleTask = IDLE_NONE,
+			const enum EvaluationOrder evaluationOrder = ORDER_MATING,
+			const std::string &snapshotFile = std::string(),
+			const uint16_t snapshotInterval = 1) :
 	chromosomeSize(chromosomeSize),
 	populationSize(popSize),
 	numGenerations(numGenerations),
@@ -58,7 +94,20 @@ public:
 	badSolutionThreshold(badSolutionThreshold),
 	crossover(crossover),
 	fitnessScaling(fitnessScaling),
-	verbosity(verbosity) {};
+	verbosity(verbosity),
+	telemetryFile(telemetryFile),
+	mutationWeighting(mutationWeighting),
+	engine(engine),
+	learningRate(learningRate),
+	selectionRatio(selectionRatio),
+	freeColumns(freeColumns),
+	forcedColumns(forcedColumns),
+	numColumns((numColumns > 0) ? numColumns : chromosomeSize),
+	minPopulationSize((minPopulationSize > 0 && minPopulationSize < popSize) ? minPopulationSize : popSize),
+	idleTask(idleTask),
+	evaluationOrder(evaluationOrder),
+	snapshotFile(snapshotFile),
+	snapshotInterval((snapshotInterval > 0) ? snapshotInterval : 1) {};
 
 	const uint16_t chromosomeSize;
 	const uint16_t populationSize;
@@ -73,10 +122,41 @@ public:
 	const enum CrossoverType crossover;
 	const enum FitnessScaling fitnessScaling;
 	const enum VerbosityLevel verbosity;
+	const std::string telemetryFile;
+	const enum MutationWeighting mutationWeighting;
+	const enum SearchEngine engine;
+	/* The weight of the selected chromosomes when updating the EDA model (1 = UMDA, < 1 = PBIL) */
+	const double learningRate;
+	/* The proportion of the best chromosomes used to update the EDA model */
+	const double selectionRatio;
+	/*
+	 * The column of the data for every variable in the chromosome (empty if the chromosome spans
+	 * all columns) and the columns that are part of every subset
+	 */
+	const std::vector<uint16_t> freeColumns;
+	const std::vector<uint16_t> forcedColumns;
+	/* The total number of columns of the data */
+	const uint16_t numColumns;
+	/*
+	 * The smallest number of children per generation. If less than populationSize, the size
+	 * of the population is adapted to the progress of the search (populationSize is the maximum).
+	 */
+	const uint16_t minPopulationSize;
+	/* What threads that finished their part of a generation early do until the other threads are done */
+	const enum IdleTask idleTask;
+	/*
+	 * The order in which the children are evaluated. With ORDER_LOCALITY, the children are generated
+	 * in batches and evaluated such that children sharing many variables are evaluated back-to-back.
+	 */
+	const enum EvaluationOrder evaluationOrder;
+	/* The binary file the generations are written to (empty if disabled) and every how many generations */
+	const std::string snapshotFile;
+	const uint16_t snapshotInterval;
 
 	friend std::ostream& operator<<(std::ostream &os, const Control &ctrl) {
 		os << "Chromosome size: " << ctrl.chromosomeSize << std::endl
 		<< "Population size: " << ctrl.populationSize << std::endl
+		<< "Minimum population size: " << ctrl.minPopulationSize << std::endl
 		<< "Number of generations: " << ctrl.numGenerations << std::endl
 		<< "Number of elite chromosomes to keep: " << ctrl.elitism << std::endl
 		<< "Number of variables set: " << ctrl.minVariables << " to " << ctrl.maxVariables << std::endl
@@ -87,6 +167,24 @@ public:
 		<< "Fitness-scaling: " << ((ctrl.fitnessScaling == EXP) ? "exp" : "None") << std::endl
 		<< "Number of threads: " << ctrl.numThreads << std::endl
 		<< "Verbosity Level: " << ctrl.verbosity << std::endl
+		<< "Telemetry file: " << (ctrl.telemetryFile.empty() ? "None" : ctrl.telemetryFile) << std::endl
+		<< "Mutation weighting: " << ((ctrl.mutationWeighting == MUTATION_UNIVARIATE) ? "Univariate" : ((ctrl.mutationWeighting == MUTATION_FREQUENCY) ? "Frequency" : "Uniform")) << std::endl
+		<< "Search engine: " << ((ctrl.engine == ENGINE_EDA) ? "EDA" : "GA") << std::endl
+		<< "Idle task: " << ((ctrl.idleTask == IDLE_REEVALUATE) ? "Re-evaluate elite" : ((ctrl.idleTask == IDLE_LOCAL_SEARCH) ? "Local search" : "None")) << std::endl
+		<< "Evaluation order: " << ((ctrl.evaluationOrder == ORDER_LOCALITY) ? "Locality" : "Mating") << std::endl
+		<< "Snapshot file: " << (ctrl.snapshotFile.empty() ? "None" : ctrl.snapshotFile) << std::endl;
+
+		if(ctrl.engine == ENGINE_EDA) {
+			os << "Learning rate: " << ctrl.learningRate << std::endl
+			<< "Selection ratio: " << ctrl.selectionRatio << std::endl;
+		}
+
+		if(ctrl.numColumns != ctrl.chromosomeSize) {
+			os << "Variables always included: " << ctrl.forcedColumns.size() << std::endl
+			<< "Variables never included: " << (ctrl.numColumns - ctrl.chromosomeSize - ctrl.forcedColumns.size()) << std::endl;
+		}
+
+		os
 #ifdef ENABLE_DEBUG_VERBOSITY
 		<< "Debug enabled"
 #else
@@ -0,0 +1,127 @@
+//
+//  CrossProductCache.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <algorithm>
+#include <RcppArmadillo.h>
+
+#include "CrossProductCache.h"
+
+CrossProductCache::CrossProductCache(const std::shared_ptr<const arma::mat> &X, const arma::uvec &rows, const arma::vec &y,
+									 size_t maxBytes, arma::uword blockSize) :
+	X(X), rows(rows), y(y), maxBytes(maxBytes), blockSize((blockSize < 1) ? 1 : blockSize),
+	numBlocks((X->n_cols + this->blockSize - 1) / this->blockSize), blockBytes(0),
+	xtyValues(X->n_cols), xtyComputed(numBlocks, false), xtyBytes(0), lookups(0), hits(0)
+{
+}
+
+arma::mat CrossProductCache::getColumns(arma::uword b) const {
+	const arma::uword first = b * this->blockSize;
+	const arma::uword last = std::min(first + this->blockSize, (arma::uword) this->X->n_cols) - 1;
+
+	if(this->rows.n_elem > 0) {
+		return this->X->submat(this->rows, arma::linspace<arma::uvec>(first, last, last - first + 1));
+	}
+	return this->X->cols(first, last);
+}
+
+const arma::mat& CrossProductCache::getBlock(arma::uword bi, arma::uword bj) {
+	const uint64_t key = (uint64_t) bi * this->numBlocks + bj;
+	std::unordered_map<uint64_t, BlockList::iterator>::iterator found = this->index.find(key);
+
+	++this->lookups;
+
+	if(found != this->index.end()) {
+		++this->hits;
+		this->blocks.splice(this->blocks.begin(), this->blocks, found->second);
+		return found->second->values;
+	}
+
+	Block block;
+	block.key = key;
+
+	if(bi == bj) {
+		arma::mat Xi = this->getColumns(bi);
+		block.values = Xi.t() * Xi;
+	} else {
+		block.values = this->getColumns(bi).t() * this->getColumns(bj);
+	}
+
+	const size_t bytes = block.values.n_elem * sizeof(double);
+
+	/* Make room for the new block (it is kept even if it alone exceeds the limit) */
+	while(!this->blocks.empty() && this->blockBytes + bytes > this->maxBytes) {
+		this->blockBytes -= this->blocks.back().values.n_elem * sizeof(double);
+		this->index.erase(this->blocks.back().key);
+		this->blocks.pop_back();
+	}
+
+	this->blocks.push_front(block);
+	this->index[key] = this->blocks.begin();
+	this->blockBytes += bytes;
+
+	return this->blocks.front().values;
+}
+
+double CrossProductCache::xtx(arma::uword i, arma::uword j) {
+	if(i > j) {
+		std::swap(i, j);
+	}
+
+	return this->getBlock(i / this->blockSize, j / this->blockSize)(i % this->blockSize, j % this->blockSize);
+}
+
+double CrossProductCache::xty(arma::uword i) {
+	const arma::uword b = i / this->blockSize;
+
+	if(!this->xtyComputed[b]) {
+		const arma::uword first = b * this->blockSize;
+		arma::vec values = this->getColumns(b).t() * this->y;
+
+		this->xtyValues.subvec(first, first + values.n_elem - 1) = values;
+		this->xtyComputed[b] = true;
+		this->xtyBytes += values.n_elem * sizeof(double);
+	}
+
+	return this->xtyValues[i];
+}
+
+void CrossProductCache::gather(const arma::uvec &columns, arma::mat &XtX, arma::vec &Xty) {
+	const arma::uword k = columns.n_elem;
+	const arma::uvec order = arma::sort_index(columns);
+	arma::uword gi, gj, i, j, bi, bj, giEnd, gjEnd;
+
+	XtX.set_size(k, k);
+	Xty.set_size(k);
+
+	/*
+	 * Walk over the groups of (sorted) columns in the same block and
+	 * look up every pair of blocks only once
+	 */
+	for(gi = 0; gi < k; gi = giEnd) {
+		bi = columns[order[gi]] / this->blockSize;
+		for(giEnd = gi + 1; giEnd < k && columns[order[giEnd]] / this->blockSize == bi; ++giEnd) {}
+
+		for(gj = gi; gj < k; gj = gjEnd) {
+			bj = columns[order[gj]] / this->blockSize;
+			for(gjEnd = gj + 1; gjEnd < k && columns[order[gjEnd]] / this->blockSize == bj; ++gjEnd) {}
+
+			const arma::mat &block = this->getBlock(bi, bj);
+
+			for(i = gi; i < giEnd; ++i) {
+				for(j = gj; j < gjEnd; ++j) {
+					XtX(order[i], order[j]) = XtX(order[j], order[i]) =
+						block(columns[order[i]] % this->blockSize, columns[order[j]] % this->blockSize);
+				}
+			}
+		}
+
+		for(i = gi; i < giEnd; ++i) {
+			Xty[order[i]] = this->xty(columns[order[i]]);
+		}
+	}
+}
@@ -0,0 +1,109 @@
+//
+//  CrossProductCache.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_CrossProductCache_h
+#define gaselect_CrossProductCache_h
+
+#include "config.h"
+
+#include <list>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <RcppArmadillo.h>
+
+/**
+ * Lazily computed cross-products X'X and X'y of a (possibly very wide) matrix X.
+ *
+ * The full p x p cross-product matrix is usually much too large, but the subsets
+ * evaluated by the GA tend to revisit the same variables over and over.
+ * Therefore the cross-product matrix is split into square blocks of `blockSize`
+ * columns which are computed (with a single matrix product) the first time
+ * an entry of the block is requested. If the memory used by the blocks exceeds
+ * the limit, the least recently used blocks are discarded.
+ *
+ * The cache is not thread safe, every thread must use its own cache.
+ */
+class CrossProductCache {
+public:
+	static const arma::uword DEFAULT_BLOCK_SIZE = 64;
+
+	/**
+	 * @param X The data matrix
+	 * @param rows The rows of X to use (all rows if empty)
+	 * @param y The response (one value for every used row)
+	 * @param maxBytes The maximum number of bytes used for the blocks of X'X
+	 * @param blockSize The number of columns in a block
+	 */
+	CrossProductCache(const std::shared_ptr<const arma::mat> &X, const arma::uvec &rows, const arma::vec &y,
+					  size_t maxBytes, arma::uword blockSize = DEFAULT_BLOCK_SIZE);
+
+	/**
+	 * The cross-product of the columns i and j of X
+	 */
+	double xtx(arma::uword i, arma::uword j);
+
+	/**
+	 * The cross-product of column i of X with y
+	 */
+	double xty(arma::uword i);
+
+	/**
+	 * Get the cross-product matrix of the given columns and their cross-products with y
+	 * (every block is looked up only once)
+	 */
+	void gather(const arma::uvec &columns, arma::mat &XtX, arma::vec &Xty);
+
+	/**
+	 * The number of block lookups and how many of them found the block in the cache
+	 */
+	uint64_t getLookups() const { return this->lookups; }
+	uint64_t getHits() const { return this->hits; }
+
+	/**
+	 * The number of bytes currently used for the cross-products
+	 */
+	size_t getBytes() const { return this->blockBytes + this->xtyBytes; }
+
+private:
+	struct Block {
+		uint64_t key;
+		arma::mat values;
+	};
+
+	/* Most recently used block in front */
+	typedef std::list<Block> BlockList;
+
+	const std::shared_ptr<const arma::mat> X;
+	const arma::uvec rows;
+	const arma::vec y;
+	const size_t maxBytes;
+	const arma::uword blockSize;
+	const arma::uword numBlocks;
+
+	BlockList blocks;
+	std::unordered_map<uint64_t, BlockList::iterator> index;
+	size_t blockBytes;
+
+	arma::vec xtyValues;
+	std::vector<bool> xtyComputed;
+	size_t xtyBytes;
+
+	uint64_t lookups;
+	uint64_t hits;
+
+	/**
+	 * Get block (bi, bj) of X'X with bi <= bj
+	 */
+	const arma::mat& getBlock(arma::uword bi, arma::uword bj);
+
+	/**
+	 * The columns of block b restricted to the used rows
+	 */
+	arma::mat getColumns(arma::uword b) const;
+};
+
+#endif
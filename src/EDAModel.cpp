@@ -0,0 +1,75 @@
+//
+//  EDAModel.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <vector>
+#include <algorithm>
+
+#include "EDAModel.h"
+
+EDAModel::EDAModel(const Control &ctrl) : ctrl(ctrl), minProbability(1.0 / ctrl.chromosomeSize),
+	probabilities(ctrl.chromosomeSize, 0.5 * (ctrl.minVariables + ctrl.maxVariables) / ctrl.chromosomeSize),
+	sampler(probabilities)
+{
+	/* Same layout as the chromosome parts */
+	this->numParts = this->ctrl.chromosomeSize / EDAModel::BITS_PER_PART;
+	this->unusedBits = 0;
+
+	if(this->ctrl.chromosomeSize % EDAModel::BITS_PER_PART > 0) {
+		this->numParts += 1;
+		this->unusedBits = EDAModel::BITS_PER_PART - (this->ctrl.chromosomeSize % EDAModel::BITS_PER_PART);
+	}
+
+	this->planes.resize(this->numParts * EDAModel::PROBABILITY_BITS, 0);
+	this->lowestLevel.resize(this->numParts, EDAModel::PROBABILITY_BITS);
+
+	this->updatePlanes();
+}
+
+void EDAModel::update(const std::vector<double> &counts, uint32_t numSelected) {
+	const double maxProbability = 1.0 - this->minProbability;
+
+	for(uint16_t i = 0; i < this->ctrl.chromosomeSize; ++i) {
+		double p = (1.0 - this->ctrl.learningRate) * this->probabilities[i] + this->ctrl.learningRate * counts[i] / numSelected;
+		this->probabilities[i] = std::min(maxProbability, std::max(this->minProbability, p));
+	}
+
+	this->sampler.setWeights(this->probabilities);
+	this->updatePlanes();
+}
+
+void EDAModel::updatePlanes() {
+	const double scale = (double) (((uint32_t) 1) << EDAModel::PROBABILITY_BITS);
+	const uint32_t maxQuantized = (((uint32_t) 1) << EDAModel::PROBABILITY_BITS) - 1;
+	uint32_t pos, quantized;
+	uint16_t part, offset;
+	uint8_t level;
+
+	std::fill(this->planes.begin(), this->planes.end(), 0);
+
+	for(uint16_t i = 0; i < this->ctrl.chromosomeSize; ++i) {
+		pos = (uint32_t) i + this->unusedBits;
+		part = pos / EDAModel::BITS_PER_PART;
+		offset = pos % EDAModel::BITS_PER_PART;
+
+		quantized = (uint32_t) (this->probabilities[i] * scale + 0.5);
+		if(quantized > maxQuantized) {
+			quantized = maxQuantized;
+		}
+
+		for(level = 0; quantized > 0; ++level, quantized >>= 1) {
+			if(quantized & 1) {
+				this->planes[part * EDAModel::PROBABILITY_BITS + level] |= (((IntChromosome) 1) << offset);
+			}
+		}
+	}
+
+	for(part = 0; part < this->numParts; ++part) {
+		for(level = 0; level < EDAModel::PROBABILITY_BITS && this->planes[part * EDAModel::PROBABILITY_BITS + level] == 0; ++level) {}
+		this->lowestLevel[part] = level;
+	}
+}
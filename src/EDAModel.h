@@ -0,0 +1,75 @@
+//
+//  EDAModel.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_EDAModel_h
+#define gaselect_EDAModel_h
+
+#include "config.h"
+
+#include <vector>
+
+#include "Control.h"
+#include "WeightedSampler.h"
+
+/**
+ * The probability model of an estimation-of-distribution algorithm (PBIL/UMDA):
+ * every variable is included independently with its own probability.
+ *
+ * To sample whole chromosome parts at once, the probabilities are quantized to
+ * PROBABILITY_BITS bits and stored as bit planes in the same layout as the chromosome
+ * parts: bit j of plane l of a part is bit l of the quantized probability of the
+ * variable at position j of that part (see Chromosome::sampleFrom).
+ */
+class EDAModel {
+public:
+	static const uint8_t PROBABILITY_BITS = 16;
+
+	EDAModel(const Control &ctrl);
+
+	/**
+	 * Move the probabilities towards the inclusion frequencies of the selected chromosomes
+	 *
+	 * @param counts The number of selected chromosomes every variable is included in
+	 * @param numSelected The number of selected chromosomes
+	 */
+	void update(const std::vector<double> &counts, uint32_t numSelected);
+
+	const std::vector<double>& getProbabilities() const { return this->probabilities; }
+
+	/**
+	 * The sampler used to add/remove variables if a sampled chromosome has too few/many variables
+	 */
+	const WeightedSampler& getSampler() const { return this->sampler; }
+
+	IntChromosome getPlane(uint16_t part, uint8_t level) const {
+		return this->planes[part * EDAModel::PROBABILITY_BITS + level];
+	}
+
+	/**
+	 * The least significant plane of the part with any bit set (PROBABILITY_BITS if none is set)
+	 */
+	uint8_t getLowestLevel(uint16_t part) const { return this->lowestLevel[part]; }
+
+private:
+	static const uint8_t BITS_PER_PART = sizeof(IntChromosome) * BITS_PER_BYTE;
+
+	const Control &ctrl;
+
+	/* The probabilities are kept within [minProbability, 1 - minProbability] */
+	const double minProbability;
+
+	uint16_t numParts;
+	uint16_t unusedBits;
+
+	std::vector<double> probabilities;
+	std::vector<IntChromosome> planes;
+	std::vector<uint8_t> lowestLevel;
+	WeightedSampler sampler;
+
+	void updatePlanes();
+};
+
+#endif
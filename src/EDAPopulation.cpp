@@ -0,0 +1,182 @@
+//
+//  EDAPopulation.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <RcppArmadillo.h>
+
+#include "Logger.h"
+#include "RNG.h"
+#include "ShuffledSet.h"
+#include "EDAModel.h"
+#include "EDAPopulation.h"
+
+#ifdef ENABLE_DEBUG_VERBOSITY
+#define IF_DEBUG(expr) if(this->ctrl.verbosity == DEBUG_GA || this->ctrl.verbosity == DEBUG_ALL) { expr; }
+#else
+#define IF_DEBUG(expr)
+#endif
+
+/*
+ * R user interrupt handling helpers
+ */
+static inline void eda_check_interrupt_impl(void* /*dummy*/) {
+	R_CheckUserInterrupt();
+}
+
+static inline bool eda_check_interrupt() {
+	return (R_ToplevelExec(eda_check_interrupt_impl, NULL) == FALSE);
+}
+
+EDAPopulation::EDAPopulation(const Control &ctrl, ::Evaluator &evaluator, const std::vector<uint32_t> &seed, bool checkUserInterrupt) :
+	Population(ctrl, evaluator, seed), checkUserInterrupt(checkUserInterrupt) {}
+
+void EDAPopulation::run() {
+	ShuffledSet shuffledSet(this->ctrl.chromosomeSize);
+	RNG rng(this->seed);
+	EDAModel model(this->ctrl);
+
+	ChVec newGeneration;
+	ChVec pending;
+	ChVec finished;
+	ChVec unevaluable;
+	ChVecIt childIt;
+	std::vector<arma::uvec> subsets;
+	std::vector<double> batchFitness;
+
+	std::vector<double> selectedCounts(this->ctrl.chromosomeSize);
+	uint32_t numSelected = (uint32_t) std::ceil(this->ctrl.selectionRatio * this->ctrl.populationSize);
+	uint32_t maxDiscardedSolutions = Population::MAX_DISCARDED_SOLUTIONS_RATIO * this->ctrl.populationSize;
+	uint32_t discSol = 0;
+	uint32_t i;
+	uint64_t numEvaluations = 0;
+	uint32_t generation;
+	uint32_t duplicateTries = 0;
+	double minFitness = 0.0;
+
+	if(numSelected < 1) {
+		numSelected = 1;
+	} else if(numSelected > this->ctrl.populationSize) {
+		numSelected = this->ctrl.populationSize;
+	}
+
+	newGeneration.reserve(this->ctrl.populationSize);
+	for(i = 0; i < this->ctrl.populationSize; ++i) {
+		newGeneration.push_back(new Chromosome(this->ctrl, shuffledSet, rng, false));
+	}
+
+	this->initCurrentGeneration(shuffledSet, rng);
+
+	for(generation = 0; generation <= this->ctrl.numGenerations && !this->interrupted; ++generation) {
+		if(this->ctrl.verbosity > OFF) {
+			if(generation == 0) {
+				GAout << "Generating initial population" << std::endl;
+			} else {
+				GAout << "Generating generation " << generation << std::endl;
+			}
+		}
+
+		minFitness = 0.0;
+		discSol = 0;
+		pending = newGeneration;
+		finished.clear();
+		unevaluable.clear();
+
+		/*
+		 * Sample all chromosomes of the generation and evaluate them as one batch, so the evaluator
+		 * can share work between similar chromosomes. Chromosomes that can not be evaluated
+		 * are sampled again, but only until too many of them were discarded. After that they are
+		 * accepted with the lowest fitness of the generation (like too bad children in the
+		 * genetic algorithm), otherwise a model that only produces such chromosomes never finishes.
+		 */
+		while(!pending.empty() && !this->interrupted) {
+			for(childIt = pending.begin(); childIt != pending.end(); ++childIt) {
+				for(duplicateTries = 0; duplicateTries <= this->ctrl.maxDuplicateEliminationTries; ++duplicateTries) {
+					(*childIt)->sampleFrom(model, rng);
+
+					/* Resample duplicates (of this generation) until the maximum number of tries is reached */
+					if(this->ctrl.maxDuplicateEliminationTries == 0 ||
+					   (std::find_if(finished.begin(), finished.end(), CompChromsomePtr(*childIt)) == finished.end() &&
+						std::find_if(pending.begin(), childIt, CompChromsomePtr(*childIt)) == childIt)) {
+						break;
+					}
+				}
+
+				subsets.push_back((*childIt)->toColumnSubset());
+			}
+
+			this->evaluator.evaluateBatch(subsets, batchFitness);
+			numEvaluations += subsets.size();
+
+			for(i = 0, childIt = pending.begin(); childIt != pending.end(); ++i) {
+				if(std::isnan(batchFitness[i])) {
+					if(discSol < maxDiscardedSolutions) {
+						if(++discSol == maxDiscardedSolutions) {
+							GAout << "Warning: The algorithm may be stuck. Most sampled chromosomes can not be evaluated!" << std::endl;
+						}
+						++childIt;
+					} else {
+						unevaluable.push_back(*childIt);
+						finished.push_back(*childIt);
+						childIt = pending.erase(childIt);
+					}
+					continue;
+				}
+
+				(*childIt)->setFitness(batchFitness[i]);
+
+				if(batchFitness[i] < minFitness) {
+					minFitness = batchFitness[i];
+				}
+
+				this->addChromosomeToElite(**childIt);
+				finished.push_back(*childIt);
+				childIt = pending.erase(childIt);
+			}
+
+			subsets.clear();
+
+			if(this->checkUserInterrupt && eda_check_interrupt()) {
+				this->interrupted = true;
+			}
+		}
+
+		if(!pending.empty()) {
+			/* Interrupted before the generation was complete */
+			break;
+		}
+
+		for(childIt = unevaluable.begin(); childIt != unevaluable.end(); ++childIt) {
+			(*childIt)->setFitness(minFitness);
+		}
+
+		this->updateCurrentGeneration(newGeneration, minFitness, (generation == 0));
+		this->publishProgress(generation, numEvaluations);
+
+		if(this->printsGenerations()) {
+			this->printCurrentGeneration();
+		}
+
+		/*
+		 * Update the model from the best chromosomes of this generation
+		 */
+		std::partial_sort(newGeneration.begin(), newGeneration.begin() + numSelected, newGeneration.end(), OrderChromosomePtr());
+
+		std::fill(selectedCounts.begin(), selectedCounts.end(), 0.0);
+		for(childIt = newGeneration.begin(); childIt != newGeneration.begin() + numSelected; ++childIt) {
+			(*childIt)->addToInclusionCounts(selectedCounts);
+		}
+
+		model.update(selectedCounts, numSelected);
+	}
+
+	for(ChVecIt it = newGeneration.begin(); it != newGeneration.end(); ++it) {
+		delete *it;
+	}
+}
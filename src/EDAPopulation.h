@@ -0,0 +1,45 @@
+//
+//  EDAPopulation.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_EDAPopulation_h
+#define gaselect_EDAPopulation_h
+
+#include "config.h"
+#include <vector>
+
+#include "Evaluator.h"
+#include "Control.h"
+#include "Population.h"
+
+/**
+ * Estimation-of-distribution algorithm (PBIL, or UMDA if the learning rate is 1).
+ *
+ * Instead of mating chromosomes, every generation is sampled from a vector of inclusion
+ * probabilities (see EDAModel), which is then moved towards the inclusion frequencies of
+ * the best chromosomes of the generation. The mutation and crossover settings are not used.
+ */
+class EDAPopulation : public Population {
+public:
+	/**
+	 * @param checkUserInterrupt If false, the population does not check for user interrupts.
+	 *			This must be used if the population is not run in the main R thread.
+	 */
+	EDAPopulation(const Control &ctrl, ::Evaluator &evaluator, const std::vector<uint32_t> &seed, bool checkUserInterrupt = true);
+	~EDAPopulation() {};
+
+	void run();
+private:
+	const bool checkUserInterrupt;
+
+	class OrderChromosomePtr : public std::binary_function<Chromosome*, Chromosome*, bool> {
+	public:
+		bool operator()(const Chromosome* const ch1, const Chromosome* const ch2) {
+			return ch1->isFitterThan(*ch2);
+		};
+	};
+};
+
+#endif
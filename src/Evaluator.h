@@ -11,10 +11,14 @@
 
 #include "config.h"
 #include <vector>
+#include <limits>
+#include <stdexcept>
 #include <RcppArmadillo.h>
 #include "Control.h"
 #include "Chromosome.h"
 #include "RNG.h"
+#include "HardwareCounters.h"
+#include "LocalityOrder.h"
 
 class Evaluator {
 public:
@@ -24,19 +28,128 @@ public:
 		virtual ~EvaluatorException() throw() {};
 	};
 
-	Evaluator(const VerbosityLevel verbosity) : verbosity(verbosity) {}
+	/**
+	 * Statistics of the caches used by the evaluators
+	 */
+	struct CacheStatistics {
+		uint64_t lookups;
+		uint64_t hits;
+		size_t bytes;
+
+		CacheStatistics() : lookups(0), hits(0), bytes(0) {}
+
+		/* NaN if no cache was used */
+		double hitRate() const {
+			return (this->lookups > 0) ? (double) this->hits / (double) this->lookups : std::numeric_limits<double>::quiet_NaN();
+		}
+	};
+
+	Evaluator(const VerbosityLevel verbosity) : verbosity(verbosity), hwCounters(NULL) {}
 	virtual ~Evaluator() {};
 
 	virtual double evaluate(arma::uvec &columnSubset) = 0;
 	virtual double evaluate(Chromosome &ch) = 0;
+
+	/**
+	 * Evaluate a batch of variable subsets at once.
+	 * The subsets are evaluated in locality order (see LocalityOrder), the fitness is in the original order.
+	 * Subsets that can not be evaluated get a fitness of NaN.
+	 *
+	 * @param columnSubsets The variable subsets (they are not modified)
+	 * @param fitness Is resized to hold the fitness of every subset
+	 */
+	virtual void evaluateBatch(const std::vector<arma::uvec> &columnSubsets, std::vector<double> &fitness) {
+		const std::vector<size_t> order = LocalityOrder::order(columnSubsets);
+
+		fitness.assign(columnSubsets.size(), std::numeric_limits<double>::quiet_NaN());
+
+		for(std::vector<size_t>::const_iterator it = order.begin(); it != order.end(); ++it) {
+			const size_t i = *it;
+			/* evaluate() may change the subset */
+			arma::uvec columnSubset(columnSubsets[i]);
+
+			try {
+				fitness[i] = this->evaluate(columnSubset);
+			} catch(const EvaluatorException &ee) {
+				fitness[i] = std::numeric_limits<double>::quiet_NaN();
+			}
+		}
+	}
 	
 	virtual Evaluator* clone() const = 0;
 
+	/**
+	 * Create a copy of the evaluator that does not share any state (statistics, best subsets, ...)
+	 * with this evaluator or its clones, e.g., for evaluations that must not influence the search.
+	 */
+	virtual Evaluator* cloneIndependent() const {
+		return this->clone();
+	}
+
+	/**
+	 * Create a copy of the evaluator for the same X matrix but a different response y.
+	 * Everything that only depends on X (the data itself, the segmentation, ...) is shared
+	 * or copied, only the parts depending on y are recomputed.
+	 *
+	 * @throws std::logic_error if the evaluator does not support a different response
+	 */
+	virtual Evaluator* cloneWithResponse(const arma::vec &y) const {
+		throw std::logic_error("The evaluator does not support evaluating a different response");
+	}
+
+	/**
+	 * Create a copy of the evaluator for the same data, but where every observation is used as often
+	 * as given by its (integer) weight, e.g., for a bootstrap resample. The data is not copied.
+	 * If the evaluator uses a segmentation, it is built anew for the weighted observations,
+	 * keeping all copies of an observation in the same segment.
+	 *
+	 * @param rowWeights The weight of every observation
+	 * @param seed The seed for the segmentation
+	 * @throws std::logic_error if the evaluator does not support weighted observations
+	 */
+	virtual Evaluator* cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const {
+		throw std::logic_error("The evaluator does not support weighted observations");
+	}
+
+	/**
+	 * Replace the segmentation of the observations by a new one drawn with the given seed.
+	 * Subsequent evaluations estimate the fitness from a different split of the data.
+	 *
+	 * @throws std::logic_error if the evaluator does not use a segmentation
+	 */
+	virtual void reseedSegmentation(const std::vector<uint32_t> &seed) {
+		throw std::logic_error("The evaluator does not use a segmentation");
+	}
+
 	virtual std::vector<arma::uvec> getSegmentation() const {
 		return std::vector<arma::uvec>();
 	}
+
+	/**
+	 * Add the statistics of the evaluator's cache (if it uses one)
+	 */
+	virtual void addCacheStatistics(CacheStatistics &stats) const {}
 protected:
 	const VerbosityLevel verbosity;
+
+	/* The hardware counters of the evaluating thread (NULL if no hardware profile is active) */
+	HardwareCounters *hwCounters;
+
+	/**
+	 * Start attributing the hardware counters to the phases of an evaluation
+	 */
+	void beginPhases() {
+		this->hwCounters = HardwareProfile::countersForCurrentThread();
+		if(this->hwCounters != NULL) {
+			this->hwCounters->begin();
+		}
+	}
+
+	void endPhase(HardwareCounters::Phase phase) {
+		if(this->hwCounters != NULL) {
+			this->hwCounters->mark(phase);
+		}
+	}
 };
 
 
@@ -8,20 +8,33 @@
 #include <RcppArmadillo.h>
 #include <set>
 #include <memory>
+#include <algorithm>
 
 #include "Logger.h"
 #include "Chromosome.h"
 #include "Control.h"
 #include "PLS.h"
+#include "PLSModel.h"
 #include "UserFunEvaluator.h"
 #include "PLSEvaluator.h"
 #include "LMEvaluator.h"
 #include "BICEvaluator.h"
+#include "CascadeEvaluator.h"
+#include "CompiledFunEvaluator.h"
+#include "UserFunWorkerEvaluator.h"
 #include "SingleThreadPopulation.h"
+#include "EDAPopulation.h"
+#include "PermutationTest.h"
+#include "StabilitySelection.h"
 #include "RNG.h"
+#include "UnivariateRelevance.h"
+#include "SimdKernels.h"
+#include "HardwareCounters.h"
+#include "MemoryBudget.h"
 
 #ifdef HAVE_PTHREAD_H
 #include "MultiThreadedPopulation.h"
+#include "ThreadTuner.h"
 #endif
 
 #include "GenAlg.h"
@@ -34,7 +47,12 @@ using namespace Rcpp;
 static const R_CallMethodDef exportedCallMethods[] = {
     {"C_genAlgPLS", (DL_FUNC) &genAlgPLS, 4},
     {"C_evaluate", (DL_FUNC) &evaluate, 5},
+    {"C_createEvaluatorHandle", (DL_FUNC) &createEvaluatorHandle, 4},
     {"C_simpls", (DL_FUNC) &simpls, 5},
+    {"C_fitPLSModel", (DL_FUNC) &fitPLSModel, 5},
+    {"C_predictPLSModel", (DL_FUNC) &predictPLSModel, 5},
+    {"C_permutationTest", (DL_FUNC) &permutationTest, 5},
+    {"C_stabilitySelection", (DL_FUNC) &stabilitySelection, 6},
     {NULL, NULL, 0}
 };
 
@@ -44,195 +62,1228 @@ extern "C" void R_init_gaselect(DllInfo *dll)
     R_registerRoutines(dll, NULL, exportedCallMethods, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
     R_forceSymbols(dll, TRUE);
+
+    SimdKernels::init();
+}
+
+/**
+ * Create the control object from the control list
+ */
+static Control createControl(const List &control, uint16_t numThreads, VerbosityLevel verbosity, const std::string &telemetryFile, const std::string &snapshotFile) {
+	return Control(as<uint16_t>(control["chromosomeSize"]),
+				 as<uint16_t>(control["populationSize"]),
+				 as<uint16_t>(control["numGenerations"]),
+				 as<uint16_t>(control["elitism"]),
+				 as<uint16_t>(control["minVariables"]),
+				 as<uint16_t>(control["maxVariables"]),
+				 as<double>(control["mutationProb"]),
+				 numThreads,
+				 as<uint16_t>(control["maxDuplicateEliminationTries"]),
+				 as<double>(control["badSolutionThreshold"]),
+				 (CrossoverType) as<int>(control["crossover"]),
+				 (FitnessScaling) as<int>(control["fitnessScaling"]),
+				 verbosity,
+				 telemetryFile,
+				 (MutationWeighting) as<int>(control["mutationWeighting"]),
+				 (SearchEngine) as<int>(control["engine"]),
+				 as<double>(control["learningRate"]),
+				 as<double>(control["selectionRatio"]),
+				 as<std::vector<uint16_t> >(control["freeColumns"]),
+				 as<std::vector<uint16_t> >(control["forcedColumns"]),
+				 as<uint16_t>(control["numColumns"]),
+				 as<uint16_t>(control["minPopulationSize"]),
+				 (IdleTask) as<int>(control["idleTask"]),
+				 (EvaluationOrder) as<int>(control["evaluationOrder"]),
+				 snapshotFile,
+				 as<uint16_t>(control["snapshotInterval"]));
+}
+
+/**
+ * The univariate relevance of the variables spanned by the chromosomes
+ */
+static std::vector<double> univariateWeights(const Control &ctrl, const arma::mat &X, const arma::vec &y) {
+	if(ctrl.freeColumns.empty()) {
+		return UnivariateRelevance(X)(y);
+	}
+
+	arma::uvec freeColumns(ctrl.freeColumns.size());
+	for(arma::uword j = 0; j < freeColumns.n_elem; ++j) {
+		freeColumns[j] = ctrl.freeColumns[j];
+	}
+
+	return UnivariateRelevance(arma::mat(X.cols(freeColumns)))(y);
+}
+
+/**
+ * Create the evaluator for the user supplied R function. If the control list names a directory
+ * for worker processes, the function is evaluated in R worker processes (one per thread).
+ */
+static ::Evaluator* createUserFunEvaluator(const List &control, arma::uword numColumns, VerbosityLevel verbosity) {
+	if(control.containsElementNamed("workerDir")) {
+#ifdef HAVE_USER_FUN_WORKERS
+		std::shared_ptr<UserFunWorkerPool> pool(new UserFunWorkerPool(as<std::string>(control["workerCommand"]),
+																	   as<std::string>(control["workerDir"]), numColumns,
+																	   as<uint16_t>(control["numThreads"])));
+		return new UserFunWorkerEvaluator(pool, verbosity);
+#else
+		GAerr << "Warning: R worker processes are not supported on this system" << std::endl;
+#endif
+	}
+
+	return new UserFunEvaluator(as<Rcpp::Function>(control["userEvalFunction"]), verbosity);
+}
+
+/**
+ * Create the evaluator for the compiled fitness function given in the control list
+ */
+static ::Evaluator* createCompiledFunEvaluator(const List &control, SEXP SX, SEXP Sy, VerbosityLevel verbosity) {
+	SEXP fitnessFunction = control["fitnessFunction"];
+	void *state = NULL;
+
+	if(TYPEOF(fitnessFunction) != EXTPTRSXP || R_ExternalPtrAddr(fitnessFunction) == NULL) {
+		throw Rcpp::exception("The compiled evaluation function is not available (external pointers do not survive saving and loading).", __FILE__, __LINE__);
+	}
+
+	if(control.containsElementNamed("fitnessState")) {
+		SEXP fitnessState = control["fitnessState"];
+		if(TYPEOF(fitnessState) == EXTPTRSXP) {
+			state = R_ExternalPtrAddr(fitnessState);
+		}
+	}
+
+	Rcpp::NumericMatrix XMat(SX);
+	Rcpp::NumericMatrix YMat(Sy);
+	arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
+	arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
+
+	return new CompiledFunEvaluator(X, Y.col(0), *static_cast<gaselect_fitness_fun*>(R_ExternalPtrAddr(fitnessFunction)),
+									state, verbosity);
+}
+
+/**
+ * The control list of a stage of the cascade: the control list overridden by the settings of the stage
+ */
+static List stageControlList(const List &control, const List &stage) {
+	List stageControl = Rcpp::clone(control);
+	std::vector<std::string> names = as<std::vector<std::string> >(stage.names());
+
+	for(int i = 0; i < stage.size(); ++i) {
+		SEXP value = stage[i];
+		if(stageControl.containsElementNamed(names[i].c_str())) {
+			stageControl[names[i]] = value;
+		} else {
+			stageControl.push_back(value, names[i]);
+		}
+	}
+
+	return stageControl;
+}
+
+/**
+ * Add the memory used by the evaluator specified in the control list to the estimate.
+ * User supplied functions work on the data owned by R (resp. the R worker processes).
+ */
+static void estimateEvaluatorMemory(const List &control, double numRows, double numColumns, MemoryBudget::Estimate &estimate) {
+	EvaluatorClass evalClass = (EvaluatorClass) as<int>(control["evaluatorClass"]);
+	const double maxVariables = as<double>(control["maxVariables"]) + Rf_length(control["forcedColumns"]);
+	const double doubleBytes = sizeof(double);
+	const double indexBytes = sizeof(arma::uword);
+
+	switch(evalClass) {
+		case PLS_EVAL: {
+			const double maxNComp = as<double>(control["maxNComp"]);
+
+			/* Every replication splits all rows into the outer and the inner segments */
+			estimate.sharedBytes += doubleBytes * numRows * (numColumns + 1);
+			estimate.threadBytes += indexBytes * numRows * as<double>(control["numReplications"]) * as<double>(control["outerSegments"])
+				* (as<double>(control["innerSegments"]) + 1);
+			estimate.threadBytes += doubleBytes * (numRows * (2 * maxVariables + 1) + 4 * maxVariables * maxNComp);
+			break;
+		}
+		case PLS_FIT: {
+			const double maxNComp = as<double>(control["maxNComp"]);
+
+			estimate.sharedBytes += doubleBytes * numRows * (numColumns + 1);
+			estimate.threadBytes += indexBytes * numRows * as<double>(control["innerSegments"]);
+			estimate.threadBytes += doubleBytes * (numRows * (2 * maxVariables + 1) + 4 * maxVariables * maxNComp);
+			break;
+		}
+		case LM: {
+			/* The design matrix includes the intercept */
+			estimate.sharedBytes += doubleBytes * numRows * (numColumns + 2);
+			estimate.threadBytes += doubleBytes * (numRows * (maxVariables + 1) + (maxVariables + 1) * (maxVariables + 1));
+			estimate.cacheBytes += as<double>(control["crossprodCacheSize"]) * 1024 * 1024;
+			break;
+		}
+		case CASCADE: {
+			List stageLists = control["stages"];
+
+			for(int s = 0; s < stageLists.size(); ++s) {
+				estimateEvaluatorMemory(stageControlList(control, stageLists[s]), numRows, numColumns, estimate);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+/**
+ * Create the evaluator specified in the control list
+ * X and y are ignored if a user supplied function is used for evaluation.
+ */
+static std::unique_ptr<::Evaluator> createEvaluator(const List &control, SEXP SX, SEXP Sy, const std::vector<uint32_t> &seed,
+	VerbosityLevel verbosity) {
+	std::unique_ptr<::Evaluator> eval;
+	std::unique_ptr<PLS> pls;
+	EvaluatorClass evalClass = (EvaluatorClass) as<int>(control["evaluatorClass"]);
+
+	switch(evalClass) {
+		case USER: {
+			eval.reset(createUserFunEvaluator(control, as<uint16_t>(control["numColumns"]), verbosity));
+			break;
+		}
+		case PLS_EVAL: {
+			Rcpp::NumericMatrix XMat(SX);
+			Rcpp::NumericMatrix YMat(Sy);
+			arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
+			arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
+			PLSMethod method = (PLSMethod) as<int>(control["plsMethod"]);
+
+			pls = PLS::getInstance(method, X, Y.col(0));
+
+			eval.reset(new PLSEvaluator(std::move(pls), as<uint16_t>(control["numReplications"]),
+                               as<uint16_t>(control["maxNComp"]), seed, verbosity,
+                               as<uint16_t>(control["innerSegments"]),
+                               as<uint16_t>(control["outerSegments"]),
+                               as<double>(control["testSetSize"]),
+                               as<double>(control["sdfact"]),
+                               as<uint16_t>(control["earlyStop"])));
+
+			break;
+		}
+		case PLS_FIT: {
+			Rcpp::NumericMatrix XMat(SX);
+			Rcpp::NumericMatrix YMat(Sy);
+			arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
+			arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
+			PLSMethod method = (PLSMethod) as<int>(control["plsMethod"]);
+
+			pls = PLS::getInstance(method, X, Y.col(0));
+
+			BICEvaluator::Statistic stat = (BICEvaluator::Statistic) as<int>(control["statistic"]);
+
+			eval.reset(new BICEvaluator(std::move(pls),
+                               as<uint16_t>(control["maxNComp"]),
+                               seed,
+                               verbosity,
+                               as<uint16_t>(control["innerSegments"]),
+                               stat,
+                               as<double>(control["sdfact"]),
+                               as<uint16_t>(control["earlyStop"])));
+
+			break;
+		}
+		case LM: {
+			Rcpp::NumericMatrix XMat(SX);
+			Rcpp::NumericMatrix YMat(Sy);
+			arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
+			arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
+			arma::colvec y = Y.col(0);
+
+			LMEvaluator::Statistic stat = (LMEvaluator::Statistic) as<int>(control["statistic"]);
+			arma::uvec forcedColumns = as<arma::uvec>(control["forcedColumns"]);
+			double cacheSize = as<double>(control["crossprodCacheSize"]);
+
+			/* The memory budget may only allow a part of the requested cache */
+			if(control.containsElementNamed("cacheFraction")) {
+				cacheSize *= as<double>(control["cacheFraction"]);
+			}
+
+			eval.reset(new LMEvaluator(X, y, stat, verbosity, true, (size_t) (cacheSize * 1024 * 1024), forcedColumns));
+
+			break;
+		}
+		case CASCADE: {
+			/*
+			 * Every stage is created from the control list, overridden by the settings of the stage
+			 */
+			List stageLists = control["stages"];
+			std::vector<std::unique_ptr<::Evaluator> > stages;
+
+			for(int s = 0; s < stageLists.size(); ++s) {
+				stages.push_back(createEvaluator(stageControlList(control, stageLists[s]), SX, Sy, seed, verbosity));
+			}
+
+			eval.reset(new CascadeEvaluator(stages, as<std::vector<double> >(control["thresholds"]),
+											as<uint16_t>(control["referenceSize"]), verbosity));
+			break;
+		}
+		case USER_COMPILED: {
+			eval.reset(createCompiledFunEvaluator(control, SX, Sy, verbosity));
+			break;
+		}
+		default:
+			throw Rcpp::exception("No valid evaluation method was selected.", __FILE__, __LINE__);
+			break;
+	}
+
+	return eval;
+}
+
+/**
+ * An evaluator that is kept alive between calls from R (as an external pointer), together with
+ * the data it uses. The data and the control list are protected from the garbage collector as long
+ * as the handle exists, so evaluators that do not copy the data (e.g., compiled functions) stay valid.
+ */
+class EvaluatorHandle {
+public:
+	EvaluatorHandle(const List &control, SEXP SX, SEXP Sy, const std::vector<uint32_t> &seed, VerbosityLevel verbosity) :
+		control(control), X(SX), Y(Sy)
+	{
+		this->eval = createEvaluator(this->control, this->X, this->Y, seed, verbosity);
+	}
+
+	::Evaluator& getEvaluator() const {
+		return *this->eval;
+	}
+
+	arma::uword getNumColumns() const {
+		return this->X.ncol();
+	}
+
+	/**
+	 * Get the handle from the external pointer created by `createEvaluatorHandle`
+	 */
+	static EvaluatorHandle& get(SEXP Shandle) {
+		if(TYPEOF(Shandle) != EXTPTRSXP || R_ExternalPtrAddr(Shandle) == NULL) {
+			throw Rcpp::exception("The evaluator handle is not valid anymore (external pointers do not survive saving and loading).", __FILE__, __LINE__);
+		}
+
+		return *Rcpp::XPtr<EvaluatorHandle>(Shandle);
+	}
+
+private:
+	const List control;
+	const Rcpp::NumericMatrix X;
+	const Rcpp::NumericMatrix Y;
+	std::unique_ptr<::Evaluator> eval;
+
+	EvaluatorHandle(const EvaluatorHandle&);
+	EvaluatorHandle& operator=(const EvaluatorHandle&);
+};
+
+/**
+ * Convert the hardware counters of all threads to a list with one entry per thread and phase
+ * (events that are not available are NA)
+ */
+static Rcpp::List hardwareCountersToList(const HardwareProfile &profile) {
+	const int numRows = (int) profile.getNumThreads() * HardwareCounters::NUM_PHASES;
+	Rcpp::IntegerVector thread(numRows);
+	Rcpp::CharacterVector phase(numRows);
+	Rcpp::NumericVector occurrences(numRows);
+	Rcpp::NumericVector events[HardwareCounters::NUM_EVENTS];
+	int row = 0, workerThread = 0;
+	bool available = false;
+
+	for(uint8_t e = 0; e < HardwareCounters::NUM_EVENTS; ++e) {
+		events[e] = Rcpp::NumericVector(numRows);
+	}
+
+	for(size_t t = 0; t < profile.getNumThreads(); ++t) {
+		const HardwareCounters &counters = profile.getCounters(t);
+		int threadId = profile.isMainThread(t) ? 0 : ++workerThread;
+
+		if(counters.isAvailable()) {
+			available = true;
+		}
+
+		for(uint8_t p = 0; p < HardwareCounters::NUM_PHASES; ++p, ++row) {
+			thread[row] = threadId;
+			phase[row] = HardwareCounters::getPhaseName((HardwareCounters::Phase) p);
+			occurrences[row] = (double) counters.getOccurrences((HardwareCounters::Phase) p);
+
+			for(uint8_t e = 0; e < HardwareCounters::NUM_EVENTS; ++e) {
+				if(counters.isEventAvailable((HardwareCounters::Event) e)) {
+					events[e][row] = counters.getTotal((HardwareCounters::Phase) p, (HardwareCounters::Event) e);
+				} else {
+					events[e][row] = NA_REAL;
+				}
+			}
+		}
+	}
+
+	if(profile.getNumThreads() == 0) {
+		GAerr << "Warning: Hardware counters are only collected for the built-in evaluators" << std::endl;
+	} else if(!available) {
+		GAerr << "Warning: Hardware counters are not available (" << profile.getCounters(0).getError() << ")" << std::endl;
+	}
+
+	return Rcpp::List::create(Rcpp::Named("thread") = thread,
+							  Rcpp::Named("phase") = phase,
+							  Rcpp::Named("occurrences") = occurrences,
+							  Rcpp::Named("cycles") = events[HardwareCounters::EVENT_CYCLES],
+							  Rcpp::Named("instructions") = events[HardwareCounters::EVENT_INSTRUCTIONS],
+							  Rcpp::Named("cacheMisses") = events[HardwareCounters::EVENT_CACHE_MISSES],
+							  Rcpp::Named("branchMisses") = events[HardwareCounters::EVENT_BRANCH_MISSES]);
+}
+
+/**
+ * Convert the statistics of the stages of a cascade to a list (to be turned into a data frame in R)
+ */
+static Rcpp::List cascadeStatisticsToList(const CascadeEvaluator &cascade) {
+	const std::vector<CascadeEvaluator::StageStatistics> stats = cascade.getStageStatistics();
+	Rcpp::IntegerVector stage(stats.size());
+	Rcpp::NumericVector evaluated(stats.size());
+	Rcpp::NumericVector passed(stats.size());
+	Rcpp::NumericVector passRate(stats.size());
+
+	for(size_t s = 0; s < stats.size(); ++s) {
+		stage[s] = (int) s + 1;
+		evaluated[s] = (double) stats[s].evaluated;
+		passed[s] = (double) stats[s].passed;
+		passRate[s] = (stats[s].evaluated > 0) ? passed[s] / evaluated[s] : NA_REAL;
+	}
+
+	return Rcpp::List::create(Rcpp::Named("stage") = stage,
+							  Rcpp::Named("evaluated") = evaluated,
+							  Rcpp::Named("passed") = passed,
+							  Rcpp::Named("passRate") = passRate);
+}
+
+/**
+ * Convert the cache statistics to a list (to be turned into a data frame in R)
+ */
+static Rcpp::List cacheStatisticsToList(const ::Evaluator::CacheStatistics &stats) {
+	return Rcpp::List::create(Rcpp::Named("lookups") = (double) stats.lookups,
+							  Rcpp::Named("hits") = (double) stats.hits,
+							  Rcpp::Named("hitRate") = stats.hitRate(),
+							  Rcpp::Named("bytes") = (double) stats.bytes);
+}
+
+/**
+ * Convert the decisions of the memory budget and the peak memory usage to a list (to be turned into a data frame in R)
+ */
+static Rcpp::List memoryToList(const MemoryBudget &budget) {
+	return Rcpp::List::create(Rcpp::Named("limit") = budget.getLimitBytes() / (1024.0 * 1024.0),
+							  Rcpp::Named("estimated") = budget.getEstimatedBytes() / (1024.0 * 1024.0),
+							  Rcpp::Named("peak") = MemoryBudget::peakResidentBytes() / (1024.0 * 1024.0),
+							  Rcpp::Named("numThreads") = (int) budget.getNumThreads(),
+							  Rcpp::Named("cacheFraction") = budget.getCacheFraction());
+}
+
+#ifdef HAVE_PTHREAD_H
+/**
+ * Fingerprint of the data and all settings that affect the cost of an evaluation
+ */
+static uint64_t dataFingerprint(const List &control, SEXP SX, SEXP Sy) {
+	static const char* const settings[] = {
+		"evaluatorClass", "numReplications", "innerSegments", "outerSegments", "testSetSize", "plsMethod",
+		"maxNComp", "earlyStop", "statistic", "crossprodCacheSize", "referenceSize", "minVariables", "maxVariables",
+		"chromosomeSize", NULL
+	};
+	Rcpp::NumericMatrix XMat(SX);
+	Rcpp::NumericMatrix YMat(Sy);
+	int dims[2] = { XMat.nrow(), XMat.ncol() };
+	uint64_t hash = ThreadTuner::fingerprint(dims, sizeof(dims));
+
+	hash = ThreadTuner::fingerprint(XMat.begin(), XMat.nrow() * XMat.ncol() * sizeof(double), hash);
+	hash = ThreadTuner::fingerprint(YMat.begin(), YMat.nrow() * sizeof(double), hash);
+
+	for(const char* const *setting = settings; *setting != NULL; ++setting) {
+		double value = control.containsElementNamed(*setting) ? as<double>(control[*setting]) : 0.0;
+		hash = ThreadTuner::fingerprint(&value, sizeof(value), hash);
+	}
+
+	return hash;
+}
+
+/**
+ * Convert the trials of the thread tuner to a list (to be turned into a data frame in R)
+ */
+static Rcpp::List threadTuningToList(const ThreadTuner &tuner, uint16_t numThreads) {
+	const std::vector<ThreadTuner::Trial> &trials = tuner.getTrials();
+	Rcpp::IntegerVector threads(trials.size());
+	Rcpp::NumericVector throughput(trials.size());
+	Rcpp::LogicalVector selected(trials.size());
+
+	for(size_t i = 0; i < trials.size(); ++i) {
+		threads[i] = trials[i].numThreads;
+		throughput[i] = trials[i].throughput;
+		selected[i] = (trials[i].numThreads == numThreads);
+	}
+
+	return Rcpp::List::create(Rcpp::Named("numThreads") = threads,
+							  Rcpp::Named("throughput") = throughput,
+							  Rcpp::Named("selected") = selected,
+							  Rcpp::Named("cached") = Rcpp::LogicalVector(trials.size(), tuner.isCached()));
+}
+#endif
+
+/**
+ * Create the population for the engine given in the control object, seed the elite and run it
+ */
+static std::unique_ptr<Population> runPopulation(const Control &ctrl, ::Evaluator &eval, const std::vector<uint32_t> &seed,
+												 const std::vector<double> &variableWeights, const std::vector<arma::uvec> &eliteSeeds) {
+	std::unique_ptr<Population> pop;
+
+	if(ctrl.engine == ENGINE_EDA) {
+		if(ctrl.numThreads > 1) {
+			GAerr << "Warning: The EDA engine evaluates all chromosomes in a single thread" << std::endl;
+		}
+		pop.reset(new EDAPopulation(ctrl, eval, seed));
+		pop->seedElite(eliteSeeds);
+		pop->run();
+	} else {
+#ifdef HAVE_PTHREAD_H
+		try {
+			if(ctrl.numThreads > 1) {
+				pop.reset(new MultiThreadedPopulation(ctrl, eval, seed));
+			} else {
+				pop.reset(new SingleThreadPopulation(ctrl, eval, seed));
+			}
+			pop->setVariableWeights(variableWeights);
+			pop->seedElite(eliteSeeds);
+			pop->run();
+		} catch(MultiThreadedPopulation::ThreadingError& te) {
+			if(ctrl.verbosity >= DEBUG_GA) {
+				throw te;
+			} else {
+				throw Rcpp::exception("Multithreading could not be initialized. Set numThreads to 0 to avoid this problem.", __FILE__, __LINE__);
+			}
+		}
+#else
+		pop.reset(new SingleThreadPopulation(ctrl, eval, seed));
+		pop->setVariableWeights(variableWeights);
+		pop->seedElite(eliteSeeds);
+		pop->run();
+#endif
+	}
+
+	return pop;
+}
+
+/**
+ * Run the coarse stage of the multi-resolution search: the genetic algorithm is run on the
+ * super-variables formed by the means of `binSize` adjacent columns. Afterwards the bins selected by the
+ * best subsets are expanded to full resolution.
+ *
+ * @param fineControl Is set to the control list for the fine stage (the chromosome only spans the columns
+ *			of the selected bins)
+ * @param eliteSeeds Is filled with the best coarse subsets at full resolution (the center column of every bin)
+ *			to seed the fine stage
+ * @param fitnessEvolution The fitness evolution of the coarse stage is appended
+ * @return false if the coarse stage was interrupted
+ */
+static bool runCoarseStage(const List &control, SEXP SX, SEXP Sy, const std::vector<uint32_t> &seed, uint16_t numThreads,
+						   VerbosityLevel verbosity, List &fineControl, std::vector<arma::uvec> &eliteSeeds,
+						   std::vector<double> &fitnessEvolution) {
+	Rcpp::NumericMatrix XMat(SX);
+	Rcpp::NumericMatrix YMat(Sy);
+	const arma::uword numColumns = XMat.ncol();
+	const arma::uword binSize = (arma::uword) as<int>(control["binSize"]);
+	const arma::uword numBins = (numColumns + binSize - 1) / binSize;
+	const uint16_t numGenerations = as<uint16_t>(control["numGenerations"]);
+	const uint16_t coarseGenerations = as<uint16_t>(control["coarseGenerations"]);
+	arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
+	arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
+	std::vector<double> variableWeights;
+	arma::uword bin, first, last, i;
+
+	/*
+	 * The binned data is computed only once
+	 */
+	Rcpp::NumericMatrix XBinnedMat(XMat.nrow(), numBins);
+	arma::mat XBinned(XBinnedMat.begin(), XBinnedMat.nrow(), XBinnedMat.ncol(), false);
+
+	for(bin = 0; bin < numBins; ++bin) {
+		first = bin * binSize;
+		last = std::min(first + binSize, numColumns) - 1;
+		XBinned.col(bin) = arma::mean(X.cols(first, last), 1);
+	}
+
+	List coarseControl = Rcpp::clone(control);
+	coarseControl["chromosomeSize"] = (int) numBins;
+	coarseControl["numColumns"] = (int) numBins;
+	coarseControl["numGenerations"] = (int) coarseGenerations;
+	if(verbosity >= ON) {
+		GAout << "Coarse stage: " << numBins << " bins of " << binSize << " variables" << std::endl;
+	}
+
+	std::unique_ptr<::Evaluator> eval = createEvaluator(coarseControl, XBinnedMat, Sy, seed, verbosity);
+	/* The snapshots only cover the full resolution (the bins would not fit the header of the file) */
+	Control ctrl = createControl(coarseControl, numThreads, verbosity, as<std::string>(control["telemetryFile"]), std::string());
+
+	if(ctrl.mutationWeighting == MUTATION_UNIVARIATE) {
+		variableWeights = univariateWeights(ctrl, XBinned, Y.col(0));
+	}
+
+	std::unique_ptr<Population> pop = runPopulation(ctrl, *eval, seed, variableWeights, std::vector<arma::uvec>());
+	fitnessEvolution.insert(fitnessEvolution.end(), pop->getFitnessEvolution().begin(), pop->getFitnessEvolution().end());
+
+	if(pop->wasInterrupted()) {
+		return false;
+	}
+
+	/*
+	 * Expand the bins of the best subsets. If these are too few columns for the maximum
+	 * number of variables, the bins of the next best subsets are added. If all subsets in the
+	 * result are used up, the remaining bins are added in the order of how many of the resulting
+	 * subsets contain them.
+	 */
+	Population::SortedChromosomes result = pop->getResult();
+	std::vector<bool> binSelected(numBins, false);
+	std::vector<uint32_t> binCount(numBins, 0);
+	std::vector<arma::uvec> coarseSubsets;
+	arma::uword numFineColumns = 0;
+	const size_t numSeeds = std::max<size_t>(ctrl.elitism, 1);
+
+	for(Population::SortedChromosomes::iterator it = result.begin(); it != result.end(); ++it) {
+		arma::uvec subset = it->toColumnSubset();
+		for(i = 0; i < subset.n_elem; ++i) {
+			++binCount[subset[i]];
+		}
+	}
+
+	for(Population::SortedChromosomes::reverse_iterator it = result.rbegin(); it != result.rend(); ++it) {
+		if(coarseSubsets.size() >= numSeeds && numFineColumns > ctrl.maxVariables) {
+			break;
+		}
+
+		coarseSubsets.push_back(it->toColumnSubset());
+		for(i = 0; i < coarseSubsets.back().n_elem; ++i) {
+			bin = coarseSubsets.back()[i];
+			if(!binSelected[bin]) {
+				binSelected[bin] = true;
+				numFineColumns += std::min((bin + 1) * binSize, numColumns) - bin * binSize;
+			}
+		}
+	}
+
+	while(numFineColumns <= ctrl.maxVariables && numFineColumns < numColumns) {
+		arma::uword next = numBins;
+		for(bin = 0; bin < numBins; ++bin) {
+			if(!binSelected[bin] && (next == numBins || binCount[bin] > binCount[next])) {
+				next = bin;
+			}
+		}
+
+		binSelected[next] = true;
+		numFineColumns += std::min((next + 1) * binSize, numColumns) - next * binSize;
+	}
+
+	/* The position of the first column of every selected bin in the fine chromosome */
+	std::vector<uint16_t> freeColumns;
+	std::vector<arma::uword> binOffset(numBins, 0);
+
+	freeColumns.reserve(numFineColumns);
+	for(bin = 0; bin < numBins; ++bin) {
+		if(binSelected[bin]) {
+			binOffset[bin] = freeColumns.size();
+			last = std::min((bin + 1) * binSize, numColumns);
+			for(first = bin * binSize; first < last; ++first) {
+				freeColumns.push_back((uint16_t) first);
+			}
+		}
+	}
+
+	/* Seed the fine stage with the center column of every bin */
+	eliteSeeds.clear();
+	for(std::vector<arma::uvec>::iterator subset = coarseSubsets.begin(); subset != coarseSubsets.end() && eliteSeeds.size() < numSeeds; ++subset) {
+		arma::uvec positions(subset->n_elem);
+		for(i = 0; i < subset->n_elem; ++i) {
+			bin = (*subset)[i];
+			positions[i] = binOffset[bin] + (std::min((bin + 1) * binSize, numColumns) - bin * binSize) / 2;
+		}
+		eliteSeeds.push_back(positions);
+	}
+
+	if(verbosity >= ON) {
+		GAout << "Fine stage: " << freeColumns.size() << " of " << numColumns << " variables in "
+			<< std::count(binSelected.begin(), binSelected.end(), true) << " bins" << std::endl;
+	}
+
+	fineControl = Rcpp::clone(control);
+	fineControl["chromosomeSize"] = (int) freeColumns.size();
+	fineControl["freeColumns"] = Rcpp::wrap(freeColumns);
+	fineControl["numColumns"] = (int) numColumns;
+	fineControl["numGenerations"] = (int) (numGenerations - coarseGenerations);
+
+	/* Only if there are not more columns than variables (which the R code rules out) */
+	if(freeColumns.size() <= ctrl.maxVariables) {
+		fineControl["maxVariables"] = (int) freeColumns.size() - 1;
+		fineControl["minVariables"] = std::min<int>(as<int>(control["minVariables"]), (int) freeColumns.size() - 1);
+	}
+
+	return true;
+}
+
+RcppExport SEXP genAlgPLS(SEXP Scontrol, SEXP SX, SEXP Sy, SEXP Sseed) {
+	std::unique_ptr<::Evaluator> ownedEval;
+	::Evaluator *eval = NULL;
+	std::unique_ptr<Population> pop;
+	std::unique_ptr<HardwareProfile> hwProfile;
+	std::unique_ptr<MemoryBudget> budget;
+#ifdef HAVE_PTHREAD_H
+	std::unique_ptr<::Evaluator> tuningEval;
+	std::unique_ptr<ThreadTuner> tuner;
+#endif
+BEGIN_RCPP
+	List control = List(Scontrol);
+	uint32_t singleSeed = as<uint32_t>(Sseed);
+	std::vector<uint32_t> seed;
+	std::vector<double> variableWeights;
+	std::vector<arma::uvec> eliteSeeds;
+	std::vector<double> fitnessEvolution;
+	uint16_t numThreads = as<uint16_t>(control["numThreads"]);
+	VerbosityLevel verbosity = (VerbosityLevel) as<int>(control["verbosity"]);
+	EvaluatorClass evalClass = (EvaluatorClass) as<int>(control["evaluatorClass"]);
+
+#ifdef ENABLE_DEBUG_VERBOSITY
+	PLSEvaluator::counter = 0;
+#endif
+
+	if(numThreads > 1) {
+#ifdef HAVE_PTHREAD_H
+		if(evalClass == USER && !control.containsElementNamed("workerDir")) {
+			GAerr << "Warning: Multithreading is not available when using a user supplied R function for evaluation (a compiled function can be used instead)" << std::endl;
+		}
+#else
+		GAerr << "Warning: Threads are not supported on this system" << std::endl;
+		numThreads = 1;
+#endif
+	} else if(numThreads < 1) {
+		numThreads = 1;
+	}
+
+	/*
+	 * Fit the threads and the caches into the memory limit before anything is allocated
+	 */
+	if(as<double>(control["memoryLimit"]) > 0) {
+		MemoryBudget::Estimate estimate;
+		const double numRows = Rf_isNull(SX) ? 0.0 : (double) Rcpp::NumericMatrix(SX).nrow();
+		const double numColumns = Rf_isNull(SX) ? 0.0 : (double) Rcpp::NumericMatrix(SX).ncol();
+		const double chromosomeBytes = sizeof(Chromosome) + sizeof(IntChromosome) *
+			(as<double>(control["chromosomeSize"]) / (BITS_PER_BYTE * sizeof(IntChromosome)) + 1);
+
+		estimateEvaluatorMemory(control, numRows, numColumns, estimate);
+		estimate.populationBytes = 2 * chromosomeBytes * (as<double>(control["populationSize"]) + as<double>(control["elitism"]));
+
+		budget.reset(new MemoryBudget(as<double>(control["memoryLimit"]) * 1024 * 1024, estimate));
+		try {
+			budget->fit(numThreads);
+		} catch(const std::runtime_error &re) {
+			throw Rcpp::exception(re.what(), __FILE__, __LINE__);
+		}
+
+		if(verbosity >= ON && (budget->getNumThreads() < numThreads || budget->getCacheFraction() < 1.0)) {
+			GAout << "Memory limit: using " << budget->getNumThreads() << " thread(s)";
+			if(estimate.cacheBytes > 0) {
+				GAout << " and " << (100.0 * budget->getCacheFraction()) << "% of the cross-product cache";
+			}
+			GAout << std::endl;
+		}
+
+		numThreads = budget->getNumThreads();
+		control["cacheFraction"] = budget->getCacheFraction();
+	}
+
+	/*
+	 * Generate a common seed for the Population and the PLSEvaluator objects
+	 */
+	RNG rng(singleSeed);
+	seed.reserve(RNG::SEED_SIZE);
+	for(uint32_t i = 0; i < RNG::SEED_SIZE; ++i) {
+		seed.push_back(rng());
+	}
+
+	/*
+	 * The evaluator of a handle is reused with its data and segmentation, but every run works on an
+	 * independent clone, so the run does not depend on earlier runs (the best subsets and statistics
+	 * of a cascade, the cross-product cache and its statistics all start empty)
+	 */
+	if(control.containsElementNamed("evaluatorHandle")) {
+		ownedEval.reset(EvaluatorHandle::get(control["evaluatorHandle"]).getEvaluator().cloneIndependent());
+		eval = ownedEval.get();
+	} else {
+		ownedEval = createEvaluator(control, SX, Sy, seed, verbosity);
+		eval = ownedEval.get();
+	}
+
+	/*
+	 * The evaluators of all threads pick up the hardware counters while the profile exists
+	 */
+	if(as<bool>(control["hardwareCounters"])) {
+		hwProfile.reset(new HardwareProfile());
+	}
+
+	/*
+	 * Multi-resolution search: evolve the binned variables first and continue at full resolution
+	 * only within the selected bins
+	 */
+	if(as<int>(control["binSize"]) > 1) {
+		List fineControl;
+		if(runCoarseStage(control, SX, Sy, seed, numThreads, verbosity, fineControl, eliteSeeds, fitnessEvolution)) {
+			control = fineControl;
+		} else {
+			GAout << "Interrupted during the coarse stage - continuing at full resolution" << std::endl;
+		}
+	}
+
+#ifdef HAVE_PTHREAD_H
+	/*
+	 * Measure how many threads actually pay off (only the genetic algorithm uses threads).
+	 * The measurements use an independent clone, so they neither warm up the caches nor
+	 * change the best subsets and statistics of a cascade. In a multi-resolution search, the
+	 * threads are tuned for the fine stage (the coarse stage uses the maximum number of threads).
+	 */
+	if(as<bool>(control["autotuneThreads"]) && numThreads > 1 && evalClass != USER &&
+	   (SearchEngine) as<int>(control["engine"]) == ENGINE_GA) {
+		Control tuningCtrl = createControl(control, numThreads, OFF, std::string(), std::string());
+		tuningEval.reset(eval->cloneIndependent());
+		tuner.reset(new ThreadTuner(tuningCtrl, *tuningEval, dataFingerprint(control, SX, Sy)));
+
+		/* The measurements are not part of the hardware profile of the search */
+		if(hwProfile) {
+			hwProfile->suspend();
+		}
+		numThreads = tuner->tune(numThreads, seed);
+		if(hwProfile) {
+			hwProfile->resume();
+		}
+
+		if(verbosity >= ON) {
+			GAout << "Autotuning: using " << numThreads << " thread(s)" << (tuner->isCached() ? " (as in an earlier run)" : "") << " -";
+			for(std::vector<ThreadTuner::Trial>::const_iterator trial = tuner->getTrials().begin(); trial != tuner->getTrials().end(); ++trial) {
+				GAout << " " << trial->numThreads << ": " << trial->throughput << "/s";
+			}
+			GAout << std::endl;
+		}
+	}
+#endif
+
+	// All checks are disabled and must be performed in the R code calling this script
+	// Otherwise unexpected behaviour
+	Control ctrl = createControl(control, numThreads, verbosity, as<std::string>(control["telemetryFile"]), as<std::string>(control["snapshotFile"]));
+
+	/*
+	 * The relevance of the variables for weighted mutation is computed only once
+	 */
+	if(ctrl.mutationWeighting == MUTATION_UNIVARIATE) {
+		if(evalClass == USER) {
+			throw Rcpp::exception("Univariate mutation weights are not available when using a user supplied function for evaluation.", __FILE__, __LINE__);
+		}
+
+		Rcpp::NumericMatrix XMat(SX);
+		Rcpp::NumericMatrix YMat(Sy);
+		arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
+		arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
+
+		variableWeights = univariateWeights(ctrl, X, Y.col(0));
+	}
+
+	if(ctrl.verbosity >= VERBOSE) {
+		GAout << ctrl << std::endl;
+		GAout << "Vectorized kernels: " << SimdKernels::getLevelName() << std::endl;
+	}
+
+	pop = runPopulation(ctrl, *eval, seed, variableWeights, eliteSeeds);
+
+#ifdef ENABLE_DEBUG_VERBOSITY
+	Rcpp::Rcout << "Called evaluator " << PLSEvaluator::counter << " times" << std::endl;
+#endif
+
+	if(pop->wasInterrupted() == true) {
+		GAout << "Interrupted - returning best solutions found so far" << std::endl;
+	}
+
+#ifdef HAVE_USER_FUN_WORKERS
+	/* The worker processes can not report errors from within the threads */
+	const UserFunWorkerEvaluator *workerEval = dynamic_cast<const UserFunWorkerEvaluator*>(eval);
+	if(workerEval != NULL && workerEval->hasFailed()) {
+		throw Rcpp::exception(workerEval->getError().c_str(), __FILE__, __LINE__);
+	}
+#endif
+
+	::Evaluator::CacheStatistics cacheStats = pop->getCacheStatistics();
+
+	if(ctrl.verbosity >= ON) {
+		if(cacheStats.lookups > 0) {
+			GAout << "Cross-product cache: " << (100.0 * cacheStats.hitRate()) << "% hits in "
+				<< cacheStats.lookups << " lookups, " << ((double) cacheStats.bytes / (1024.0 * 1024.0)) << " MB used" << std::endl;
+		}
+
+		if(evalClass == CASCADE) {
+			const std::vector<CascadeEvaluator::StageStatistics> stats = static_cast<const CascadeEvaluator&>(*eval).getStageStatistics();
+			for(size_t s = 0; s < stats.size(); ++s) {
+				GAout << "Cascade stage " << (s + 1) << ": " << stats[s].passed << " of " << stats[s].evaluated << " subsets passed" << std::endl;
+			}
+		}
+
+		if(budget) {
+			GAout << "Memory: estimated " << (budget->getEstimatedBytes() / (1024.0 * 1024.0)) << " MB (limit "
+				<< (budget->getLimitBytes() / (1024.0 * 1024.0)) << " MB), peak resident size of the R process "
+				<< (MemoryBudget::peakResidentBytes() / (1024.0 * 1024.0)) << " MB" << std::endl;
+		}
+	}
+
+	/*
+	 * Gather data for return
+	 */
+
+	Population::SortedChromosomes result = pop->getResult();
+
+	fitnessEvolution.insert(fitnessEvolution.end(), pop->getFitnessEvolution().begin(), pop->getFitnessEvolution().end());
+	Rcpp::NumericVector retFitnessEvolution(fitnessEvolution.begin(), fitnessEvolution.end());
+	std::vector<arma::uvec> segmentation = eval->getSegmentation();
+	Rcpp::LogicalMatrix retMatrix(ctrl.numColumns, (const int) result.size());
+	Rcpp::NumericVector retFitnesses((const int) result.size());
+	uint16_t i = (uint16_t) result.size() - 1;
+
+	for(Population::SortedChromosomes::iterator it = result.begin(); it != result.end(); ++it, --i) {
+		retFitnesses[i] = it->getFitness();
+		retMatrix.column(i) = it->toLogicalVector();
+	}
+
+
+	return Rcpp::List::create(Rcpp::Named("subsets") = retMatrix,
+							  Rcpp::Named("fitness") = retFitnesses,
+							  Rcpp::Named("fitnessEvolution") = retFitnessEvolution,
+							  Rcpp::Named("segmentation") = Rcpp::wrap(segmentation),
+							  Rcpp::Named("hardwareCounters") = (hwProfile ? (SEXP) hardwareCountersToList(*hwProfile) : R_NilValue),
+							  Rcpp::Named("cascade") = ((evalClass == CASCADE) ? (SEXP) cascadeStatisticsToList(static_cast<const CascadeEvaluator&>(*eval)) : R_NilValue),
+							  Rcpp::Named("cache") = ((cacheStats.lookups > 0) ? (SEXP) cacheStatisticsToList(cacheStats) : R_NilValue),
+							  Rcpp::Named("memory") = (budget ? (SEXP) memoryToList(*budget) : R_NilValue),
+#ifdef HAVE_PTHREAD_H
+							  Rcpp::Named("threadTuning") = (tuner ? (SEXP) threadTuningToList(*tuner, numThreads) : R_NilValue));
+#else
+							  Rcpp::Named("threadTuning") = R_NilValue);
+#endif
+VOID_END_RCPP
+	return R_NilValue;
 }
 
-RcppExport SEXP genAlgPLS(SEXP Scontrol, SEXP SX, SEXP Sy, SEXP Sseed) {
-  std::unique_ptr<::Evaluator> eval;
-	std::unique_ptr<PLS> pls;
-	std::unique_ptr<Population> pop;
+RcppExport SEXP permutationTest(SEXP Scontrol, SEXP SX, SEXP Sy, SEXP Sseed, SEXP SnumPermutations) {
+	std::unique_ptr<::Evaluator> eval;
+	std::unique_ptr<PermutationTest> permTest;
 BEGIN_RCPP
 	List control = List(Scontrol);
-	uint32_t singleSeed = as<uint32_t>(Sseed);
+	uint32_t numPermutations = as<uint32_t>(SnumPermutations);
 	std::vector<uint32_t> seed;
 	uint16_t numThreads = as<uint16_t>(control["numThreads"]);
 	VerbosityLevel verbosity = (VerbosityLevel) as<int>(control["verbosity"]);
 	EvaluatorClass evalClass = (EvaluatorClass) as<int>(control["evaluatorClass"]);
 
-#ifdef ENABLE_DEBUG_VERBOSITY
-	PLSEvaluator::counter = 0;
-#endif
+	if(evalClass == USER) {
+		throw Rcpp::exception("The permutation test is not available when using a user supplied function for evaluation.", __FILE__, __LINE__);
+	}
 
+#ifndef HAVE_PTHREAD_H
 	if(numThreads > 1) {
-#ifdef HAVE_PTHREAD_H
-		if(evalClass == USER) {
-			GAerr << "Warning: Multithreading is not available when using a user supplied function for evaluation" << std::endl;
-		}
-#else
 		GAerr << "Warning: Threads are not supported on this system" << std::endl;
-		numThreads = 1;
-#endif
-	} else if(numThreads < 1) {
-		numThreads = 1;
 	}
+	numThreads = 1;
+#endif
 
-	// All checks are disabled and must be performed in the R code calling this script
-	// Otherwise unexpected behaviour
-	Control ctrl(as<uint16_t>(control["chromosomeSize"]),
-				 as<uint16_t>(control["populationSize"]),
-				 as<uint16_t>(control["numGenerations"]),
-				 as<uint16_t>(control["elitism"]),
-				 as<uint16_t>(control["minVariables"]),
-				 as<uint16_t>(control["maxVariables"]),
-				 as<double>(control["mutationProb"]),
-				 numThreads,
-				 as<uint16_t>(control["maxDuplicateEliminationTries"]),
-				 as<double>(control["badSolutionThreshold"]),
-				 (CrossoverType) as<int>(control["crossover"]),
-				 (FitnessScaling) as<int>(control["fitnessScaling"]),
-				 verbosity);
+	Control ctrl = createControl(control, 1, verbosity, std::string(), std::string());
+
+	Rcpp::NumericMatrix XMat(SX);
+	Rcpp::NumericMatrix YMat(Sy);
+	arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
+	arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
+	arma::vec y = Y.col(0);
 
 	/*
-	 * Generate a common seed for the Population and the PLSEvaluator objects
+	 * The seed for the original response is the same as in `genAlgPLS`, the permutations
+	 * and the seeds for the permuted responses are drawn from the same RNG afterwards
 	 */
-	RNG rng(singleSeed);
+	RNG rng(as<uint32_t>(Sseed));
 	seed.reserve(RNG::SEED_SIZE);
 	for(uint32_t i = 0; i < RNG::SEED_SIZE; ++i) {
 		seed.push_back(rng());
 	}
 
-	switch(evalClass) {
-		case USER: {
-			eval.reset(new UserFunEvaluator(as<Rcpp::Function>(control["userEvalFunction"]), ctrl.verbosity));
-			break;
-		}
-		case PLS_EVAL: {
-			Rcpp::NumericMatrix XMat(SX);
-			Rcpp::NumericMatrix YMat(Sy);
-			arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
-			arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
-			PLSMethod method = (PLSMethod) as<int>(control["plsMethod"]);
+	eval = createEvaluator(control, SX, Sy, seed, OFF);
 
-			pls = PLS::getInstance(method, X, Y.col(0));
+	if(ctrl.verbosity >= ON) {
+		GAout << "Running the genetic algorithm for the original and " << numPermutations << " permuted responses" << std::endl;
+	}
 
-			eval.reset(new PLSEvaluator(std::move(pls), as<uint16_t>(control["numReplications"]),
-                               as<uint16_t>(control["maxNComp"]), seed, ctrl.verbosity,
-                               as<uint16_t>(control["innerSegments"]),
-                               as<uint16_t>(control["outerSegments"]),
-                               as<double>(control["testSetSize"]),
-                               as<double>(control["sdfact"])));
+	permTest.reset(new PermutationTest(ctrl, *eval, X, y, seed, numThreads));
+	permTest->run(numPermutations, rng);
 
-			break;
-		}
-		case PLS_FIT: {
-			Rcpp::NumericMatrix XMat(SX);
-			Rcpp::NumericMatrix YMat(Sy);
-			arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
-			arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
-			PLSMethod method = (PLSMethod) as<int>(control["plsMethod"]);
+	if(permTest->wasInterrupted() == true) {
+		GAout << "Interrupted - returning the replicates finished so far" << std::endl;
+	}
 
-			pls = PLS::getInstance(method, X, Y.col(0));
+	std::vector<double> nullDistribution = permTest->getNullDistribution();
 
-			BICEvaluator::Statistic stat = (BICEvaluator::Statistic) as<int>(control["statistic"]);
+	return Rcpp::List::create(Rcpp::Named("observed") = permTest->getObservedFitness(),
+							  Rcpp::Named("null") = Rcpp::wrap(nullDistribution));
+VOID_END_RCPP
+	return R_NilValue;
+}
 
-			eval.reset(new BICEvaluator(std::move(pls),
-                               as<uint16_t>(control["maxNComp"]),
-                               seed,
-                               ctrl.verbosity,
-                               as<uint16_t>(control["innerSegments"]),
-                               stat,
-                               as<double>(control["sdfact"])));
+RcppExport SEXP stabilitySelection(SEXP Scontrol, SEXP SX, SEXP Sy, SEXP Sseed, SEXP SnumResamples, SEXP Sreplace) {
+	std::unique_ptr<::Evaluator> eval;
+	std::unique_ptr<StabilitySelection> stabSel;
+BEGIN_RCPP
+	List control = List(Scontrol);
+	uint32_t numResamples = as<uint32_t>(SnumResamples);
+	bool replace = as<bool>(Sreplace);
+	std::vector<uint32_t> seed;
+	std::vector<double> variableWeights;
+	uint16_t numThreads = as<uint16_t>(control["numThreads"]);
+	VerbosityLevel verbosity = (VerbosityLevel) as<int>(control["verbosity"]);
+	EvaluatorClass evalClass = (EvaluatorClass) as<int>(control["evaluatorClass"]);
 
-			break;
-		}
-		case LM: {
-			Rcpp::NumericMatrix XMat(SX);
-			Rcpp::NumericMatrix YMat(Sy);
-			arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
-			arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
-			arma::colvec y = Y.col(0);
+	if(evalClass == USER) {
+		throw Rcpp::exception("Stability selection is not available when using a user supplied function for evaluation.", __FILE__, __LINE__);
+	}
 
-			LMEvaluator::Statistic stat = (LMEvaluator::Statistic) as<int>(control["statistic"]);
-			eval.reset(new LMEvaluator(X, y, stat, verbosity));
+#ifndef HAVE_PTHREAD_H
+	if(numThreads > 1) {
+		GAerr << "Warning: Threads are not supported on this system" << std::endl;
+	}
+	numThreads = 1;
+#endif
 
-			break;
-		}
-		default:
-			throw Rcpp::exception("No valid evaluation method was selected.", __FILE__, __LINE__);
-			break;
+	Control ctrl = createControl(control, 1, verbosity, std::string(), std::string());
+
+	Rcpp::NumericMatrix XMat(SX);
+	Rcpp::NumericMatrix YMat(Sy);
+	arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
+	arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
+
+	RNG rng(as<uint32_t>(Sseed));
+	seed.reserve(RNG::SEED_SIZE);
+	for(uint32_t i = 0; i < RNG::SEED_SIZE; ++i) {
+		seed.push_back(rng());
 	}
 
-	if(ctrl.verbosity >= VERBOSE) {
-		GAout << ctrl << std::endl;
+	eval = createEvaluator(control, SX, Sy, seed, OFF);
+
+	/* The relevance of the variables is computed once from all observations */
+	if(ctrl.mutationWeighting == MUTATION_UNIVARIATE) {
+		variableWeights = univariateWeights(ctrl, X, Y.col(0));
 	}
 
-#ifdef HAVE_PTHREAD_H
-	try {
-		if(numThreads > 1) {
-			pop.reset(new MultiThreadedPopulation(ctrl, *eval, seed));
-		} else {
-			pop.reset(new SingleThreadPopulation(ctrl, *eval, seed));
+	if(ctrl.verbosity >= ON) {
+		GAout << "Running the genetic algorithm for " << numResamples << (replace ? " bootstrap samples" : " subsamples") << std::endl;
+	}
+
+	stabSel.reset(new StabilitySelection(ctrl, *eval, variableWeights, numThreads));
+	stabSel->run(numResamples, X.n_rows, replace, rng);
+
+	if(stabSel->wasInterrupted() == true) {
+		GAout << "Interrupted - returning the resamples finished so far" << std::endl;
+	}
+
+	std::vector<arma::uvec> subsets = stabSel->getSubsets();
+	Rcpp::LogicalMatrix retSubsets(ctrl.numColumns, subsets.size());
+
+	for(size_t i = 0; i < subsets.size(); ++i) {
+		for(arma::uword j = 0; j < subsets[i].n_elem; ++j) {
+			retSubsets(subsets[i][j], i) = true;
 		}
-		pop->run();
-	} catch(MultiThreadedPopulation::ThreadingError& te) {
-		if(ctrl.verbosity >= DEBUG_GA) {
-			throw te;
-		} else {
-			throw Rcpp::exception("Multithreading could not be initialized. Set numThreads to 0 to avoid this problem.", __FILE__, __LINE__);
+	}
+
+	return Rcpp::List::create(Rcpp::Named("frequencies") = Rcpp::wrap(stabSel->getSelectionFrequencies()),
+							  Rcpp::Named("subsets") = retSubsets);
+VOID_END_RCPP
+	return R_NilValue;
+}
+
+/*
+ * The maximum number of subsets the `evaluate` entry point hands to the evaluator at once
+ */
+#define EVALUATE_BATCH_SIZE 1024
+
+/**
+ * Read the variable subsets given to the `evaluate` entry point.
+ *
+ * The subsets can be given as
+ *	- logical matrix with dimensions p x k,
+ *	- list of k integer vectors with the (1-based) indices of the selected variables, or
+ *	- raw matrix with dimensions ceiling(p / 8) x k, where every column holds the packed bits
+ *	  of one subset (least significant bit first, as created by `packBits`).
+ */
+class SubsetReader {
+public:
+	SubsetReader(SEXP Ssubsets, arma::uword numVariables) : Ssubsets(Ssubsets), numVariables(numVariables) {
+		switch(TYPEOF(Ssubsets)) {
+			case LGLSXP: {
+				Rcpp::LogicalMatrix subsets(Ssubsets);
+				if((arma::uword) subsets.rows() != numVariables) {
+					throw Rcpp::exception("The number of rows of the subset matrix must match the number of variables");
+				}
+				this->numSubsets = subsets.cols();
+				break;
+			}
+			case VECSXP:
+				this->numSubsets = Rf_length(Ssubsets);
+				break;
+			case RAWSXP: {
+				Rcpp::RawMatrix subsets(Ssubsets);
+				if((arma::uword) subsets.rows() != (numVariables + 7) / 8) {
+					throw Rcpp::exception("The number of rows of the packed subset matrix must be ceiling(p / 8)");
+				}
+				this->numSubsets = subsets.cols();
+				break;
+			}
+			default:
+				throw Rcpp::exception("The subsets must be a logical matrix, a list of integer vectors or a raw matrix");
 		}
 	}
-#else
-	pop.reset(new SingleThreadPopulation(ctrl, *eval, seed));
-	pop->run();
-#endif
 
-#ifdef ENABLE_DEBUG_VERBOSITY
-	Rcpp::Rcout << "Called evaluator " << PLSEvaluator::counter << " times" << std::endl;
-#endif
+	int size() const {
+		return this->numSubsets;
+	}
 
-	if(pop->wasInterrupted() == true) {
-		GAout << "Interrupted - returning best solutions found so far" << std::endl;
+	arma::uword getNumVariables() const {
+		return this->numVariables;
 	}
 
+	/**
+	 * Write the (0-based) indices of the variables in subset `i` into `buffer`
+	 * (which must be able to hold all variables) and return the number of selected variables.
+	 */
+	arma::uword read(int i, arma::uvec &buffer) const {
+		arma::uword numSelected = 0;
+
+		switch(TYPEOF(this->Ssubsets)) {
+			case LGLSXP: {
+				Rcpp::LogicalMatrix subsets(this->Ssubsets);
+				const int* subset = &subsets(0, i);
+
+				for(arma::uword row = 0; row < this->numVariables; ++row) {
+					if(subset[row] == TRUE) {
+						buffer[numSelected++] = row;
+					}
+				}
+				break;
+			}
+			case VECSXP: {
+				Rcpp::IntegerVector subset(VECTOR_ELT(this->Ssubsets, i));
+
+				if((arma::uword) subset.size() > this->numVariables) {
+					throw Rcpp::exception("A subset must not contain more indices than variables");
+				}
+
+				for(int j = 0; j < subset.size(); ++j) {
+					if(subset[j] < 1 || (arma::uword) subset[j] > this->numVariables) {
+						throw Rcpp::exception("The variable indices in the subsets must be between 1 and p");
+					}
+					buffer[numSelected++] = subset[j] - 1;
+				}
+
+				/* The evaluators expect the columns to be ordered and unique */
+				std::sort(buffer.memptr(), buffer.memptr() + numSelected);
+				numSelected = std::unique(buffer.memptr(), buffer.memptr() + numSelected) - buffer.memptr();
+				break;
+			}
+			case RAWSXP: {
+				Rcpp::RawMatrix subsets(this->Ssubsets);
+				const unsigned char* subset = &subsets(0, i);
+				arma::uword var;
+
+				for(arma::uword byte = 0; byte < (this->numVariables + 7) / 8; ++byte) {
+					for(unsigned char bits = subset[byte]; bits > 0; bits &= (bits - 1)) {
+						var = byte * 8 + LOWEST_SET_BIT[bits];
+						if(var < this->numVariables) {
+							buffer[numSelected++] = var;
+						}
+					}
+				}
+				break;
+			}
+			default:
+				break;
+		}
+
+		return numSelected;
+	}
+
+private:
+	static const unsigned char LOWEST_SET_BIT[256];
+
+	SEXP Ssubsets;
+	const arma::uword numVariables;
+	int numSubsets;
+};
+
+const unsigned char SubsetReader::LOWEST_SET_BIT[256] = {
+	0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	7, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
+};
+
+/**
+ * Evaluate all subsets with the given evaluator and return the fitness and the segmentation
+ */
+static Rcpp::List evaluateSubsets(::Evaluator &eval, const SubsetReader &subsets) {
 	/*
-	 * Gather data for return
+	 * Only one buffer for the column indices is used for reading the subsets. The subsets are
+	 * evaluated in batches (so the evaluator can share work between similar subsets) without
+	 * holding all subsets in memory at once.
 	 */
+	Rcpp::NumericVector fitness(subsets.size());
+	arma::uvec selectedColumns(subsets.getNumVariables());
+	std::vector<arma::uvec> batch;
+	std::vector<int> batchColumns;
+	std::vector<double> batchFitness;
 
-	Population::SortedChromosomes result = pop->getResult();
+	batch.reserve(EVALUATE_BATCH_SIZE);
+	batchColumns.reserve(EVALUATE_BATCH_SIZE);
 
-	Rcpp::NumericVector retFitnessEvolution(pop->getFitnessEvolution().begin(), pop->getFitnessEvolution().end());
-	std::vector<arma::uvec> segmentation = eval->getSegmentation();
-	Rcpp::LogicalMatrix retMatrix(ctrl.chromosomeSize, (const int) result.size());
-	Rcpp::NumericVector retFitnesses((const int) result.size());
-	uint16_t i = (uint16_t) result.size() - 1;
+	for(int col = 0; col < subsets.size(); ++col) {
+		arma::uword numSelected = subsets.read(col, selectedColumns);
 
-	for(Population::SortedChromosomes::iterator it = result.begin(); it != result.end(); ++it, --i) {
-		retFitnesses[i] = it->getFitness();
-		retMatrix.column(i) = it->toLogicalVector();
+		if(numSelected > 0) {
+			batch.push_back(arma::uvec(selectedColumns.memptr(), numSelected));
+			batchColumns.push_back(col);
+		}
+
+		if(batch.size() >= EVALUATE_BATCH_SIZE || (col == subsets.size() - 1 && !batch.empty())) {
+			eval.evaluateBatch(batch, batchFitness);
+
+			for(size_t i = 0; i < batch.size(); ++i) {
+				fitness[batchColumns[i]] = batchFitness[i];
+			}
+
+			batch.clear();
+			batchColumns.clear();
+		}
 	}
 
+	std::vector<arma::uvec> segmentation = eval.getSegmentation();
 
-	return Rcpp::List::create(Rcpp::Named("subsets") = retMatrix,
-							  Rcpp::Named("fitness") = retFitnesses,
-							  Rcpp::Named("fitnessEvolution") = retFitnessEvolution,
+	return Rcpp::List::create(Rcpp::Named("fitness") = Rcpp::wrap(fitness),
 							  Rcpp::Named("segmentation") = Rcpp::wrap(segmentation));
-VOID_END_RCPP
-	return R_NilValue;
 }
 
-/**
- *
- */
 RcppExport SEXP evaluate(SEXP Sevaluator, SEXP SX, SEXP Sy, SEXP Ssubsets, SEXP Sseed) {
 	std::unique_ptr<::Evaluator> eval;
   std::unique_ptr<PLS> pls;
 
 	BEGIN_RCPP
+	/*
+	 * An evaluator handle already holds the data, so X and y are not needed
+	 */
+	if(TYPEOF(Sevaluator) == EXTPTRSXP) {
+		EvaluatorHandle &handle = EvaluatorHandle::get(Sevaluator);
+		return evaluateSubsets(handle.getEvaluator(), SubsetReader(Ssubsets, handle.getNumColumns()));
+	}
+
 	List evaluator = List(Sevaluator);
 	Rcpp::NumericMatrix XMat(SX);
 	Rcpp::NumericMatrix YMat(Sy);
-	Rcpp::LogicalMatrix subsets(Ssubsets);
-	Rcpp::NumericVector fitness(subsets.cols());
-	std::vector<arma::uvec> segmentation;
+	SubsetReader subsets(Ssubsets, XMat.ncol());
 	arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
 	arma::mat Y(YMat.begin(), YMat.nrow(), YMat.ncol(), false);
 	EvaluatorClass evalClass = (EvaluatorClass) as<int>(evaluator["evaluatorClass"]);
@@ -240,7 +1291,7 @@ RcppExport SEXP evaluate(SEXP Sevaluator, SEXP SX, SEXP Sy, SEXP Ssubsets, SEXP
 
 	switch(evalClass) {
 		case USER: {
-			eval.reset(new UserFunEvaluator(as<Rcpp::Function>(evaluator["userEvalFunction"]), OFF));
+			eval.reset(createUserFunEvaluator(evaluator, XMat.ncol(), OFF));
 			break;
 		}
 		case PLS_EVAL: {
@@ -260,7 +1311,8 @@ RcppExport SEXP evaluate(SEXP Sevaluator, SEXP SX, SEXP Sy, SEXP Ssubsets, SEXP
                                as<uint16_t>(evaluator["innerSegments"]),
                                as<uint16_t>(evaluator["outerSegments"]),
                                as<double>(evaluator["testSetSize"]),
-                               as<double>(evaluator["sdfact"])));
+                               as<double>(evaluator["sdfact"]),
+                               as<uint16_t>(evaluator["earlyStop"])));
 
 			break;
 		}
@@ -287,7 +1339,8 @@ RcppExport SEXP evaluate(SEXP Sevaluator, SEXP SX, SEXP Sy, SEXP Ssubsets, SEXP
                                (VerbosityLevel) as<int>(evaluator["verbosity"]),
                                as<uint16_t>(evaluator["innerSegments"]),
                                stat,
-                               as<double>(evaluator["sdfact"])));
+                               as<double>(evaluator["sdfact"]),
+                               as<uint16_t>(evaluator["earlyStop"])));
 
 			break;
 		}
@@ -295,36 +1348,42 @@ RcppExport SEXP evaluate(SEXP Sevaluator, SEXP SX, SEXP Sy, SEXP Ssubsets, SEXP
 			arma::colvec y = Y.col(0);
 
 			LMEvaluator::Statistic stat = (LMEvaluator::Statistic) as<int>(evaluator["statistic"]);
-			eval.reset(new LMEvaluator(X, y, stat, (VerbosityLevel) as<int>(evaluator["verbosity"])));
+			eval.reset(new LMEvaluator(X, y, stat, (VerbosityLevel) as<int>(evaluator["verbosity"]), true,
+									   (size_t) (as<double>(evaluator["crossprodCacheSize"]) * 1024 * 1024)));
+			break;
+		}
+		case USER_COMPILED: {
+			eval.reset(createCompiledFunEvaluator(evaluator, SX, Sy, OFF));
 			break;
 		}
 		default:
 			break;
 	}
-	int row = 0;
-	uint16_t i = 0;
 
-	for(int col = 0; col < subsets.cols(); ++col) {
-		arma::uvec selectedColumns(subsets.rows());
-		i = 0;
+	return evaluateSubsets(*eval, subsets);
 
-		for(row = 0; row < subsets.rows(); ++row) {
-			if(subsets(row, col) == true) {
-				selectedColumns[i++] = row;
-			}
-		}
-		if(i > 0) {
-			selectedColumns.resize(i);
-			fitness[col] = eval->evaluate(selectedColumns);
-		}
-	}
+	VOID_END_RCPP
+	return R_NilValue;
+}
 
-	segmentation = eval->getSegmentation();
+RcppExport SEXP createEvaluatorHandle(SEXP Sevaluator, SEXP SX, SEXP Sy, SEXP Sseed) {
+BEGIN_RCPP
+	List evaluator = List(Sevaluator);
+	VerbosityLevel verbosity = (VerbosityLevel) as<int>(evaluator["verbosity"]);
+	std::vector<uint32_t> seed;
 
-	return Rcpp::List::create(Rcpp::Named("fitness") = Rcpp::wrap(fitness),
-							  Rcpp::Named("segmentation") = Rcpp::wrap(segmentation));
+	if((EvaluatorClass) as<int>(evaluator["evaluatorClass"]) == USER) {
+		throw Rcpp::exception("An evaluator handle is not available when using a user supplied R function for evaluation.", __FILE__, __LINE__);
+	}
 
-	VOID_END_RCPP
+	RNG rng(as<uint32_t>(Sseed));
+	seed.reserve(RNG::SEED_SIZE);
+	for(uint32_t i = 0; i < RNG::SEED_SIZE; ++i) {
+		seed.push_back(rng());
+	}
+
+	return Rcpp::XPtr<EvaluatorHandle>(new EvaluatorHandle(evaluator, SX, Sy, seed, verbosity), true);
+VOID_END_RCPP
 	return R_NilValue;
 }
 
@@ -365,6 +1424,58 @@ BEGIN_RCPP
 END_RCPP
 }
 
+/**
+ * Convert the 1-based R indices to 0-based column indices
+ */
+static arma::uvec toColumnIndices(SEXP Scolumns) {
+	Rcpp::IntegerVector columns(Scolumns);
+	arma::uvec indices(columns.size());
+
+	for(int i = 0; i < columns.size(); ++i) {
+		if(columns[i] < 1) {
+			throw Rcpp::exception("The column indices must be positive");
+		}
+		indices[i] = columns[i] - 1;
+	}
+
+	return indices;
+}
+
+RcppExport SEXP fitPLSModel(SEXP SX, SEXP Sy, SEXP Scolumns, SEXP Sncomp, SEXP Smethod) {
+BEGIN_RCPP
+	Rcpp::NumericMatrix XMat(SX);
+	Rcpp::NumericVector YVec(Sy);
+	arma::mat X(XMat.begin(), XMat.nrow(), XMat.ncol(), false);
+	arma::vec Y(YVec.begin(), YVec.length(), false);
+	arma::uvec columns = toColumnIndices(Scolumns);
+
+	if(columns.n_elem == 0 || columns.max() >= X.n_cols) {
+		throw Rcpp::exception("The column indices must be between 1 and the number of columns of X");
+	}
+
+	PLSModel model = PLSModel::fit((PLSMethod) Rcpp::as<int>(Smethod), X, Y, columns, Rcpp::as<uint16_t>(Sncomp));
+
+	return Rcpp::List::create(Rcpp::Named("coefficients") = Rcpp::wrap(model.getCoefficients()),
+							  Rcpp::Named("intercept") = model.getIntercept(),
+							  Rcpp::Named("ncomp") = (int) model.getNComp());
+END_RCPP
+}
+
+RcppExport SEXP predictPLSModel(SEXP SnewX, SEXP Scolumns, SEXP Scoefficients, SEXP Sintercept, SEXP SnumThreads) {
+BEGIN_RCPP
+	Rcpp::NumericMatrix newXMat(SnewX);
+	Rcpp::NumericVector coefVec(Scoefficients);
+	arma::vec coefficients(coefVec.begin(), coefVec.length(), false);
+	Rcpp::NumericVector pred(newXMat.nrow());
+
+	PLSModel model(toColumnIndices(Scolumns), coefficients, Rcpp::as<double>(Sintercept), 0);
+
+	model.predict(newXMat.begin(), newXMat.nrow(), newXMat.ncol(), pred.begin(), Rcpp::as<uint16_t>(SnumThreads));
+
+	return pred;
+END_RCPP
+}
+
 //
 //
 // RcppExport SEXP evalTest(SEXP Xs, SEXP Ys, SEXP numReplications, SEXP numSegments) {
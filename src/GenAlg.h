@@ -24,14 +24,32 @@ enum EvaluatorClass {
 	USER = 0,
 	PLS_EVAL = 1,
 	LM = 2,
-	PLS_FIT = 3
+	PLS_FIT = 3,
+	CASCADE = 4,
+	USER_COMPILED = 5
 };
 
 /**
  * arguments:
  *	control ... A R list with following entries:
- *		uint16_t chromosomeSize ... The size of the chromosome (most times equal to the number of columns of X) (> 0)
+ *		uint16_t chromosomeSize ... The size of the chromosome (the number of variables that are not always or never included) (> 0)
+ *		uint16_t numColumns ... The number of columns of X
+ *		IntegerVector freeColumns ... The (0 based) columns of X the chromosome bits refer to (empty = all columns)
+ *		IntegerVector forcedColumns ... The (0 based) columns of X that are always included
+ *		int binSize ... If greater than 1, first evolve the means of this many adjacent columns and then continue
+ *			at full resolution within the selected bins (only used by genAlgPLS)
+ *		uint16_t coarseGenerations ... The number of generations of the coarse stage (< numGenerations)
  *		uint16_t populationSize ... Number of indivudual chromosomes in the population (i.e. per generation) (> 0)
+ *		uint16_t minPopulationSize ... The minimum number of chromosomes per generation if the population size is adapted
+ *			(0 or populationSize = constant population size)
+ *		int idleTask ... What threads do while waiting for the other threads to finish a generation
+ *			(0 = nothing, 1 = re-evaluate the elite with a new segmentation, 2 = evaluate single-bit neighbours of the elite)
+ *		int evaluationOrder ... The order in which the children are evaluated
+ *			(0 = as they are mated, 1 = in batches ordered by the similarity of the subsets)
+ *		std::string snapshotFile ... The binary file every generation is written to (empty = no snapshots)
+ *		uint16_t snapshotInterval ... Write a snapshot every this many generations
+ *		double memoryLimit ... The maximum memory (in MB) used by the algorithm (0 = no limit). The number of threads
+ *			and the size of the cross-product caches are reduced to fit the estimated footprint into the limit
  *		uint16_t numGenerations ... The number of generations to generate (> 0)
  *		uint16_t minVariables ... The minimum number of variables in a subset
  *		uint16_t maxVariables ... The maximum number of variables in a subset
@@ -43,8 +61,14 @@ enum EvaluatorClass {
  *		CrossoverType crossover ... Type of crossover to use
  *		FitnessScaling fitnessScaling ... How to scale the fitness (0 = NONE, 1 = EXP)
  *		VerbosityLevel verbosity ... Level of verbosity
+ *		std::string telemetryFile ... Path to the file where the progress is published (empty string = no telemetry)
+ *		MutationWeighting mutationWeighting ... How variables are chosen in mutation (0 = uniform, 1 = univariate relevance, 2 = inclusion frequency)
  *		EvaluatorClass evaluatorClass ... The evaluator to use
  *		Rcpp::Function userEvalFunction ... The function to be called for evaluating the fitness of a chromosome
+ *		SEXP fitnessFunction ... External pointer to the compiled fitness function (a gaselect_fitness_fun*, see gaselect.h)
+ *		SEXP fitnessState ... External pointer to the state passed on to the compiled fitness function (optional)
+ *		std::string workerCommand ... The path to Rscript for starting the R worker processes evaluating userEvalFunction (optional)
+ *		std::string workerDir ... The directory with the data for the R worker processes (optional, if given numThreads workers are used)
  *		PLSMethod plsMethod ... PLS method to use in internal evaluation
  *		uint16_t numReplications ... Number of replications in the internal evaluation procedure
  *			(the variable subset is evaluted with CV numReplication times and the mean fitness is returned) (> 0)
@@ -53,20 +77,61 @@ enum EvaluatorClass {
  *		double testSetSize ... If srCV should be used, the rel. size of the test set between 0 and 1 (ignored if outerSegments > 1)
  *		double sdfact ... The factor to scale the SD with when selecting the optimal number of components
  *		uint16_t maxNComp ... The maximum number of componentes the PLS models should consider
+ *		uint16_t earlyStop ... Stop adding components after the CV error increased for this many consecutive components (0 = disabled)
  *		int statistic ... The statistic the LM Evaluator should use
+ *		List stages ... The control lists of the evaluators of a cascade, from the cheapest to the most expensive one
+ *			(every list only needs the entries that differ from the control list)
+ *		NumericVector thresholds ... The acceptance threshold of every stage of a cascade but the last
+ *		uint16_t referenceSize ... The number of best subsets the fitness in a stage of the cascade is compared to
+ *		SEXP evaluatorHandle ... External pointer created by `createEvaluatorHandle` (optional, if given the evaluator of the
+ *			handle is used instead of creating one from the control list; it must hold the same X and y)
  *	X ... A numeric matrix with dimensions n x p (optional - only needed if using internal evaluation methods)
  *	y ... A numeric vector with length n (optional - only needed if using internal evaluation methods)
  *	seed ... An integer (uint32_t) with the initial seed
  */
 RcppExport SEXP genAlgPLS(SEXP control, SEXP X, SEXP y, SEXP seed);
 
+/**
+ * Run the genetic algorithm for the original and for randomly permuted responses
+ * arguments:
+ *	control ... The same list as for `genAlgPLS` (a user supplied evaluation function is not supported)
+ *	X ... A numeric matrix with dimensions n x p
+ *	y ... A numeric vector with length n
+ *	seed ... An integer (uint32_t) with the initial seed
+ *	numPermutations ... The number of permuted responses
+ *
+ * returns a list with the best fitness for the original response and the best fitness
+ * for every permuted response (the null distribution)
+ */
+RcppExport SEXP permutationTest(SEXP control, SEXP X, SEXP y, SEXP seed, SEXP numPermutations);
+
+/**
+ * Run the genetic algorithm on resamples of the observations and count how often every variable is selected
+ * arguments:
+ *	control ... The same list as for `genAlgPLS` (a user supplied evaluation function is not supported)
+ *	X ... A numeric matrix with dimensions n x p
+ *	y ... A numeric vector with length n
+ *	seed ... An integer (uint32_t) with the initial seed
+ *	numResamples ... The number of resamples
+ *	replace ... Logical, TRUE for bootstrap samples, FALSE for subsamples of half the observations
+ *
+ * returns a list with the relative selection frequency of every variable and a logical matrix with
+ * dimensions p x B holding the best subset of each of the B finished resamples
+ */
+RcppExport SEXP stabilitySelection(SEXP control, SEXP X, SEXP y, SEXP seed, SEXP numResamples, SEXP replace);
+
 /**
  * evaluate the given data with the given evaluator
  * arguments:
- *	evaluator ... A R list with following entries
+ *	evaluator ... Either an external pointer created by `createEvaluatorHandle` (X, y and seed are ignored)
+ *		or a R list with following entries
  *		VerbosityLevel verbosity ... Level of verbosity
  *		EvaluatorClass evaluatorClass ... The evaluator to use
  *		Rcpp::Function userEvalFunction ... The function to be called for evaluating the fitness of a chromosome
+ *		SEXP fitnessFunction ... External pointer to the compiled fitness function (a gaselect_fitness_fun*, see gaselect.h)
+ *		SEXP fitnessState ... External pointer to the state passed on to the compiled fitness function (optional)
+ *		std::string workerCommand ... The path to Rscript for starting the R worker processes evaluating userEvalFunction (optional)
+ *		std::string workerDir ... The directory with the data for the R worker processes (optional, if given numThreads workers are used)
  *		PLSMethod plsMethod ... PLS method to use in internal evaluation
  *		uint16_t numReplications ... Number of replications in the internal evaluation procedure
  *			(the variable subset is evaluted with CV numReplication times and the mean fitness is returned) (> 0)
@@ -75,17 +140,61 @@ RcppExport SEXP genAlgPLS(SEXP control, SEXP X, SEXP y, SEXP seed);
  *		double testSetSize ... If srCV should be used, the rel. size of the test set between 0 and 1 (ignored if outerSegments > 1)
  *		double sdfact ... The factor to scale the SD with when selecting the optimal number of components
  *		uint16_t maxNComp ... The maximum number of componentes the PLS models should consider
+ *		uint16_t earlyStop ... Stop adding components after the CV error increased for this many consecutive components (0 = disabled)
  *		int sepTransformation ... The type of transformation for the SEP (NONE or LOG)
  *		int statistic ... The statistic the LM Evaluator should use
  *
  *	X ... A numeric matrix with dimensions n x p
  *	y ... A numeric vector with length n
- *	subsets ... A logical matrix with dimensions p x k, where k is the number of different subsets to evaluate
+ *	subsets ... The k different subsets to evaluate, either as
+ *		- logical matrix with dimensions p x k,
+ *		- list of k integer vectors with the (1-based) indices of the selected variables, or
+ *		- raw matrix with dimensions ceiling(p / 8) x k holding the packed bits (LSB first, see `packBits`)
  *	seed ... An integer (uint32_t) with the initial seed
  */
 RcppExport SEXP evaluate(SEXP evaluator, SEXP X, SEXP y, SEXP subsets, SEXP seed);
 
+/**
+ * Create an evaluator that is kept alive between calls (together with its data, segmentation and caches)
+ * arguments:
+ *	evaluator ... The same list as for `evaluate` (a user supplied R function is not supported) with the additional entries
+ *		IntegerVector forcedColumns ... The (0 based) columns of X that are always included (may be empty)
+ *		List stages, NumericVector thresholds, uint16_t referenceSize ... The settings of a cascade (see `genAlgPLS`)
+ *	X ... A numeric matrix with dimensions n x p
+ *	y ... A numeric vector with length n
+ *	seed ... An integer (uint32_t) with the seed for the segmentation
+ *
+ * returns an external pointer to the evaluator that can be passed to `evaluate` and `genAlgPLS`
+ * (the evaluator is destroyed when the pointer is garbage collected)
+ */
+RcppExport SEXP createEvaluatorHandle(SEXP evaluator, SEXP X, SEXP y, SEXP seed);
+
 RcppExport SEXP simpls(SEXP X, SEXP y, SEXP ncomp, SEXP newX, SEXP rep);
+
+/**
+ * Fit a PLS model to the given columns of X
+ * arguments:
+ *	X ... A numeric matrix with dimensions n x p
+ *	y ... A numeric vector with length n
+ *	columns ... An integer vector with the (1-based) indices of the columns to use
+ *	ncomp ... The number of components (0 = as many as possible)
+ *	method ... The PLSMethod to use
+ *
+ * returns a list with the coefficients for the selected columns, the intercept and
+ * the actual number of components
+ */
+RcppExport SEXP fitPLSModel(SEXP X, SEXP y, SEXP columns, SEXP ncomp, SEXP method);
+
+/**
+ * Predict the response with a fitted PLS model
+ * arguments:
+ *	newX ... A numeric matrix with dimensions m x p (only the selected columns are read)
+ *	columns ... An integer vector with the (1-based) indices of the columns used by the model
+ *	coefficients ... The coefficients for the selected columns
+ *	intercept ... The intercept term
+ *	numThreads ... The maximum number of threads to use
+ */
+RcppExport SEXP predictPLSModel(SEXP newX, SEXP columns, SEXP coefficients, SEXP intercept, SEXP numThreads);
 //RcppExport SEXP WELL19937a(SEXP n, SEXP seed);
 
 #endif
@@ -0,0 +1,232 @@
+//
+//  HardwareCounters.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#include "HardwareCounters.h"
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+namespace {
+int openCounter(uint64_t config, int groupFd) {
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = (groupFd == -1) ? 1 : 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	/* Only count the calling thread, on any CPU */
+	return (int) syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+}
+#endif
+
+HardwareCounters::HardwareCounters() : numOpen(0) {
+	uint8_t event;
+
+	for(event = 0; event < NUM_EVENTS; ++event) {
+		this->fd[event] = -1;
+		this->groupIndex[event] = -1;
+	}
+
+	memset(&this->last, 0, sizeof(this->last));
+	memset(this->totals, 0, sizeof(this->totals));
+	memset(this->timeEnabled, 0, sizeof(this->timeEnabled));
+	memset(this->timeRunning, 0, sizeof(this->timeRunning));
+	memset(this->occurrences, 0, sizeof(this->occurrences));
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+	const uint64_t configs[NUM_EVENTS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	/* The cycles counter is the group leader, the other events are optional */
+	this->fd[EVENT_CYCLES] = openCounter(configs[EVENT_CYCLES], -1);
+
+	if(this->fd[EVENT_CYCLES] < 0) {
+		this->error = std::string("perf_event_open failed: ") + strerror(errno);
+		return;
+	}
+
+	this->groupIndex[EVENT_CYCLES] = this->numOpen++;
+
+	for(event = EVENT_CYCLES + 1; event < NUM_EVENTS; ++event) {
+		this->fd[event] = openCounter(configs[event], this->fd[EVENT_CYCLES]);
+		if(this->fd[event] >= 0) {
+			this->groupIndex[event] = this->numOpen++;
+		}
+	}
+
+	if(ioctl(this->fd[EVENT_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0) {
+		this->error = std::string("The hardware counters could not be enabled: ") + strerror(errno);
+		for(event = 0; event < NUM_EVENTS; ++event) {
+			if(this->fd[event] >= 0) {
+				close(this->fd[event]);
+			}
+			this->fd[event] = -1;
+			this->groupIndex[event] = -1;
+		}
+		this->numOpen = 0;
+	}
+#else
+	this->error = "Hardware counters are only available on Linux";
+#endif
+}
+
+HardwareCounters::~HardwareCounters() {
+#ifdef HAVE_LINUX_PERF_EVENT_H
+	/* Close the group members before the leader */
+	for(int8_t event = NUM_EVENTS - 1; event >= 0; --event) {
+		if(this->fd[event] >= 0) {
+			close(this->fd[event]);
+		}
+	}
+#endif
+}
+
+bool HardwareCounters::read(Reading &reading) const {
+#ifdef HAVE_LINUX_PERF_EVENT_H
+	ssize_t expected = (ssize_t) ((3 + this->numOpen) * sizeof(uint64_t));
+	return (::read(this->fd[EVENT_CYCLES], &reading, sizeof(reading)) == expected);
+#else
+	return false;
+#endif
+}
+
+void HardwareCounters::begin() {
+	if(this->numOpen > 0) {
+		this->read(this->last);
+	}
+}
+
+void HardwareCounters::mark(Phase phase) {
+	Reading current;
+
+	if(this->numOpen == 0 || !this->read(current)) {
+		return;
+	}
+
+	for(uint16_t i = 0; i < this->numOpen; ++i) {
+		this->totals[phase][i] += current.values[i] - this->last.values[i];
+	}
+
+	this->timeEnabled[phase] += current.timeEnabled - this->last.timeEnabled;
+	this->timeRunning[phase] += current.timeRunning - this->last.timeRunning;
+	++this->occurrences[phase];
+
+	this->last = current;
+}
+
+double HardwareCounters::getTotal(Phase phase, Event event) const {
+	if(this->groupIndex[event] < 0 || this->timeRunning[phase] == 0) {
+		return 0.0;
+	}
+
+	return ((double) this->totals[phase][this->groupIndex[event]]) *
+		((double) this->timeEnabled[phase] / (double) this->timeRunning[phase]);
+}
+
+const char* HardwareCounters::getPhaseName(Phase phase) {
+	switch(phase) {
+		case PHASE_GATHER:
+			return "gather";
+		case PHASE_FIT:
+			return "fit";
+		case PHASE_PREDICT:
+			return "predict";
+		default:
+			return "";
+	}
+}
+
+HardwareProfile* HardwareProfile::active = NULL;
+
+HardwareProfile::HardwareProfile() {
+	if(HardwareProfile::active != NULL) {
+		throw std::logic_error("Only one hardware profile can be active at a time");
+	}
+
+#ifdef HAVE_PTHREAD_H
+	this->creator = pthread_self();
+
+	if(pthread_key_create(&this->key, NULL) != 0) {
+		throw std::runtime_error("Thread specific storage for the hardware counters could not be created");
+	}
+
+	if(pthread_mutex_init(&this->mutex, NULL) != 0) {
+		pthread_key_delete(this->key);
+		throw std::runtime_error("Mutex for the hardware counters could not be initialized");
+	}
+#else
+	this->counters = NULL;
+#endif
+
+	HardwareProfile::active = this;
+}
+
+HardwareProfile::~HardwareProfile() {
+	HardwareProfile::active = NULL;
+
+#ifdef HAVE_PTHREAD_H
+	/* All other threads have already finished */
+	pthread_setspecific(this->key, NULL);
+	pthread_key_delete(this->key);
+	pthread_mutex_destroy(&this->mutex);
+#endif
+
+	for(std::vector<ThreadCounters>::iterator it = this->threads.begin(); it != this->threads.end(); ++it) {
+		delete it->counters;
+	}
+}
+
+HardwareCounters* HardwareProfile::getThreadCounters() {
+#ifdef HAVE_PTHREAD_H
+	HardwareCounters *counters = static_cast<HardwareCounters*>(pthread_getspecific(this->key));
+
+	if(counters == NULL) {
+		ThreadCounters threadCounters;
+		counters = new HardwareCounters();
+		threadCounters.counters = counters;
+		threadCounters.mainThread = (pthread_equal(pthread_self(), this->creator) != 0);
+
+		pthread_mutex_lock(&this->mutex);
+		this->threads.push_back(threadCounters);
+		pthread_mutex_unlock(&this->mutex);
+
+		pthread_setspecific(this->key, counters);
+	}
+
+	return counters;
+#else
+	if(this->counters == NULL) {
+		ThreadCounters threadCounters;
+		this->counters = new HardwareCounters();
+		threadCounters.counters = this->counters;
+		threadCounters.mainThread = true;
+		this->threads.push_back(threadCounters);
+	}
+
+	return this->counters;
+#endif
+}
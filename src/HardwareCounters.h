@@ -0,0 +1,176 @@
+//
+//  HardwareCounters.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_HardwareCounters_h
+#define gaselect_HardwareCounters_h
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/**
+ * Hardware performance counters (cycles, instructions, cache misses and branch misses)
+ * of the calling thread, attributed to the phases of an evaluation.
+ *
+ * The counters are read with a single system call at every phase boundary and the
+ * difference to the previous reading is added to the phase that just ended.
+ * If the PMU has to multiplex the counters, the totals are scaled by the ratio
+ * of the time the counters were enabled to the time they were actually running.
+ *
+ * Counters are only available on Linux (via perf_event_open) and only if the
+ * kernel allows unprivileged users to monitor their own threads.
+ */
+class HardwareCounters {
+public:
+	enum Phase {
+		PHASE_GATHER = 0,	// Selecting the columns of the variable subset
+		PHASE_FIT,			// Fitting the model(s)
+		PHASE_PREDICT,		// Predicting the left-out observations and computing the residuals
+		NUM_PHASES
+	};
+
+	enum Event {
+		EVENT_CYCLES = 0,
+		EVENT_INSTRUCTIONS,
+		EVENT_CACHE_MISSES,
+		EVENT_BRANCH_MISSES,
+		NUM_EVENTS
+	};
+
+	/**
+	 * Open the counters for the calling thread
+	 */
+	HardwareCounters();
+	~HardwareCounters();
+
+	bool isAvailable() const { return this->numOpen > 0; }
+	bool isEventAvailable(Event event) const { return this->groupIndex[event] >= 0; }
+
+	/**
+	 * The reason why the counters are not available (empty if they are)
+	 */
+	const std::string& getError() const { return this->error; }
+
+	/**
+	 * Start a new evaluation
+	 */
+	void begin();
+
+	/**
+	 * End the phase `phase` (i.e., attribute everything since the last call to `begin` or `mark` to this phase)
+	 */
+	void mark(Phase phase);
+
+	/**
+	 * The (scaled) total count of the event over all occurrences of the phase
+	 */
+	double getTotal(Phase phase, Event event) const;
+
+	/**
+	 * How often the phase ended
+	 */
+	uint64_t getOccurrences(Phase phase) const { return this->occurrences[phase]; }
+
+	static const char* getPhaseName(Phase phase);
+
+private:
+	int fd[NUM_EVENTS];
+	int groupIndex[NUM_EVENTS];
+	uint16_t numOpen;
+	std::string error;
+
+	/* Layout of the values read from the group leader */
+	struct Reading {
+		uint64_t nr;
+		uint64_t timeEnabled;
+		uint64_t timeRunning;
+		uint64_t values[NUM_EVENTS];
+	};
+
+	Reading last;
+	uint64_t totals[NUM_PHASES][NUM_EVENTS];
+	uint64_t timeEnabled[NUM_PHASES];
+	uint64_t timeRunning[NUM_PHASES];
+	uint64_t occurrences[NUM_PHASES];
+
+	bool read(Reading &reading) const;
+
+	HardwareCounters(const HardwareCounters&);
+	HardwareCounters& operator=(const HardwareCounters&);
+};
+
+/**
+ * Collect the hardware counters of all threads evaluating variable subsets during a run.
+ *
+ * While a profile exists, the evaluators get the counters for the calling thread via
+ * `HardwareProfile::countersForCurrentThread()`; the counters are opened when a thread
+ * evaluates its first subset. If no profile exists, this is a single comparison and the
+ * evaluators do not touch the counters at all.
+ * Only one profile can exist at a time.
+ */
+class HardwareProfile {
+public:
+	HardwareProfile();
+	~HardwareProfile();
+
+	/**
+	 * The counters for the calling thread or NULL if no profile is active
+	 */
+	static HardwareCounters* countersForCurrentThread() {
+		if(HardwareProfile::active == NULL) {
+			return NULL;
+		}
+		return HardwareProfile::active->getThreadCounters();
+	}
+
+	/**
+	 * The number of threads that evaluated at least one subset
+	 */
+	size_t getNumThreads() const { return this->threads.size(); }
+
+	const HardwareCounters& getCounters(size_t thread) const { return *this->threads[thread].counters; }
+
+	/**
+	 * True if the counters were opened by the thread that created the profile
+	 */
+	bool isMainThread(size_t thread) const { return this->threads[thread].mainThread; }
+
+	/**
+	 * Do not collect any counters until `resume` is called (no other thread may evaluate meanwhile)
+	 */
+	void suspend() { HardwareProfile::active = NULL; }
+	void resume() { HardwareProfile::active = this; }
+
+private:
+	struct ThreadCounters {
+		HardwareCounters *counters;
+		bool mainThread;
+	};
+
+	static HardwareProfile *active;
+
+	std::vector<ThreadCounters> threads;
+
+#ifdef HAVE_PTHREAD_H
+	pthread_t creator;
+	pthread_key_t key;
+	pthread_mutex_t mutex;
+#else
+	HardwareCounters *counters;
+#endif
+
+	HardwareCounters* getThreadCounters();
+
+	HardwareProfile(const HardwareProfile&);
+	HardwareProfile& operator=(const HardwareProfile&);
+};
+
+#endif
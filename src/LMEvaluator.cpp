@@ -9,59 +9,400 @@
 #include "config.h"
 
 #include <limits>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 #include <RcppArmadillo.h>
 
 #include "LMEvaluator.h"
+#include "RowWeights.h"
+#include "SimdKernels.h"
 #include "Logger.h"
 
-LMEvaluator::LMEvaluator(const arma::mat &X, const arma::colvec &y, const LMEvaluator::Statistic statistic, const VerbosityLevel &verbosity, const bool addIntercept) : Evaluator(verbosity), y(y), statistic(statistic), Xdesign(X) {
+LMEvaluator::LMEvaluator(const arma::mat &X, const arma::colvec &y, const LMEvaluator::Statistic statistic, const VerbosityLevel &verbosity,
+						 const bool addIntercept, size_t cacheBytes, const arma::uvec &forcedColumns) :
+	Evaluator(verbosity), y(y), statistic(statistic), forcedColumns(forcedColumns), cacheBytes(cacheBytes) {
+	arma::mat *Xdesign = new arma::mat(X);
+	this->Xdesign.reset(Xdesign);
+
 	if(addIntercept) {
 		arma::colvec intercept(X.n_rows);
 		intercept.ones();
-		this->Xdesign.insert_cols(0, intercept);
+		Xdesign->insert_cols(0, intercept);
+	}
+
+	this->r2denom = arma::accu(arma::square(this->y - arma::mean(this->y)));
+	this->yty = arma::dot(this->y, this->y);
+
+	if(cacheBytes > 0) {
+		this->cache.reset(new CrossProductCache(this->Xdesign, this->rows, this->y, cacheBytes));
 	}
 
+	this->factorRootColumns();
+}
+
+LMEvaluator::LMEvaluator(const std::shared_ptr<const arma::mat> &Xdesign, const arma::colvec &y, const LMEvaluator::Statistic statistic,
+						 const VerbosityLevel &verbosity, const arma::uvec &rows, size_t cacheBytes, const arma::uvec &forcedColumns) :
+	Evaluator(verbosity), y(y), statistic(statistic), Xdesign(Xdesign), rows(rows), forcedColumns(forcedColumns), cacheBytes(cacheBytes) {
 	this->r2denom = arma::accu(arma::square(this->y - arma::mean(this->y)));
+	this->yty = arma::dot(this->y, this->y);
+
+	if(cacheBytes > 0) {
+		this->cache.reset(new CrossProductCache(this->Xdesign, this->rows, this->y, cacheBytes));
+	}
+
+	this->factorRootColumns();
+}
+
+void LMEvaluator::factorRootColumns() {
+	this->rootColumns.set_size(this->forcedColumns.n_elem + 1);
+	this->rootColumns[0] = 0;
+
+	if(this->forcedColumns.n_elem > 0) {
+		this->isForced.assign(this->Xdesign->n_cols - 1, false);
+		for(arma::uword i = 0; i < this->forcedColumns.n_elem; ++i) {
+			if(this->forcedColumns[i] >= this->isForced.size()) {
+				throw std::invalid_argument("The forced columns must be columns of the data matrix");
+			}
+			this->isForced[this->forcedColumns[i]] = true;
+			this->rootColumns[i + 1] = this->forcedColumns[i] + 1;
+		}
+	}
+
+	arma::mat Xroot = (this->rows.n_elem > 0) ? arma::mat(this->Xdesign->submat(this->rows, this->rootColumns)) :
+												arma::mat(this->Xdesign->cols(this->rootColumns));
+	arma::mat R;
+
+	if(!arma::chol(R, Xroot.t() * Xroot)) {
+		throw std::invalid_argument("The variables that are always included are linear dependent");
+	}
+
+	this->rootL = R.t();
+	this->rootZ = arma::solve(arma::trimatl(this->rootL), Xroot.t() * this->y);
+}
+
+arma::uvec LMEvaluator::freeColumns(const arma::uvec &columnSubset) const {
+	if(this->isForced.empty()) {
+		return columnSubset;
+	}
+
+	arma::uvec free(columnSubset.n_elem);
+	arma::uword numFree = 0;
+
+	for(arma::uword i = 0; i < columnSubset.n_elem; ++i) {
+		if(!this->isForced[columnSubset[i]]) {
+			free[numFree++] = columnSubset[i];
+		}
+	}
+
+	free.resize(numFree);
+	return free;
+}
+
+Evaluator* LMEvaluator::cloneWithResponse(const arma::vec &y) const {
+	if(y.n_elem != this->y.n_elem) {
+		throw std::invalid_argument("The response must have the same number of observations as the original response");
+	}
+	return new LMEvaluator(this->Xdesign, y, this->statistic, this->verbosity, this->rows, this->cacheBytes, this->forcedColumns);
+}
+
+Evaluator* LMEvaluator::cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const {
+	if(rowWeights.n_elem != this->y.n_elem) {
+		throw std::invalid_argument("There must be one weight for every observation");
+	}
+
+	/* The new rows are relative to the rows used by this object */
+	RowWeights weights(rowWeights);
+	arma::uvec rows = (this->rows.n_elem > 0) ? arma::uvec(this->rows.elem(weights.getRows())) : weights.getRows();
+
+	return new LMEvaluator(this->Xdesign, this->y.elem(weights.getRows()), this->statistic, this->verbosity, rows, this->cacheBytes,
+						   this->forcedColumns);
 }
 
+void LMEvaluator::addCacheStatistics(CacheStatistics &stats) const {
+	if(this->cache) {
+		stats.lookups += this->cache->getLookups();
+		stats.hits += this->cache->getHits();
+		stats.bytes += this->cache->getBytes();
+	}
+}
+
+const double LMEvaluator::SINGULARITY_TOLERANCE = 1e-10;
+
 double LMEvaluator::evaluate(arma::uvec &columnSubset) {
-	double ret = 0.0;
-	columnSubset += 1;
-	columnSubset.insert_rows(0, 1);
-	
-	arma::mat Xsub(this->Xdesign.cols(columnSubset));
+	/* The intercept and the forced columns come first */
+	columnSubset = arma::join_cols(this->rootColumns, this->freeColumns(columnSubset) + 1);
+
+	this->beginPhases();
+
+	if(this->cache) {
+		double RSS;
+		if(this->cachedRSS(columnSubset, RSS)) {
+			this->endPhase(HardwareCounters::PHASE_FIT);
+			return this->computeStatistic(RSS, this->y.n_elem, columnSubset.n_elem);
+		}
+		/* Let the QR based solver handle (nearly) singular subsets */
+	}
+
+	arma::mat Xsub = (this->rows.n_elem > 0) ? arma::mat(this->Xdesign->submat(this->rows, columnSubset)) : arma::mat(this->Xdesign->cols(columnSubset));
+	this->endPhase(HardwareCounters::PHASE_GATHER);
 	try {
 		arma::colvec coef = arma::solve(Xsub, this->y);
-		arma::colvec residuals = this->y - Xsub * coef;
-		
-		double RSS = arma::accu(arma::square(residuals));
+		this->endPhase(HardwareCounters::PHASE_FIT);
+		arma::colvec fitted = Xsub * coef;
 		
-		switch(this->statistic) {
-			case BIC: {
-				ret = -(Xsub.n_rows * log(RSS / Xsub.n_rows) + Xsub.n_cols * log((double) Xsub.n_rows));
-				break;
+		double RSS = SimdKernels::sumSquaredDiff(this->y.memptr(), fitted.memptr(), fitted.n_elem);
+		this->endPhase(HardwareCounters::PHASE_PREDICT);
+
+		return this->computeStatistic(RSS, Xsub.n_rows, Xsub.n_cols);
+	} catch(const std::runtime_error& re) {
+		throw Evaluator::EvaluatorException("The subset could not be evaluated because the system could not be solved (probably the subset is singular)");
+	} catch(...) {
+		throw Evaluator::EvaluatorException("The subset could not be evaluated due to an unknown error.");
+	}
+}
+
+bool LMEvaluator::cachedRSS(const arma::uvec &columns, double &RSS) {
+	const arma::uword k = columns.n_elem;
+	arma::mat XtX;
+	arma::vec Xty;
+	arma::mat L(k, k);
+	arma::vec z(k);
+	const arma::uword numRoot = this->rootColumns.n_elem;
+	arma::uword i, j, m;
+	double d2, sumSqZ = arma::dot(this->rootZ, this->rootZ);
+
+	this->cache->gather(columns, XtX, Xty);
+	this->endPhase(HardwareCounters::PHASE_GATHER);
+
+	/*
+	 * Cholesky factorization X'X = L L' and z = L^-1 X'y, column by column.
+	 * The factorization of the root columns (the first columns) is already known.
+	 */
+	L.submat(0, 0, numRoot - 1, numRoot - 1) = this->rootL;
+	z.head(numRoot) = this->rootZ;
+
+	for(j = numRoot; j < k; ++j) {
+		d2 = XtX(j, j);
+		z[j] = Xty[j];
+
+		for(i = 0; i < j; ++i) {
+			L(j, i) = XtX(i, j);
+			for(m = 0; m < i; ++m) {
+				L(j, i) -= L(i, m) * L(j, m);
+			}
+			L(j, i) /= L(i, i);
+			d2 -= L(j, i) * L(j, i);
+			z[j] -= L(j, i) * z[i];
+		}
+
+		if(d2 <= LMEvaluator::SINGULARITY_TOLERANCE * XtX(j, j)) {
+			return false;
+		}
+
+		L(j, j) = std::sqrt(d2);
+		z[j] /= L(j, j);
+		sumSqZ += z[j] * z[j];
+	}
+
+	RSS = std::max(this->yty - sumSqZ, 0.0);
+	return true;
+}
+
+/*
+ * Compare two column subsets lexicographically
+ */
+class CompSubsetsLexicographic : public std::binary_function<const arma::uvec*, const arma::uvec*, bool> {
+public:
+	bool operator()(const arma::uvec* const lhs, const arma::uvec* const rhs) const {
+		return std::lexicographical_compare(lhs->begin(), lhs->end(), rhs->begin(), rhs->end());
+	}
+};
+
+void LMEvaluator::evaluateBatch(const std::vector<arma::uvec> &columnSubsets, std::vector<double> &fitness) {
+	const arma::uword n = this->y.n_elem;
+	const double yty = this->yty;
+	const arma::uword numRoot = this->rootColumns.n_elem;
+	arma::uword i, j, depth, maxColumns = 0;
+	double xtx, d2, xty, lz;
+
+	fitness.assign(columnSubsets.size(), std::numeric_limits<double>::quiet_NaN());
+
+	/*
+	 * Sort the columns within every subset and the subsets themselves
+	 */
+	std::vector<arma::uvec> sortedSubsets(columnSubsets.size());
+	std::vector<const arma::uvec*> order(columnSubsets.size());
+
+	for(i = 0; i < columnSubsets.size(); ++i) {
+		sortedSubsets[i] = arma::sort(this->freeColumns(columnSubsets[i]));
+		order[i] = &sortedSubsets[i];
+
+		if(sortedSubsets[i].n_elem > maxColumns) {
+			maxColumns = sortedSubsets[i].n_elem;
+		}
+	}
+
+	std::sort(order.begin(), order.end(), CompSubsetsLexicographic());
+
+	/*
+	 * The current path in the prefix tree. The intercept and the forced columns
+	 * are the root and are part of every path.
+	 * For the columns on the path, the following is kept:
+	 *	- the columns of the design matrix (restricted to the used rows), unless the
+	 *	  cross-products are taken from the cache
+	 *	- the Cholesky factor L of their cross-product matrix (lower triangular)
+	 *	- z = L^-1 X'y, so the RSS of the path is y'y - ||z||^2
+	 */
+	std::vector<arma::uword> path(this->rootColumns.begin(), this->rootColumns.end());
+	arma::mat pathColumns(this->cache ? 0 : n, maxColumns + numRoot);
+	arma::mat L(maxColumns + numRoot, maxColumns + numRoot);
+	arma::vec z(maxColumns + numRoot);
+	arma::vec cumSqZ(maxColumns + numRoot + 1);
+	arma::vec l(maxColumns + numRoot);
+
+	/* The depth at which the path became singular (none if greater than the path length) */
+	arma::uword singularDepth = maxColumns + numRoot + 1;
+
+	path.reserve(maxColumns + numRoot);
+	L.zeros();
+	cumSqZ[0] = 0.0;
+
+	/* The root is already factored */
+	L.submat(0, 0, numRoot - 1, numRoot - 1) = this->rootL;
+	z.head(numRoot) = this->rootZ;
+
+	for(j = 0; j < numRoot; ++j) {
+		cumSqZ[j + 1] = cumSqZ[j] + z[j] * z[j];
+
+		if(!this->cache) {
+			if(this->rows.n_elem > 0) {
+				for(i = 0; i < n; ++i) {
+					pathColumns(i, j) = this->Xdesign->at(this->rows[i], path[j]);
+				}
+			} else {
+				pathColumns.col(j) = this->Xdesign->col(path[j]);
+			}
+		}
+	}
+
+	for(std::vector<const arma::uvec*>::const_iterator subsetIt = order.begin(); subsetIt != order.end(); ++subsetIt) {
+		const arma::uvec &subset = **subsetIt;
+		const size_t subsetIndex = (*subsetIt) - &sortedSubsets[0];
+
+		/*
+		 * Go back to the longest common prefix with the current path (without the root)
+		 */
+		depth = numRoot;
+		while(depth < path.size() && depth - numRoot < subset.n_elem && path[depth] == subset[depth - numRoot] + 1) {
+			++depth;
+		}
+
+		path.resize(depth);
+
+		if(singularDepth >= path.size()) {
+			singularDepth = maxColumns + numRoot + 1;
+		}
+
+		/*
+		 * Extend the path by the remaining columns of the subset
+		 */
+		for(j = path.size(); j < subset.n_elem + numRoot; ++j) {
+			const arma::uword column = subset[j - numRoot] + 1;
+			depth = path.size();
+
+			if(!this->cache) {
+				if(this->rows.n_elem > 0) {
+					for(i = 0; i < n; ++i) {
+						pathColumns(i, depth) = this->Xdesign->at(this->rows[i], column);
+					}
+				} else {
+					pathColumns.col(depth) = this->Xdesign->col(column);
+				}
 			}
-			case AIC: {
-				ret = -(Xsub.n_rows * log(RSS / Xsub.n_rows) + Xsub.n_cols * 2.0);
-				break;
+
+			path.push_back(column);
+
+			if(singularDepth <= depth) {
+				continue;
 			}
-			case ADJ_R2: {
-				double r2 = 1 - (RSS / this->r2denom);
-				ret = 1 - (((Xsub.n_rows - 1) * (1 - r2)) / (Xsub.n_rows - Xsub.n_cols - 1));
-				break;
+
+			/*
+			 * Solve L l = X_path' x by forward substitution
+			 */
+			if(this->cache) {
+				xtx = this->cache->xtx(column, column);
+				xty = this->cache->xty(column);
+			} else {
+				xtx = arma::dot(pathColumns.col(depth), pathColumns.col(depth));
+				xty = arma::dot(pathColumns.col(depth), this->y);
 			}
-			case R2: {
-				ret = 1 - (RSS / this->r2denom);
-				break;
+			d2 = xtx;
+			lz = 0.0;
+
+			for(i = 0; i < depth; ++i) {
+				l[i] = (this->cache) ? this->cache->xtx(path[i], column) : arma::dot(pathColumns.col(i), pathColumns.col(depth));
+				for(arma::uword k = 0; k < i; ++k) {
+					l[i] -= L(i, k) * l[k];
+				}
+				l[i] /= L(i, i);
+				d2 -= l[i] * l[i];
+				lz += l[i] * z[i];
 			}
-			default:
-				break;
+
+			if(d2 <= LMEvaluator::SINGULARITY_TOLERANCE * xtx) {
+				singularDepth = depth;
+				continue;
+			}
+
+			for(i = 0; i < depth; ++i) {
+				L(depth, i) = l[i];
+			}
+			L(depth, depth) = std::sqrt(d2);
+			z[depth] = (xty - lz) / L(depth, depth);
+			cumSqZ[depth + 1] = cumSqZ[depth] + z[depth] * z[depth];
+		}
+
+		if(singularDepth < path.size()) {
+			/* Let the QR based solver handle (nearly) singular subsets */
+			arma::uvec columnSubset(columnSubsets[subsetIndex]);
+
+			try {
+				fitness[subsetIndex] = this->evaluate(columnSubset);
+			} catch(const Evaluator::EvaluatorException &ee) {
+				fitness[subsetIndex] = std::numeric_limits<double>::quiet_NaN();
+			}
+		} else {
+			fitness[subsetIndex] = this->computeStatistic(std::max(yty - cumSqZ[path.size()], 0.0), n, path.size());
 		}
-	} catch(const std::runtime_error& re) {
-		throw Evaluator::EvaluatorException("The subset could not be evaluated because the system could not be solved (probably the subset is singular)");
-	} catch(...) {
-		throw Evaluator::EvaluatorException("The subset could not be evaluated due to an unknown error.");
 	}
-	
+}
+
+double LMEvaluator::computeStatistic(double RSS, arma::uword numObservations, arma::uword numCoefficients) const {
+	double ret = 0.0;
+
+	switch(this->statistic) {
+		case BIC: {
+			ret = -(numObservations * log(RSS / numObservations) + numCoefficients * log((double) numObservations));
+			break;
+		}
+		case AIC: {
+			ret = -(numObservations * log(RSS / numObservations) + numCoefficients * 2.0);
+			break;
+		}
+		case ADJ_R2: {
+			double r2 = 1 - (RSS / this->r2denom);
+			ret = 1 - (((numObservations - 1) * (1 - r2)) / (numObservations - numCoefficients - 1));
+			break;
+		}
+		case R2: {
+			ret = 1 - (RSS / this->r2denom);
+			break;
+		}
+		default:
+			break;
+	}
+
 	return ret;
 }
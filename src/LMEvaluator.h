@@ -12,9 +12,12 @@
 #include "config.h"
 
 #include <exception>
+#include <memory>
+#include <vector>
 #include <RcppArmadillo.h>
 #include "Evaluator.h"
 #include "Chromosome.h"
+#include "CrossProductCache.h"
 
 class LMEvaluator : public Evaluator {
 public:
@@ -25,13 +28,29 @@ public:
 		R2 = 3
 	};
 	
-	LMEvaluator(const arma::mat &X, const arma::colvec &y, const LMEvaluator::Statistic statistic, const VerbosityLevel &verbosity, const bool addIntercept = true);
+	/**
+	 * @param cacheBytes If greater than 0, subsets are fit from the cross-products X'X and X'y, which are
+	 *			computed on demand and cached (see CrossProductCache) using at most this many bytes
+	 * @param forcedColumns The columns of X that are part of every model. Together with the intercept
+	 *			they are factored only once and every subset only extends this factorization.
+	 *			If these columns are part of a subset, they are ignored.
+	 */
+	LMEvaluator(const arma::mat &X, const arma::colvec &y, const LMEvaluator::Statistic statistic, const VerbosityLevel &verbosity,
+				const bool addIntercept = true, size_t cacheBytes = 0, const arma::uvec &forcedColumns = arma::uvec());
 	//	~LMEvaluator();
 	
 	double evaluate(arma::uvec &columnSubset);
-	
+
+	/**
+	 * Evaluate all subsets along a prefix tree of their (sorted) columns: the subsets are visited
+	 * in lexicographic order and the Cholesky factor of X'X is only extended by the columns that
+	 * are not shared with the previous subset. Shared prefixes are thus factored only once.
+	 * Subsets with (numerically) linear dependent columns are evaluated by evaluate().
+	 */
+	void evaluateBatch(const std::vector<arma::uvec> &columnSubsets, std::vector<double> &fitness);
+
 	double evaluate(Chromosome &ch) {
-		arma::uvec columnSubset = ch.toColumnSubset();
+		arma::uvec columnSubset = ch.toColumnSubset(false);
 		double fitness = this->evaluate(columnSubset);
 		ch.setFitness(fitness);
 		return fitness;
@@ -40,13 +59,69 @@ public:
 	 * The UserFunEvaluator can not be cloned!!
 	 * It throws an std::logic_error if called
 	 */
-	Evaluator* clone() const { return new LMEvaluator(this->Xdesign, this->y, this->statistic, this->verbosity, false); }
+	Evaluator* clone() const {
+		return new LMEvaluator(this->Xdesign, this->y, this->statistic, this->verbosity, this->rows, this->cacheBytes, this->forcedColumns);
+	}
+
+	Evaluator* cloneWithResponse(const arma::vec &y) const;
+	Evaluator* cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const;
+
+	void addCacheStatistics(CacheStatistics &stats) const;
 private:
 	const arma::colvec y;
 	const LMEvaluator::Statistic statistic;
 
-	arma::mat Xdesign; // X matrix with a 1 column in front
+	/* X matrix with a 1 column in front (shared by all clones) */
+	std::shared_ptr<const arma::mat> Xdesign;
+
+	/* The rows of the design matrix to use (empty if all rows are used) */
+	const arma::uvec rows;
 	double r2denom;
+	double yty;
+
+	/* The columns of X that are part of every model */
+	const arma::uvec forcedColumns;
+	std::vector<bool> isForced;
+
+	/*
+	 * The columns of the design matrix that are part of every model (the intercept and the forced columns),
+	 * the Cholesky factor of their cross-product matrix and z = L^-1 X'y for these columns
+	 */
+	arma::uvec rootColumns;
+	arma::mat rootL;
+	arma::vec rootZ;
+
+	/* Every clone has its own cache */
+	const size_t cacheBytes;
+	std::unique_ptr<CrossProductCache> cache;
+
+	/*
+	 * A column is considered linear dependent on the previous columns if the squared norm
+	 * of its orthogonal part is less than this fraction of its squared norm
+	 */
+	static const double SINGULARITY_TOLERANCE;
+
+	double computeStatistic(double RSS, arma::uword numObservations, arma::uword numCoefficients) const;
+
+	/**
+	 * Compute the RSS from the cached cross-products of the columns of the design matrix
+	 *
+	 * @return false if the columns are (numerically) linear dependent
+	 */
+	bool cachedRSS(const arma::uvec &columns, double &RSS);
+
+	/**
+	 * Factor the columns that are part of every model
+	 */
+	void factorRootColumns();
+
+	/**
+	 * The columns of the subset that are not forced into the model
+	 */
+	arma::uvec freeColumns(const arma::uvec &columnSubset) const;
+
+	LMEvaluator(const std::shared_ptr<const arma::mat> &Xdesign, const arma::colvec &y, const LMEvaluator::Statistic statistic,
+				const VerbosityLevel &verbosity, const arma::uvec &rows, size_t cacheBytes, const arma::uvec &forcedColumns);
 };
 
 #endif
@@ -0,0 +1,62 @@
+//
+//  LocalityOrder.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <RcppArmadillo.h>
+
+#include "LocalityOrder.h"
+
+/* Odd multipliers for multiply-shift hashing */
+const uint64_t LocalityOrder::MULTIPLIERS[LocalityOrder::NUM_HASHES] = {
+	0x9E3779B97F4A7C15ULL,
+	0xC2B2AE3D27D4EB4FULL,
+	0x165667B19E3779F9ULL,
+	0xD6E8FEB86659FD93ULL
+};
+
+std::vector<size_t> LocalityOrder::order(const std::vector<arma::uvec> &columnSubsets) {
+	std::vector<uint32_t> signatures(columnSubsets.size() * NUM_HASHES);
+	std::vector<size_t> order(columnSubsets.size());
+
+	for(size_t i = 0; i < columnSubsets.size(); ++i) {
+		LocalityOrder::signature(columnSubsets[i], &signatures[i * NUM_HASHES]);
+		order[i] = i;
+	}
+
+	std::stable_sort(order.begin(), order.end(), SignatureComparator(signatures));
+
+	return order;
+}
+
+void LocalityOrder::signature(const arma::uvec &columns, uint32_t *signature) {
+	uint8_t k;
+
+	for(k = 0; k < NUM_HASHES; ++k) {
+		signature[k] = std::numeric_limits<uint32_t>::max();
+	}
+
+	for(arma::uword i = 0; i < columns.n_elem; ++i) {
+		const uint64_t column = (uint64_t) columns[i] + 1;
+
+		for(k = 0; k < NUM_HASHES; ++k) {
+			const uint32_t hash = (uint32_t) ((MULTIPLIERS[k] * column) >> 32);
+			if(hash < signature[k]) {
+				signature[k] = hash;
+			}
+		}
+	}
+}
+
+bool LocalityOrder::SignatureComparator::operator()(size_t lhs, size_t rhs) const {
+	std::vector<uint32_t>::const_iterator lhsIt = this->signatures.begin() + lhs * NUM_HASHES;
+	std::vector<uint32_t>::const_iterator rhsIt = this->signatures.begin() + rhs * NUM_HASHES;
+
+	return std::lexicographical_compare(lhsIt, lhsIt + NUM_HASHES, rhsIt, rhsIt + NUM_HASHES);
+}
@@ -0,0 +1,58 @@
+//
+//  LocalityOrder.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_LocalityOrder_h
+#define gaselect_LocalityOrder_h
+
+#include "config.h"
+
+#include <vector>
+#include <RcppArmadillo.h>
+
+/**
+ * Order variable subsets such that subsets sharing many variables are evaluated back-to-back.
+ *
+ * Every subset gets a MinHash signature, i.e., for each of NUM_HASHES hash functions the smallest
+ * hash of its columns. Two subsets agree in a component of the signature with a probability equal
+ * to their Jaccard similarity, so sorting the subsets lexicographically by their signature puts
+ * similar subsets next to each other. The columns gathered for a subset (and the blocks of the
+ * cross-product cache) are then likely still in the CPU cache when the next subset is evaluated.
+ *
+ * The hash functions are fixed, so the order only depends on the subsets.
+ */
+class LocalityOrder {
+public:
+	static const uint8_t NUM_HASHES = 4;
+
+	/**
+	 * The order in which the subsets should be evaluated
+	 *
+	 * @param columnSubsets The column indices of every subset
+	 * @return The indices of the subsets in evaluation order
+	 */
+	static std::vector<size_t> order(const std::vector<arma::uvec> &columnSubsets);
+
+private:
+	static const uint64_t MULTIPLIERS[NUM_HASHES];
+
+	/* Compare the signatures of two subsets (stored consecutively) */
+	class SignatureComparator {
+	public:
+		SignatureComparator(const std::vector<uint32_t> &signatures) : signatures(signatures) {}
+
+		bool operator()(size_t lhs, size_t rhs) const;
+
+	private:
+		const std::vector<uint32_t> &signatures;
+	};
+
+	/**
+	 * Write the signature of the subset to `signature`
+	 */
+	static void signature(const arma::uvec &columns, uint32_t *signature);
+};
+
+#endif
@@ -0,0 +1,79 @@
+//
+//  MemoryBudget.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <string>
+#include <sstream>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#include "MemoryBudget.h"
+
+const double MemoryBudget::MIN_CACHE_BYTES = 1024.0 * 1024.0;
+
+static const double BYTES_PER_MB = 1024.0 * 1024.0;
+
+MemoryBudget::MemoryBudget(double limitBytes, const Estimate &estimate) :
+	limitBytes(limitBytes), estimate(estimate), numThreads(1), cacheFraction(1.0)
+{
+	if(!(this->limitBytes > 0.0)) {
+		throw std::invalid_argument("The memory limit must be positive");
+	}
+}
+
+void MemoryBudget::fit(uint16_t maxThreads) {
+	if(this->estimate.total(1, 0.0) > this->limitBytes) {
+		throw std::runtime_error(this->describe());
+	}
+
+	for(this->numThreads = std::max<uint16_t>(maxThreads, 1);
+		this->numThreads > 1 && this->estimate.total(this->numThreads, 0.0) > this->limitBytes; --this->numThreads);
+
+	/* The caches get whatever is left */
+	this->cacheFraction = 0.0;
+	if(this->estimate.cacheBytes > 0.0) {
+		const double left = this->limitBytes - this->estimate.total(this->numThreads, 0.0);
+		this->cacheFraction = std::min(1.0, left / (this->numThreads * this->estimate.cacheBytes));
+
+		if(this->cacheFraction * this->estimate.cacheBytes < MemoryBudget::MIN_CACHE_BYTES) {
+			this->cacheFraction = 0.0;
+		}
+	}
+}
+
+std::string MemoryBudget::describe() const {
+	std::ostringstream msg;
+
+	msg << "The memory limit of " << (this->limitBytes / BYTES_PER_MB) << " MB is too small. Even with a single thread and "
+		<< "without caches an estimated " << (this->estimate.total(1, 0.0) / BYTES_PER_MB) << " MB are needed ("
+		<< (this->estimate.sharedBytes / BYTES_PER_MB) << " MB for the data, "
+		<< (this->estimate.threadBytes / BYTES_PER_MB) << " MB for the segmentation and workspace of a thread, "
+		<< (this->estimate.populationBytes / BYTES_PER_MB) << " MB for the population)";
+
+	return msg.str();
+}
+
+double MemoryBudget::peakResidentBytes() {
+#ifdef HAVE_SYS_RESOURCE_H
+	struct rusage usage;
+
+	if(getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+		/* macOS reports bytes, all other systems kilobytes */
+		return (double) usage.ru_maxrss;
+#else
+		return 1024.0 * (double) usage.ru_maxrss;
+#endif
+	}
+#endif
+	return std::numeric_limits<double>::quiet_NaN();
+}
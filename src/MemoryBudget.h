@@ -0,0 +1,81 @@
+//
+//  MemoryBudget.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_MemoryBudget_h
+#define gaselect_MemoryBudget_h
+
+#include "config.h"
+
+#include <string>
+
+/**
+ * Fit the memory used by the genetic algorithm into a limit.
+ *
+ * The footprint is estimated from the size of the data and the settings before anything is allocated.
+ * The data (e.g., the copy of X) is shared by all threads, but every thread needs its own segmentation,
+ * workspace and cross-product cache. If the estimate exceeds the limit, the caches are shrunk first
+ * and threads are only dropped if the limit is exceeded even without caches.
+ */
+class MemoryBudget {
+public:
+	/* Caches smaller than this are not worth it and are disabled */
+	static const double MIN_CACHE_BYTES;
+
+	struct Estimate {
+		double sharedBytes;		// Data used by all threads together
+		double threadBytes;		// Segmentation and workspace of a single thread
+		double cacheBytes;		// The requested size of the caches of a single thread
+		double populationBytes;	// The chromosomes of all generations and the elite
+
+		Estimate() : sharedBytes(0.0), threadBytes(0.0), cacheBytes(0.0), populationBytes(0.0) {}
+
+		inline double total(uint16_t numThreads, double cacheFraction) const {
+			return this->sharedBytes + this->populationBytes + numThreads * (this->threadBytes + cacheFraction * this->cacheBytes);
+		}
+	};
+
+	/**
+	 * @param limitBytes The maximum number of bytes to use
+	 * @param estimate The estimated footprint with the requested settings
+	 */
+	MemoryBudget(double limitBytes, const Estimate &estimate);
+
+	/**
+	 * Choose the number of threads and the size of the caches such that the estimated footprint
+	 * fits into the limit.
+	 *
+	 * @param maxThreads The requested number of threads
+	 * @throws std::runtime_error if a single thread without caches exceeds the limit
+	 */
+	void fit(uint16_t maxThreads);
+
+	uint16_t getNumThreads() const { return this->numThreads; }
+
+	/* The fraction of the requested cache size that can be used (between 0 and 1) */
+	double getCacheFraction() const { return this->cacheFraction; }
+
+	double getLimitBytes() const { return this->limitBytes; }
+
+	double getEstimatedBytes() const { return this->estimate.total(this->numThreads, this->cacheFraction); }
+
+	/**
+	 * The peak resident set size of the process in bytes (NaN if it is not available)
+	 */
+	static double peakResidentBytes();
+
+private:
+	const double limitBytes;
+	const Estimate estimate;
+	uint16_t numThreads;
+	double cacheFraction;
+
+	/**
+	 * Explain the parts of the estimate
+	 */
+	std::string describe() const;
+};
+
+#endif
@@ -12,6 +12,7 @@
 #include <exception>
 #include <vector>
 #include <algorithm>
+#include <chrono>
 #include <RcppArmadillo.h>
 #include <pthread.h>
 #include <errno.h>
@@ -68,11 +69,16 @@ MultiThreadedPopulation::MultiThreadedPopulation(const Control &ctrl, ::Evaluato
 	}
 	
 	this->startMating = false;
-	this->allThreadsFinishedMating = false;
+	this->matingRound = 0;
 	this->killThreads = false;
+	this->task = TASK_MATE;
 	
 	this->actuallySpawnedThreads = 0;
 	this->numThreadsFinishedMating = 0;
+
+	this->nextIdleJob = 0;
+	this->idleJobsEnd = 0;
+	this->numThreadsMated = 0;
 }
 
 /**
@@ -85,9 +91,10 @@ MultiThreadedPopulation::~MultiThreadedPopulation() {
 	pthread_cond_destroy(&this->allThreadsFinishedMatingCond);
 }
 
-void MultiThreadedPopulation::generateInitialChromosomes(uint16_t numChromosomes, ::Evaluator& evaluator,
+uint32_t MultiThreadedPopulation::generateInitialChromosomes(uint16_t numChromosomes, ::Evaluator& evaluator,
 		RNG& rng, ShuffledSet& shuffledSet, uint16_t offset, bool checkUserInterrupt) {
 
+	uint32_t numEvaluations = 0;
 	ChVecIt rangeBeginIt = this->nextGeneration.begin() + offset;
 	ChVecIt it = rangeBeginIt;
 	ChVecIt rangeEndIt = rangeBeginIt + numChromosomes;
@@ -97,6 +104,7 @@ void MultiThreadedPopulation::generateInitialChromosomes(uint16_t numChromosomes
 
 		if(std::find_if(rangeBeginIt, it, CompChromsomePtr(*it)) == it) {
 			try {
+				++numEvaluations;
 				evaluator.evaluate(**it);
 				++it;
 			} catch(const ::Evaluator::EvaluatorException &ee) {
@@ -120,13 +128,16 @@ void MultiThreadedPopulation::generateInitialChromosomes(uint16_t numChromosomes
 			}
 		}
 	}
+
+	return numEvaluations;
 }
 
 /**
  * Do the actual mating
  *
+ * @return The number of evaluations performed
  */
-void MultiThreadedPopulation::mate(uint16_t numChildren, ::Evaluator& evaluator,
+uint32_t MultiThreadedPopulation::mate(uint16_t numChildren, ::Evaluator& evaluator,
 	RNG& rng, ShuffledSet& shuffledSet, uint16_t offset,
 	bool checkUserInterrupt) {
 
@@ -148,6 +159,25 @@ void MultiThreadedPopulation::mate(uint16_t numChildren, ::Evaluator& evaluator,
 
 	uint32_t discSol1 = 0;
 	uint32_t discSol2 = 0;
+	uint32_t numEvaluations = 0;
+
+	if(this->ctrl.evaluationOrder == ORDER_LOCALITY) {
+		ChildBatch batch(numChildren);
+
+		while(!batch.isComplete() && !this->interrupted) {
+			numEvaluations += this->mateBatch(rangeBeginIt, batch, evaluator, rng, shuffledSet, this->sumCurrentGenFitness);
+
+			if(checkUserInterrupt == true) {
+				GAout.flushThreadSafeBuffer();
+				GAerr.flushThreadSafeBuffer();
+				if(check_interrupt()) {
+					this->interrupted = true;
+				}
+			}
+		}
+
+		return numEvaluations;
+	}
 
 	while(child1It < child2It.base() && !this->interrupted) {
 		childrenDifferent = (child1It + 1 != child2It.base());
@@ -161,10 +191,10 @@ void MultiThreadedPopulation::mate(uint16_t numChildren, ::Evaluator& evaluator,
 		
 		minParentFitness = ((tmpChromosome1->getFitness() > tmpChromosome2->getFitness()) ? tmpChromosome1->getFitness() : tmpChromosome2->getFitness());
 
-		(*child1It)->mutate(rng);
+		(*child1It)->mutate(rng, this->mutationSampler.get());
 
 		if (childrenDifferent) {
-			(*child2It)->mutate(rng);
+			(*child2It)->mutate(rng, this->mutationSampler.get());
 		}
 
 		/*
@@ -190,6 +220,7 @@ void MultiThreadedPopulation::mate(uint16_t numChildren, ::Evaluator& evaluator,
 			child1Tries = 0;
 
 			try {
+				++numEvaluations;
 				if(evaluator.evaluate(**child1It) > cutoff) {
 					/*
 					 * The child is no duplicate (or accepted as one) and is not too bad,
@@ -220,6 +251,7 @@ void MultiThreadedPopulation::mate(uint16_t numChildren, ::Evaluator& evaluator,
 			child2Tries = 0;
 
 			try {
+				++numEvaluations;
 				if(evaluator.evaluate(**child2It) > cutoff) {
 					/*
 					 * The child is no duplicate (or accepted as one) and is not too bad,
@@ -249,6 +281,8 @@ void MultiThreadedPopulation::mate(uint16_t numChildren, ::Evaluator& evaluator,
 			}
 		}
 	}
+
+	return numEvaluations;
 }
 
 /**
@@ -267,6 +301,11 @@ void MultiThreadedPopulation::run() {
 	uint16_t offset = 0;
 	pthread_attr_t threadAttr;
 	pthread_t* threads;
+	uint64_t mainThreadEvaluations = 0;
+	std::chrono::steady_clock::time_point generationStart, mainThreadFinished;
+	GenerationSlice mainThreadSlice;
+	std::unique_ptr<::Evaluator> mainThreadIdleEvaluator(this->createIdleEvaluator(this->seed));
+	std::vector<Chromosome> mainThreadIdleResults;
 
 	/*****************************************************************************************
 	 * Initialize the current/next generation and enable thread safety for the output
@@ -284,6 +323,8 @@ void MultiThreadedPopulation::run() {
 	GAout.enableThreadSafety(true);
 	GAerr.enableThreadSafety(true);
 
+	generationStart = std::chrono::steady_clock::now();
+
 	/*****************************************************************************************
 	 * Setup threads
 	 *****************************************************************************************/
@@ -314,12 +355,19 @@ void MultiThreadedPopulation::run() {
 		threadArgs[i].seed = rng();
 		threadArgs[i].evalObj = this->evaluator.clone();
 		threadArgs[i].chromosomeSize = this->ctrl.chromosomeSize;
+		threadArgs[i].numEvaluations = 0;
+		threadArgs[i].busySeconds = 0.0;
+		threadArgs[i].slice.begin = offset;
+		threadArgs[i].slice.end = offset + threadArgs[i].numChildren;
+		threadArgs[i].idleEvalObj = (mainThreadIdleEvaluator) ? mainThreadIdleEvaluator->clone() : NULL;
 
 		/*
 		 * Once created, the threads already start generating the initial generation!
 		 */
 		pthreadRC = pthread_create((threads + i), &threadAttr, &MultiThreadedPopulation::matingThreadStart, (void *) (threadArgs + i));
 		
+		threadArgs[i].spawned = (pthreadRC == 0);
+
 		if(pthreadRC == 0) {
 			++this->actuallySpawnedThreads;
 			offset += threadArgs[i].numChildren;
@@ -337,11 +385,15 @@ void MultiThreadedPopulation::run() {
 		GAout  << GAout.lock() << "Spawned " << this->actuallySpawnedThreads << " threads\n" << GAout.unlock();
 	}
 
+	mainThreadSlice.begin = offset;
+	mainThreadSlice.end = offset + numChildrenMainThread;
+
 	/*****************************************************************************************
 	 * Generate initial population
 	 *****************************************************************************************/
 
-	this->generateInitialChromosomes(numChildrenMainThread, this->evaluator, rng, shuffledSet, offset, true);
+	mainThreadEvaluations += this->generateInitialChromosomes(numChildrenMainThread, this->evaluator, rng, shuffledSet, offset, true);
+	mainThreadFinished = std::chrono::steady_clock::now();
 
 	/*****************************************************************************************
 	 * Wait for threads to create current generation and further process the initial population
@@ -365,7 +417,11 @@ void MultiThreadedPopulation::run() {
 
 		this->sumCurrentGenFitness = this->updateCurrentGeneration(this->nextGeneration, minFitness, true, true);
 
-		if(this->ctrl.verbosity >= VERBOSE && this->ctrl.verbosity != DEBUG_EVAL) {
+		this->publishThreadStatistics(0, threadArgs, maxThreadsToSpawn, mainThreadEvaluations,
+			std::chrono::duration<double>(mainThreadFinished - generationStart).count(),
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - generationStart).count());
+
+		if(this->printsGenerations()) {
 			this->printCurrentGeneration();
 		}
 	}
@@ -390,13 +446,10 @@ void MultiThreadedPopulation::run() {
 		/*****************************************************************************************
 		 * broadcast to all threads to start mating
 		 *****************************************************************************************/
-		CHECK_PTHREAD_RETURN_CODE(pthread_mutex_lock(&this->syncMutex))
-		
-		this->startMating = true;
-		
-		CHECK_PTHREAD_RETURN_CODE(pthread_cond_broadcast(&this->startMatingCond))
-		
-		CHECK_PTHREAD_RETURN_CODE(pthread_mutex_unlock(&this->syncMutex))
+		generationStart = std::chrono::steady_clock::now();
+
+		this->prepareIdleTask();
+		this->startThreads(TASK_MATE);
 		
 		/*
 		 * Mate two chromosomes to generate two children that are eventually mutated
@@ -404,9 +457,28 @@ void MultiThreadedPopulation::run() {
 		 * to generate 2 children
 		 *
 		 */
-		this->mate(numChildrenMainThread, this->evaluator, rng, shuffledSet, offset, true);
-		
+		mainThreadEvaluations += this->mate(numChildrenMainThread, this->evaluator, rng, shuffledSet, offset, true);
+		++this->numThreadsMated;
+
+		/* The idle task fills the time until all threads are done, so it does not count as busy */
+		mainThreadFinished = std::chrono::steady_clock::now();
+		mainThreadEvaluations += this->runIdleTask(this->evaluator, mainThreadIdleEvaluator.get(), rng, mainThreadIdleResults, true);
+
 		this->waitForAllThreadsToFinishMating();
+
+		/*
+		 * The results of the idle task enter the elite before the new generation does
+		 */
+		this->mergeIdleResults(mainThreadIdleResults);
+		for(j = maxThreadsToSpawn - 1; j >= 0; --j) {
+			this->mergeIdleResults(threadArgs[j].idleResults);
+		}
+
+		/***********************************************************************
+		 * Update the current generation and the sumFitness
+		 **********************************************************************/
+		this->updateCurrentGenerationConcurrently(threadArgs, maxThreadsToSpawn, mainThreadSlice);
+
 		/*
 		 * Signal output streams that multithreading is over
 		 */
@@ -414,16 +486,20 @@ void MultiThreadedPopulation::run() {
 		GAerr.enableThreadSafety(false);
 
 		/***********************************************************************
-		 * Update minFitness, the current generation and the sumFitness
-		 * and print the generation if requested
+		 * Print the generation if requested
 		 **********************************************************************/
-		minFitness = (*(std::min_element(this->nextGeneration.begin(), this->nextGeneration.end(), MultiThreadedPopulation::OrderChromosomePtr())))->getFitness();
 
-		this->sumCurrentGenFitness = this->updateCurrentGeneration(this->nextGeneration, minFitness, false, true);
+		this->publishThreadStatistics(this->ctrl.numGenerations - i + 1, threadArgs, maxThreadsToSpawn, mainThreadEvaluations,
+			std::chrono::duration<double>(mainThreadFinished - generationStart).count(),
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - generationStart).count());
 
-		if(this->ctrl.verbosity >= VERBOSE && this->ctrl.verbosity != DEBUG_EVAL) {
+		if(this->printsGenerations()) {
 			this->printCurrentGeneration();
 		}
+
+		if(this->adaptPopulationSize()) {
+			this->partitionGeneration(threadArgs, maxThreadsToSpawn, mainThreadSlice, numChildrenMainThread, offset);
+		}
 	}
 	
 	/*****************************************************************************************
@@ -448,11 +524,13 @@ void MultiThreadedPopulation::run() {
 		 */
 		CHECK_PTHREAD_RETURN_CODE(pthread_join(threads[i], NULL))
 		
+		threadArgs[i].evalObj->addCacheStatistics(this->retiredCacheStatistics);
 		delete threadArgs[i].evalObj;
+		delete threadArgs[i].idleEvalObj;
 	}
 	
-	delete threadArgs;
-	delete threads;
+	delete[] threadArgs;
+	delete[] threads;
 
 	GAout.enableThreadSafety(false);
 	GAerr.enableThreadSafety(false);
@@ -477,21 +555,24 @@ void* MultiThreadedPopulation::matingThreadStart(void* obj) {
 	ThreadArgsWrapper* args = static_cast<ThreadArgsWrapper*>(obj);
 	RNG rng(args->seed);
 	ShuffledSet shuffledSet(args->chromosomeSize);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
 	/* First generate a bunch of initial chromosomes */
-	args->popObj->generateInitialChromosomes(args->numChildren, *args->evalObj, rng, shuffledSet, args->offset, false);
+	args->numEvaluations += args->popObj->generateInitialChromosomes(args->numChildren, *args->evalObj, rng, shuffledSet, args->offset, false);
+	args->busySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 	args->popObj->waitForAllThreadsToFinishMating();
 
 	/* The start the mating cycle */
-	args->popObj->runMating(args->numChildren, *args->evalObj, rng, shuffledSet, args->offset);
+	args->popObj->runMating(*args, rng, shuffledSet);
 	return NULL;
 }
 
 /**
  * Run the mating control loop
  */
-void MultiThreadedPopulation::runMating(uint16_t numMatingCouples, ::Evaluator& evaluator,
-		RNG& rng, ShuffledSet& shuffledSet, uint16_t offset) {
+void MultiThreadedPopulation::runMating(ThreadArgsWrapper &args, RNG& rng, ShuffledSet& shuffledSet) {
+	std::chrono::steady_clock::time_point start;
+
 	while(true) {
 		/*****************************************************************************************
 		 * Wait until the thread is started
@@ -513,39 +594,289 @@ void MultiThreadedPopulation::runMating(uint16_t numMatingCouples, ::Evaluator&
 		CHECK_PTHREAD_RETURN_CODE(pthread_mutex_unlock(&this->syncMutex))
 		
 		/*****************************************************************************************
-		 * Do actual mating
+		 * Do actual mating or update the thread's part of the current generation
 		 *****************************************************************************************/
-		this->mate(numMatingCouples, evaluator, rng, shuffledSet, offset, false);
+		if(this->task == TASK_MATE) {
+			start = std::chrono::steady_clock::now();
+			args.numEvaluations += this->mate(args.numChildren, *args.evalObj, rng, shuffledSet, args.offset, false);
+			++this->numThreadsMated;
+			args.busySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			args.numEvaluations += this->runIdleTask(*args.evalObj, args.idleEvalObj, rng, args.idleResults);
+		} else {
+			this->updateCurrentGenerationSlice(this->nextGeneration, args.slice);
+		}
 		
 		/*****************************************************************************************
-		 * Signal that the thread has finished mating
+		 * Signal that the thread has finished its task
 		 *****************************************************************************************/
 		this->waitForAllThreadsToFinishMating();
 	}
 }
 
+/**
+ * Publish the number of evaluations and the thread utilization of the last generation
+ */
+inline void MultiThreadedPopulation::publishThreadStatistics(uint16_t generation, const ThreadArgsWrapper* threadArgs,
+	uint16_t numThreadArgs, uint64_t mainThreadEvaluations, double mainThreadBusySeconds, double wallSeconds) {
+	if(!this->telemetry) {
+		return;
+	}
+
+	uint64_t numEvaluations = mainThreadEvaluations;
+	double busySeconds = mainThreadBusySeconds;
+	::Evaluator::CacheStatistics cacheStats = this->getCacheStatistics();
+
+	/* All worker threads are waiting for the next generation, so their evaluators can be queried */
+	for(uint16_t i = 0; i < numThreadArgs; ++i) {
+		numEvaluations += threadArgs[i].numEvaluations;
+		busySeconds += threadArgs[i].busySeconds;
+		threadArgs[i].evalObj->addCacheStatistics(cacheStats);
+	}
+
+	this->publishProgress(generation, numEvaluations,
+		(wallSeconds > 0) ? busySeconds / ((this->actuallySpawnedThreads + 1) * wallSeconds) : 1.0, &cacheStats);
+}
+
+/**
+ * Start all threads waiting for the next task
+ */
+inline void MultiThreadedPopulation::startThreads(WorkerTask task) {
+	CHECK_PTHREAD_RETURN_CODE(pthread_mutex_lock(&this->syncMutex))
+
+	this->task = task;
+	this->startMating = true;
+
+	CHECK_PTHREAD_RETURN_CODE(pthread_cond_broadcast(&this->startMatingCond))
+
+	CHECK_PTHREAD_RETURN_CODE(pthread_mutex_unlock(&this->syncMutex))
+}
+
+/**
+ * Update the current generation with the help of all threads
+ */
+inline void MultiThreadedPopulation::updateCurrentGenerationConcurrently(const ThreadArgsWrapper* threadArgs, uint16_t numThreadArgs,
+	GenerationSlice &mainThreadSlice) {
+	std::vector<const GenerationSlice*> slices;
+	int i;
+
+	this->startThreads(TASK_UPDATE_GENERATION);
+	this->updateCurrentGenerationSlice(this->nextGeneration, mainThreadSlice);
+	this->waitForAllThreadsToFinishMating();
+
+	/* The slices must be ordered by their position in the next generation */
+	slices.reserve(numThreadArgs + 1);
+	for(i = numThreadArgs - 1; i >= 0; --i) {
+		if(threadArgs[i].spawned) {
+			slices.push_back(&threadArgs[i].slice);
+		}
+	}
+	slices.push_back(&mainThreadSlice);
+
+	this->sumCurrentGenFitness = this->mergeCurrentGenerationSlices(this->nextGeneration, slices, true);
+}
+
+void MultiThreadedPopulation::partitionGeneration(ThreadArgsWrapper* threadArgs, uint16_t numThreadArgs, GenerationSlice &mainThreadSlice,
+	uint16_t &numChildrenMainThread, uint16_t &mainThreadOffset) {
+	const uint16_t numChildrenPerThread = this->populationSize / (this->actuallySpawnedThreads + 1);
+	int remainingChildren = this->populationSize % (this->actuallySpawnedThreads + 1);
+	uint16_t offset = 0;
+	int i;
+
+	for(i = numThreadArgs - 1; i >= 0; --i) {
+		if(!threadArgs[i].spawned) {
+			continue;
+		}
+
+		threadArgs[i].numChildren = numChildrenPerThread;
+
+		if(remainingChildren > 0) {
+			--remainingChildren;
+			++threadArgs[i].numChildren;
+		}
+
+		threadArgs[i].offset = offset;
+		threadArgs[i].slice.begin = offset;
+		threadArgs[i].slice.end = offset + threadArgs[i].numChildren;
+		offset += threadArgs[i].numChildren;
+	}
+
+	mainThreadOffset = offset;
+	numChildrenMainThread = this->populationSize - offset;
+	mainThreadSlice.begin = offset;
+	mainThreadSlice.end = this->populationSize;
+}
+
+::Evaluator* MultiThreadedPopulation::createIdleEvaluator(const std::vector<uint32_t> &seed) {
+	if(this->ctrl.idleTask != IDLE_REEVALUATE || this->ctrl.elitism == 0) {
+		return NULL;
+	}
+
+	std::unique_ptr<::Evaluator> idleEvaluator(this->evaluator.clone());
+
+	try {
+		idleEvaluator->reseedSegmentation(seed);
+	} catch(const std::logic_error &le) {
+		GAerr << "Warning: The elite can not be re-evaluated: " << le.what() << std::endl;
+		return NULL;
+	}
+
+	return idleEvaluator.release();
+}
+
+void MultiThreadedPopulation::prepareIdleTask() {
+	this->numThreadsMated = 0;
+
+	if(this->ctrl.idleTask != IDLE_NONE) {
+		/* Best chromosome first */
+		this->idleElite.assign(this->elite.rbegin(), this->elite.rend());
+
+		/* The threads may have drawn job numbers past the end of the last generation */
+		if(this->nextIdleJob.load() > this->idleJobsEnd) {
+			this->nextIdleJob = this->idleJobsEnd;
+		}
+		this->idleJobsEnd = this->nextIdleJob.load() + this->populationSize;
+	}
+}
+
+/**
+ * Evaluate re-seeded elite chromosomes or neighbours of elite chromosomes while other threads are still mating
+ */
+uint32_t MultiThreadedPopulation::runIdleTask(::Evaluator &evaluator, ::Evaluator *idleEvaluator, RNG &rng,
+	std::vector<Chromosome> &results, bool checkUserInterrupt) {
+	const uint64_t numElite = this->idleElite.size();
+	std::vector<uint32_t> seed(RNG::SEED_SIZE);
+	uint32_t numEvaluations = 0;
+	uint32_t numJobs = 0;
+	uint64_t job;
+
+	if(numElite == 0 || this->ctrl.idleTask == IDLE_NONE || (this->ctrl.idleTask == IDLE_REEVALUATE && idleEvaluator == NULL)) {
+		return 0;
+	}
+
+	/* The job that was started last is finished even if all threads are done mating in the meantime */
+	while(this->numThreadsMated.load() <= this->actuallySpawnedThreads && !this->interrupted) {
+		job = this->nextIdleJob++;
+		if(job >= this->idleJobsEnd) {
+			break;
+		}
+
+		const Chromosome &eliteCh = this->idleElite[job % numElite];
+		Chromosome ch(eliteCh);
+
+		try {
+			if(this->ctrl.idleTask == IDLE_REEVALUATE) {
+				for(std::vector<uint32_t>::iterator seedIt = seed.begin(); seedIt != seed.end(); ++seedIt) {
+					*seedIt = rng();
+				}
+
+				idleEvaluator->reseedSegmentation(seed);
+				++numEvaluations;
+				idleEvaluator->evaluate(ch);
+				results.push_back(ch);
+			} else if(ch.flipVariable((uint16_t) ((job / numElite) % this->ctrl.chromosomeSize))) {
+				/* Only neighbours that are better than their elite chromosome are kept */
+				++numEvaluations;
+				if(evaluator.evaluate(ch) > eliteCh.getFitness()) {
+					results.push_back(ch);
+				}
+			}
+		} catch(const ::Evaluator::EvaluatorException &ee) {
+			if(this->ctrl.verbosity >= VERBOSE) {
+				GAout << GAout.lock() << "Could not evaluate chromosome: " << ee.what() << "\n" << GAout.unlock();
+			}
+		}
+
+		/*
+		 * The main thread has to check for a user interrupt
+		 */
+		if(checkUserInterrupt == true && ++numJobs % IDLE_JOBS_PER_INTERRUPT_CHECK == 0) {
+			GAout.flushThreadSafeBuffer();
+			GAerr.flushThreadSafeBuffer();
+			if(check_interrupt()) {
+				this->interrupted = true;
+			}
+		}
+	}
+
+	return numEvaluations;
+}
+
+void MultiThreadedPopulation::mergeIdleResults(std::vector<Chromosome> &results) {
+	SortedChromosomes::iterator eliteIt;
+	std::vector<std::pair<Chromosome, uint32_t> >::iterator countIt;
+
+	if(results.empty()) {
+		return;
+	}
+
+	for(std::vector<Chromosome>::iterator it = results.begin(); it != results.end(); ++it) {
+		if(this->ctrl.idleTask == IDLE_LOCAL_SEARCH) {
+			this->addChromosomeToElite(*it);
+			continue;
+		}
+
+		/*
+		 * The fitness of a re-evaluated chromosome is the running mean of all its estimates.
+		 * The chromosome may have been pushed out of the elite in the meantime.
+		 */
+		for(eliteIt = this->elite.begin(); eliteIt != this->elite.end() && *eliteIt != *it; ++eliteIt) {}
+
+		if(eliteIt != this->elite.end()) {
+			for(countIt = this->numFitnessEstimates.begin(); countIt != this->numFitnessEstimates.end() && countIt->first != *it; ++countIt) {}
+
+			if(countIt == this->numFitnessEstimates.end()) {
+				this->numFitnessEstimates.push_back(std::make_pair(*it, 1));
+				countIt = this->numFitnessEstimates.end() - 1;
+			}
+
+			const Chromosome previous(*eliteIt);
+			++countIt->second;
+			it->setFitness(previous.getFitness() + (it->getFitness() - previous.getFitness()) / countIt->second);
+
+			/* The elite is ordered by fitness, so the new fitness must not equal the fitness of another elite chromosome */
+			this->elite.erase(eliteIt);
+			if(!this->elite.insert(*it).second) {
+				this->elite.insert(previous);
+				--countIt->second;
+			}
+
+			this->minEliteFitness = this->elite.begin()->getFitness();
+		}
+	}
+
+	/* Forget the chromosomes that dropped out of the elite */
+	for(countIt = this->numFitnessEstimates.begin(); countIt != this->numFitnessEstimates.end();) {
+		if(std::find(this->elite.begin(), this->elite.end(), countIt->first) == this->elite.end()) {
+			countIt = this->numFitnessEstimates.erase(countIt);
+		} else {
+			++countIt;
+		}
+	}
+
+	results.clear();
+}
+
 /**
  * Wait for all threads to finish the current generation
  */
 inline void MultiThreadedPopulation::waitForAllThreadsToFinishMating() {
 	CHECK_PTHREAD_RETURN_CODE(pthread_mutex_lock(&this->syncMutex))
-	
+
+	/*
+	 * The barrier is counted by rounds instead of a flag: a fast thread may already arrive at the
+	 * next barrier before all threads woken up by this one got the mutex back.
+	 */
+	const uint32_t round = this->matingRound;
+
 	if(++this->numThreadsFinishedMating > this->actuallySpawnedThreads) { // > because the main thread must finish mating as well
-		this->allThreadsFinishedMating = true;
+		++this->matingRound;
 		this->numThreadsFinishedMating = 0;
 		this->startMating = false;
 		
 		CHECK_PTHREAD_RETURN_CODE(pthread_cond_broadcast(&this->allThreadsFinishedMatingCond))
-	} else {
-		this->allThreadsFinishedMating = false;
 	}
 	
-	//	pthreadRC = pthread_mutex_unlock(&this->syncMutex);
-	//	CHECK_PTHREAD_RETURN_CODE(pthreadRC)
-	//	int pthreadRC = pthread_mutex_lock(&this->syncMutex);
-	//	CHECK_PTHREAD_RETURN_CODE(pthreadRC)
-	
-	while(this->allThreadsFinishedMating == false) {
+	while(this->matingRound == round) {
 		CHECK_PTHREAD_RETURN_CODE(pthread_cond_wait(&this->allThreadsFinishedMatingCond, &this->syncMutex))
 	}
 	
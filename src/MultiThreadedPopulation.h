@@ -19,6 +19,8 @@
 #include <set>
 #include <string>
 #include <utility>
+#include <memory>
+#include <atomic>
 
 #include "Chromosome.h"
 #include "Evaluator.h"
@@ -46,6 +48,8 @@ public:
 	
 	void run();
 private:
+	static const uint16_t IDLE_JOBS_PER_INTERRUPT_CHECK = 4;
+
 	struct ThreadArgsWrapper {
 		MultiThreadedPopulation* popObj;
 		Evaluator* evalObj;
@@ -53,6 +57,26 @@ private:
 		uint16_t numChildren;
 		uint16_t offset;
 		uint16_t chromosomeSize;
+
+		/* Statistics reported by the thread (only read after the threads are synchronized) */
+		uint64_t numEvaluations;
+		double busySeconds;
+
+		/* The thread's part of the new generation when the current generation is updated */
+		GenerationSlice slice;
+		bool spawned;
+
+		/* The evaluator used to re-evaluate the elite (NULL if not needed) */
+		Evaluator* idleEvalObj;
+
+		/* The results of the idle task in the current generation */
+		std::vector<Chromosome> idleResults;
+	};
+
+	/* What the threads do once they are started */
+	enum WorkerTask {
+		TASK_MATE,
+		TASK_UPDATE_GENERATION
 	};
 
 	ChVec nextGeneration;
@@ -67,25 +91,99 @@ private:
 	
 	bool startMating;
 	bool killThreads;
-	bool allThreadsFinishedMating;
+	WorkerTask task;
+	/* Incremented every time all threads have finished mating (a thread waits until the round changes) */
+	uint32_t matingRound;
 
 	uint16_t actuallySpawnedThreads;
 	uint16_t numThreadsFinishedMating;
 
-	inline void generateInitialChromosomes(uint16_t numChromosomes, ::Evaluator& evaluator,
+	/*
+	 * The idle task (see `runIdleTask`) works on a copy of the elite taken before the threads
+	 * start mating. The jobs are numbered consecutively across generations, but there are at most
+	 * as many jobs per generation as chromosomes in the population (jobs before `idleJobsEnd`).
+	 */
+	std::vector<Chromosome> idleElite;
+	std::atomic<uint64_t> nextIdleJob;
+	uint64_t idleJobsEnd;
+	std::atomic<uint16_t> numThreadsMated;
+
+	/*
+	 * The number of fitness estimates the fitness of a re-evaluated elite chromosome is the mean of
+	 * (chromosomes that are not in the list have a single estimate)
+	 */
+	std::vector<std::pair<Chromosome, uint32_t> > numFitnessEstimates;
+
+	inline uint32_t generateInitialChromosomes(uint16_t numChromosomes, ::Evaluator& evaluator,
 		RNG& rng, ShuffledSet& shuffledSet, uint16_t offset,
 		bool checkUserInterrupt = true);
 
-	inline void mate(uint16_t numChildren, ::Evaluator& evaluator,
+	inline uint32_t mate(uint16_t numChildren, ::Evaluator& evaluator,
 		RNG& rng, ShuffledSet& shuffledSet, uint16_t offset,
 		bool checkUserInterrupt = true);
 	
 	static void* matingThreadStart(void* obj);
 
-	inline void runMating(uint16_t numMatingCoupls, ::Evaluator& evaluator,
-		RNG& rng, ShuffledSet& shuffledSet, uint16_t offset);
+	inline void runMating(ThreadArgsWrapper &args, RNG& rng, ShuffledSet& shuffledSet);
 
 	inline void waitForAllThreadsToFinishMating();
+
+	/**
+	 * Create the evaluator for re-evaluating the elite (NULL if the idle task does not re-evaluate
+	 * the elite or the evaluator does not use a segmentation)
+	 */
+	::Evaluator* createIdleEvaluator(const std::vector<uint32_t> &seed);
+
+	/**
+	 * Take the copy of the elite the idle task works on (must only be called while all threads are waiting)
+	 */
+	void prepareIdleTask();
+
+	/**
+	 * Work on the idle task until all threads have finished mating or the jobs of the generation are
+	 * used up. The jobs are shared by all threads:
+	 * IDLE_REEVALUATE re-evaluates an elite chromosome with a new segmentation of the observations,
+	 * IDLE_LOCAL_SEARCH evaluates the chromosome that differs from an elite chromosome in a single variable.
+	 * The results do not affect the current generation, they are collected in `results`.
+	 *
+	 * @param checkUserInterrupt If true, a user interrupt is checked for every IDLE_JOBS_PER_INTERRUPT_CHECK jobs
+	 *			(only the main thread may do this)
+	 * @return The number of evaluations performed
+	 */
+	uint32_t runIdleTask(::Evaluator &evaluator, ::Evaluator *idleEvaluator, RNG &rng, std::vector<Chromosome> &results,
+		bool checkUserInterrupt = false);
+
+	/**
+	 * Merge the results of the idle task into the elite and clear them
+	 * (must only be called after all threads are synchronized)
+	 */
+	void mergeIdleResults(std::vector<Chromosome> &results);
+
+	/**
+	 * Start all threads waiting for the next task (must only be called after all threads are synchronized)
+	 */
+	inline void startThreads(WorkerTask task);
+
+	/**
+	 * Update the current generation (and the elite) from the next generation.
+	 * Every thread processes its part of the next generation, only the merging is done by the main thread.
+	 */
+	inline void updateCurrentGenerationConcurrently(const ThreadArgsWrapper* threadArgs, uint16_t numThreadArgs,
+		GenerationSlice &mainThreadSlice);
+
+	/**
+	 * Distribute the children of the next generation (after the population size changed) evenly among
+	 * the spawned threads and the main thread (must only be called while all threads are waiting)
+	 */
+	void partitionGeneration(ThreadArgsWrapper* threadArgs, uint16_t numThreadArgs, GenerationSlice &mainThreadSlice,
+		uint16_t &numChildrenMainThread, uint16_t &mainThreadOffset);
+
+	/**
+	 * Sum up the statistics reported by the threads (and the main thread) and
+	 * publish them (must only be called after all threads are synchronized)
+	 */
+	inline void publishThreadStatistics(uint16_t generation, const ThreadArgsWrapper* threadArgs, uint16_t numThreadArgs,
+		uint64_t mainThreadEvaluations, double mainThreadBusySeconds, double wallSeconds);
 	
 	class OrderChromosomePtr : public std::binary_function<Chromosome*, Chromosome*, bool> {
 	public:
@@ -39,6 +39,22 @@ public:
 		this->M2[dim] += delta * (sample - this->meanVec[dim]);
 	};
 
+	/**
+	 * Add the statistics of another (disjoint) sample, as if all of its values were passed to `update`
+	 */
+	inline void merge(const OnlineStddev &other, uint16_t dim = 0) {
+		if(other.counter[dim] == 0) {
+			return;
+		}
+
+		double n1 = this->counter[dim], n2 = other.counter[dim];
+		double delta = other.meanVec[dim] - this->meanVec[dim];
+
+		this->counter[dim] += other.counter[dim];
+		this->meanVec[dim] += delta * n2 / (n1 + n2);
+		this->M2[dim] += other.M2[dim] + delta * delta * n1 * n2 / (n1 + n2);
+	};
+
 	inline double stddev(uint16_t dim = 0) const {
 		return std::sqrt(this->M2[dim] / (this->counter[dim] - 1));
 	};
@@ -7,11 +7,18 @@
 //
 
 #include "config.h"
+
+#include <stdexcept>
+
 #include "Logger.h"
 #include "PLS.h"
 
 void PLS::viewSelectColumns(const arma::uvec &columns) {
-	this->viewXCol = this->X.cols(columns);
+	if(this->rows.n_elem > 0) {
+		this->viewXCol = this->X->submat(this->rows, columns);
+	} else {
+		this->viewXCol = this->X->cols(columns);
+	}
 
 	this->currentViewState = COLUMNS;
 }
@@ -28,6 +35,30 @@ void PLS::viewSelectAllRows() {
 	this->currentViewState = ROWS;
 }
 
+void PLS::initStepper(PLSStepper &stepper, uint16_t maxNComp) const {
+	if(this->currentViewState == PLS::CENTERED_ROWS) {
+		throw std::logic_error("The rows must be selected again before another stepper can be started");
+	}
+
+	stepper.init(this->getCurrentViewX(), this->getCurrentViewY(), maxNComp);
+}
+
+const arma::mat& PLS::getCurrentViewX() const {
+	switch(this->currentViewState) {
+		case PLS::COLUMNS:
+			return this->viewXCol;
+		case PLS::ROWS:
+		case PLS::CENTERED_ROWS:
+			return this->viewX;
+		default:
+			return *this->X;
+	}
+}
+
+const arma::vec& PLS::getCurrentViewY() const {
+	return (this->currentViewState == PLS::ROWS || this->currentViewState == PLS::CENTERED_ROWS) ? this->viewY : this->Y;
+}
+
 /**
  * uint16_t ncomp ... The 0-based
  */
@@ -14,16 +14,79 @@ enum PLSMethod {
 	SIMPLS = 0
 };
 
+/**
+ * Fit a PLS model incrementally, one component at a time.
+ * This allows to look at the predictions of the model after each component
+ * without refitting the model from scratch.
+ */
+class PLSStepper {
+public:
+	PLSStepper() : ncomp(0) {};
+	virtual ~PLSStepper() {};
+
+	/**
+	 * Start a new fit for the given (uncentered) data with up to `maxNComp` components
+	 */
+	virtual void init(const arma::mat &X, const arma::vec &Y, uint16_t maxNComp) = 0;
+
+	/**
+	 * Add the next component to the model
+	 * @throws std::underflow_error if the component can not be computed
+	 */
+	virtual void step() = 0;
+
+	/**
+	 * The number of components added so far
+	 */
+	uint16_t getNComp() const { return this->ncomp; }
+
+	/**
+	 * Coefficients and intercepts for 1, ..., getNComp() components
+	 * (columns after getNComp() are undefined)
+	 */
+	const arma::mat& getCoefficients() const { return this->coef; }
+	const arma::vec& getIntercepts() const { return this->intercepts; }
+
+	/**
+	 * Predict the values with all components added so far
+	 */
+	arma::vec predict(const arma::mat &newX) const {
+		arma::vec pred = newX * this->coef.col(this->ncomp - 1);
+		pred += this->intercepts[this->ncomp - 1];
+		return pred;
+	}
+
+protected:
+	arma::mat coef;
+	arma::vec intercepts;
+	uint16_t ncomp;
+};
+
 class PLS {
 protected:
 	enum ViewState {
 		UNKNOWN = 0,
 		COLUMNS,
-		ROWS
+		ROWS,
+		CENTERED_ROWS // The row view was centered in place by the last fit
 	};
 
 public:
-	PLS(const arma::mat &X, const arma::vec &Y) : X(X), Y(Y), currentViewState(UNKNOWN) {};
+	PLS(const arma::mat &X, const arma::vec &Y) : X(new arma::mat(X)), Y(Y), currentViewState(UNKNOWN) {};
+
+	/**
+	 * Use the given (shared) X matrix -- the matrix is never modified, so it can be
+	 * shared by all PLS objects for the same data
+	 */
+	PLS(const std::shared_ptr<const arma::mat> &X, const arma::vec &Y) : X(X), Y(Y), currentViewState(UNKNOWN) {};
+
+	/**
+	 * Only use the given rows of the (shared) X matrix. Rows may be given multiple times.
+	 * The rows are only extracted for the selected columns, so X is never copied as a whole.
+	 * The response must already be given for the selected rows.
+	 */
+	PLS(const std::shared_ptr<const arma::mat> &X, const arma::vec &Y, const arma::uvec &rows) :
+		X(X), Y(Y), rows(rows), currentViewState(UNKNOWN) {};
 	virtual ~PLS() {};
 
 	static std::unique_ptr<PLS> getInstance(PLSMethod method, const arma::mat &X, const arma::vec &Y);
@@ -70,9 +133,9 @@ public:
 	/**
 	 * Get dimensions of original matrices Y and X
 	 */
-	arma::uword getNumberOfPredictorVariables() const { return this->X.n_cols; }
+	arma::uword getNumberOfPredictorVariables() const { return this->X->n_cols; }
 	arma::uword getNumberOfResponseVariables() const { return this->Y.n_cols; }
-	arma::uword getNumberOfObservations() const { return this->X.n_rows; }
+	arma::uword getNumberOfObservations() const { return this->Y.n_rows; }
 
 	/**
 	 * Returns the number components the last fit was performed with
@@ -91,16 +154,47 @@ public:
 
 	virtual std::unique_ptr<PLS> clone() const = 0;
 
+	/**
+	 * Create a new PLS object for the same X matrix (which is shared, not copied)
+	 * but a different response
+	 */
+	virtual std::unique_ptr<PLS> cloneWithResponse(const arma::vec &Y) const = 0;
+
+	/**
+	 * Create a new PLS object for the given rows of the same X matrix (which is shared, not copied)
+	 * Rows may be given multiple times. Columns must be selected before the object can be used.
+	 */
+	virtual std::unique_ptr<PLS> cloneWithRows(const arma::uvec &rows) const = 0;
+
+	/**
+	 * Create a new stepper for the PLS method
+	 */
+	virtual std::unique_ptr<PLSStepper> createStepper() const = 0;
+
+	/**
+	 * Start a new incremental fit with the data from the current view
+	 */
+	void initStepper(PLSStepper &stepper, uint16_t maxNComp) const;
+
 protected:
-	const arma::mat X;
+	const std::shared_ptr<const arma::mat> X;
 	const arma::vec Y;
 
+	/* The rows of X used by this object (empty if all rows are used) */
+	const arma::uvec rows;
+
 	uint16_t resultNComp;
 
 	ViewState currentViewState;
 	arma::mat viewXCol;
 	arma::vec viewY;
 	arma::mat viewX;
+
+	/**
+	 * The (uncentered) data of the current view
+	 */
+	const arma::mat& getCurrentViewX() const;
+	const arma::vec& getCurrentViewY() const;
 };
 
 #include "PLSSimpls.h"
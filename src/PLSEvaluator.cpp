@@ -13,6 +13,7 @@
 #include "Logger.h"
 #include "PLSEvaluator.h"
 #include "OnlineStddev.h"
+#include "SimdKernels.h"
 
 #ifdef ENABLE_DEBUG_VERBOSITY
 #define IF_DEBUG(expr) if(this->verbosity == DEBUG_EVAL || this->verbosity == DEBUG_ALL) { expr; }
@@ -26,12 +27,13 @@ uint32_t PLSEvaluator::counter = 0;
 
 PLSEvaluator::PLSEvaluator(std::unique_ptr<PLS> _pls, uint16_t _numReplications, uint16_t _maxNComp,
                            const std::vector<uint32_t> &_seed, VerbosityLevel _verbosity, uint16_t _innerSegments,
-                           uint16_t _outerSegments, double testSetSize, double _sdfact)
+                           uint16_t _outerSegments, double testSetSize, double _sdfact, uint16_t earlyStop)
     : Evaluator(_verbosity), numReplications(_numReplications),
       outerSegments((_outerSegments < 1) ? 1 : _outerSegments),
 		  innerSegments((outerSegments <= 1 && testSetSize == 0.0) ? _innerSegments - 1 : _innerSegments),
 		  sdfact(_sdfact / sqrt((double) innerSegments)),
-		  nrows(_pls->getNumberOfObservations()), pls(std::move(_pls)), maxNComp(_maxNComp)
+		  nrows(_pls->getNumberOfObservations()), pls(std::move(_pls)), maxNComp(_maxNComp),
+		  componentwiseCV(earlyStop)
 {
 	/* assert outerSegments > 0 */
 	if(pls->getNumberOfResponseVariables() > 1) {
@@ -48,18 +50,42 @@ PLSEvaluator::PLSEvaluator(std::unique_ptr<PLS> _pls, uint16_t _numReplications,
 
 	IF_DEBUG(GAout << "Test set size: " << testSetSize << " -- outerSegments: " << outerSegments << std::endl);
 
-	this->initSegmentation(testSetSize, _seed);
+	this->testSetSize = testSetSize;
+	this->initSegmentation(testSetSize, this->nrows, _seed);
 }
 
 PLSEvaluator::PLSEvaluator(const PLSEvaluator &other) :
 	Evaluator(other.verbosity), numReplications(other.numReplications),
 	outerSegments(other.outerSegments), innerSegments(other.innerSegments),
-	sdfact(other.sdfact), nrows(other.nrows), maxNComp(other.maxNComp),
-	segmentation(other.segmentation)
+	sdfact(other.sdfact), nrows(other.nrows), maxNComp(other.maxNComp), testSetSize(other.testSetSize),
+	segmentation(other.segmentation), rowWeights(other.rowWeights),
+	componentwiseCV(other.componentwiseCV)
 {
 	this->pls = other.pls->clone();
 }
 
+PLSEvaluator::PLSEvaluator(const PLSEvaluator &other, const arma::vec &y) :
+	Evaluator(other.verbosity), numReplications(other.numReplications),
+	outerSegments(other.outerSegments), innerSegments(other.innerSegments),
+	sdfact(other.sdfact), nrows(other.nrows), maxNComp(other.maxNComp), testSetSize(other.testSetSize),
+	segmentation(other.segmentation), rowWeights(other.rowWeights),
+	componentwiseCV(other.componentwiseCV)
+{
+	this->pls = other.pls->cloneWithResponse(y);
+}
+
+PLSEvaluator::PLSEvaluator(const PLSEvaluator &other, const RowWeights &rowWeights, const std::vector<uint32_t> &seed) :
+	Evaluator(other.verbosity), numReplications(other.numReplications),
+	outerSegments(other.outerSegments), innerSegments(other.innerSegments),
+	sdfact(other.sdfact), nrows(rowWeights.getRows().n_elem), maxNComp(other.maxNComp), testSetSize(other.testSetSize),
+	componentwiseCV(other.componentwiseCV)
+{
+	this->pls = other.pls->cloneWithRows(rowWeights.getRows());
+	this->rowWeights.reset(new RowWeights(rowWeights));
+
+	this->reseedSegmentation(seed);
+}
+
 double PLSEvaluator::evaluate(arma::uvec &columnSubset) {
 	if(columnSubset.n_elem == 0) {
 		GAerr << GAerr.lock() << "Can not evaluate empty variable subset" << GAerr.unlock();
@@ -68,7 +94,9 @@ double PLSEvaluator::evaluate(arma::uvec &columnSubset) {
 #ifdef ENABLE_DEBUG_VERBOSITY
 	++PLSEvaluator::counter;
 #endif
+	this->beginPhases();
 	this->pls->viewSelectColumns(columnSubset);
+	this->endPhase(HardwareCounters::PHASE_GATHER);
 
 	double sumSEP = this->estSEP(((this->maxNComp < columnSubset.n_elem) ? this->maxNComp : columnSubset.n_elem)) / this->numReplications;
 
@@ -79,9 +107,9 @@ double PLSEvaluator::evaluate(arma::uvec &columnSubset) {
 /**
  * Initialize the row-segmentation for each replication and all segmentations
  */
-inline void PLSEvaluator::initSegmentation(double testSetSize, const std::vector<uint32_t> &seed) {
+inline void PLSEvaluator::initSegmentation(double testSetSize, arma::uword numRows, const std::vector<uint32_t> &seed) {
 	RNG rng(seed);
-	ShuffledSet rowNumbers(this->nrows);
+	ShuffledSet rowNumbers(numRows);
 	arma::uword i, n = 0;
 
 	if(testSetSize == 0.0 && this->outerSegments == 1) {
@@ -92,8 +120,8 @@ inline void PLSEvaluator::initSegmentation(double testSetSize, const std::vector
 	 * The size of the outer segment and the number of outer segments with one extra
 	 * observation
 	 */
-	arma::uword outerSegmentLength = this->nrows * testSetSize;
-	arma::uword outerSegmentLengthRem = this->nrows % outerSegmentLength;
+	arma::uword outerSegmentLength = numRows * testSetSize;
+	arma::uword outerSegmentLengthRem = numRows % outerSegmentLength;
 
 	this->segmentation.reserve(2 * this->numReplications * (this->innerSegments + 1) * this->outerSegments);
 
@@ -104,8 +132,8 @@ inline void PLSEvaluator::initSegmentation(double testSetSize, const std::vector
 	 * won't get this extra observation. If no inner segment has an extra observation,
 	 * one inner segment will have one observation less.
 	 */
-	arma::uword innerSegmentLength = (this->nrows - outerSegmentLength) / this->innerSegments;
-	arma::uword innerSegmentLengthRem = (this->nrows - outerSegmentLength) % this->innerSegments;
+	arma::uword innerSegmentLength = (numRows - outerSegmentLength) / this->innerSegments;
+	arma::uword innerSegmentLengthRem = (numRows - outerSegmentLength) % this->innerSegments;
 	arma::uword innerSegmentLengthBigOuter = innerSegmentLength;
 
 	if(outerSegmentLengthRem > 0 && innerSegmentLengthRem == 0) {
@@ -118,7 +146,7 @@ inline void PLSEvaluator::initSegmentation(double testSetSize, const std::vector
 	 * The minimum number of observations in a fit set is (the 2 is just for safety):
 	 *	nrows - outerSegmentLength - innerSegmentLength - 2
 	 */
-	arma::uword minFitSetSize = this->nrows - outerSegmentLength - innerSegmentLength - 2;
+	arma::uword minFitSetSize = numRows - outerSegmentLength - innerSegmentLength - 2;
 	if(minFitSetSize <= this->maxNComp || this->maxNComp == 0) {
 		this->maxNComp = minFitSetSize;
 	}
@@ -166,14 +194,14 @@ inline void PLSEvaluator::initSegmentation(double testSetSize, const std::vector
 				/*
 				 *
 				 */
-				arma::uvec inSegment(this->nrows - olen - ilen);
+				arma::uvec inSegment(numRows - olen - ilen);
 
 				if(n > 0) {
 					inSegment.rows(0, n - 1) = shuffledRowNumbers.rows(0, n - 1);
 				}
 
-				if(n < this->nrows - olen - ilen) {
-					inSegment.rows(n, inSegment.n_elem - 1) = shuffledRowNumbers.rows(n + ilen, this->nrows - olen - 1);
+				if(n < numRows - olen - ilen) {
+					inSegment.rows(n, inSegment.n_elem - 1) = shuffledRowNumbers.rows(n + ilen, numRows - olen - 1);
 				}
 
 				std::sort(inSegment.begin(), inSegment.end());
@@ -196,14 +224,14 @@ inline void PLSEvaluator::initSegmentation(double testSetSize, const std::vector
 				this->segmentation.push_back(arma::sort(shuffledRowNumbers.rows(0, n - 1)));
 				IF_DEBUG(this->segmentation.back().t().raw_print(GAout, "Outer training set:"));
 				/* Then add test set */
-				this->segmentation.push_back(arma::sort(shuffledRowNumbers.rows(n, this->nrows - 1)));
+				this->segmentation.push_back(arma::sort(shuffledRowNumbers.rows(n, numRows - 1)));
 				IF_DEBUG(this->segmentation.back().t().raw_print(GAout, "Outer test set:"));
 			}
 
 			/*
 			 * Rotate shuffled row numbers (put the last segment in front)
 			 */
-			shuffledRowNumbers = arma::join_cols(shuffledRowNumbers.rows(n, this->nrows - 1), shuffledRowNumbers.rows(0, n - 1));
+			shuffledRowNumbers = arma::join_cols(shuffledRowNumbers.rows(n, numRows - 1), shuffledRowNumbers.rows(0, n - 1));
 		}
 	}
 }
@@ -217,9 +245,11 @@ double PLSEvaluator::estSEP(uint16_t maxNComp) {
 
 	double cutoff;
 	arma::uword minNComp, optNComp;
+	uint16_t cvNComp = maxNComp;
 
 	arma::mat leftOutX;
 	arma::vec leftOutY;
+	arma::vec fitted;
 	OnlineStddev predSD;
 
 	uint16_t rep = 0, outer, seg, comp;
@@ -235,26 +265,38 @@ double PLSEvaluator::estSEP(uint16_t maxNComp) {
 				seg = 0;
 				trainMSEP.reset();
 
-				/*
-				 * Fit PLS models to predict the values in each segment once
-				 */
-				while(seg++ < this->innerSegments) {
-					/* Segmentation iterator currently points to the `fit` segment */
-					this->pls->viewSelectRows(*(segmentIter));
-					this->pls->fit(maxNComp);
-
-					/* Increment segmentation iterator to point to the `predict` segment */
-					++segmentIter;
-
-					leftOutY = this->pls->getY().rows(*segmentIter);
-					leftOutX = this->pls->getXColumnView().rows(*segmentIter);
-
-					for(comp = 0; comp < maxNComp; ++comp) {
-						trainMSEP.update(arma::mean(arma::square(leftOutY - this->pls->predict(leftOutX, comp + 1))), comp);
+				if(this->componentwiseCV.isEnabled()) {
+					/*
+					 * Add components to the models for all segments until the CV error increases
+					 */
+					cvNComp = this->componentwiseCV.run(*this->pls, segmentIter, this->innerSegments, maxNComp, trainMSEP);
+					/* The predictions are interleaved with the fits */
+					this->endPhase(HardwareCounters::PHASE_FIT);
+				} else {
+					/*
+					 * Fit PLS models to predict the values in each segment once
+					 */
+					while(seg++ < this->innerSegments) {
+						/* Segmentation iterator currently points to the `fit` segment */
+						this->pls->viewSelectRows(*(segmentIter));
+						this->pls->fit(maxNComp);
+						this->endPhase(HardwareCounters::PHASE_FIT);
+
+						/* Increment segmentation iterator to point to the `predict` segment */
+						++segmentIter;
+
+						leftOutY = this->pls->getY().rows(*segmentIter);
+						leftOutX = this->pls->getXColumnView().rows(*segmentIter);
+
+						for(comp = 0; comp < maxNComp; ++comp) {
+							fitted = this->pls->predict(leftOutX, comp + 1);
+							trainMSEP.update(SimdKernels::sumSquaredDiff(leftOutY.memptr(), fitted.memptr(), fitted.n_elem) / fitted.n_elem, comp);
+						}
+						this->endPhase(HardwareCounters::PHASE_PREDICT);
+
+						/* Increment segmentation iterator to point to the next `fit` segment */
+						++segmentIter;
 					}
-
-					/* Increment segmentation iterator to point to the next `fit` segment */
-					++segmentIter;
 				}
 
 				/*
@@ -262,7 +304,7 @@ double PLSEvaluator::estSEP(uint16_t maxNComp) {
 				 */
 				IF_DEBUG(
 					GAout << "EVALUATOR: MSE and SD" << std::endl;
-					for(uint16_t j = 0; j < maxNComp; ++j) {
+					for(uint16_t j = 0; j < cvNComp; ++j) {
 						GAout << "\t (" << j + 1 << " comps.): " << trainMSEP.mean(j) << " +- " << trainMSEP.stddev(j) << std::endl;
 					}
 				)
@@ -270,7 +312,7 @@ double PLSEvaluator::estSEP(uint16_t maxNComp) {
 				cutoff = trainMSEP.mean(0);
 				minNComp = 0;
 
-				for(comp = 1; comp < maxNComp; ++comp) {
+				for(comp = 1; comp < cvNComp; ++comp) {
 					if(trainMSEP.mean(comp) < cutoff) {
 						minNComp = comp;
 						cutoff = trainMSEP.mean(comp);
@@ -301,7 +343,7 @@ double PLSEvaluator::estSEP(uint16_t maxNComp) {
 				 */
 				this->pls->viewSelectRows(*segmentIter);
 				this->pls->fit(optNComp);
-
+				this->endPhase(HardwareCounters::PHASE_FIT);
 
 				/* Increment the segmentation iterator to point to the `test predict` segment */
 				++segmentIter;
@@ -309,6 +351,7 @@ double PLSEvaluator::estSEP(uint16_t maxNComp) {
 				leftOutX = this->pls->getXColumnView().rows(*segmentIter);
 				leftOutY = this->pls->getY().rows(*segmentIter);
 				predSD.update(leftOutY - this->pls->predict(leftOutX, optNComp));
+				this->endPhase(HardwareCounters::PHASE_PREDICT);
 
 				/* Increment the segmentation iterator to point to the next `fit` segment */
 				++segmentIter;
@@ -328,9 +371,34 @@ double PLSEvaluator::estSEP(uint16_t maxNComp) {
 	return sumSEP;
 }
 
+void PLSEvaluator::reseedSegmentation(const std::vector<uint32_t> &seed) {
+	this->segmentation.clear();
+
+	if(this->rowWeights) {
+		this->initSegmentation(this->testSetSize, this->rowWeights->getNumDistinct(), seed);
+		this->rowWeights->expandSegmentation(this->segmentation);
+	} else {
+		this->initSegmentation(this->testSetSize, this->nrows, seed);
+	}
+}
+
 Evaluator* PLSEvaluator::clone() const {
 	return new PLSEvaluator(*this);
 }
 
+Evaluator* PLSEvaluator::cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const {
+	if(rowWeights.n_elem != this->nrows) {
+		throw std::invalid_argument("There must be one weight for every observation");
+	}
+	return new PLSEvaluator(*this, RowWeights(rowWeights), seed);
+}
+
+Evaluator* PLSEvaluator::cloneWithResponse(const arma::vec &y) const {
+	if(y.n_elem != this->nrows) {
+		throw std::invalid_argument("The response must have the same number of observations as the original response");
+	}
+	return new PLSEvaluator(*this, y);
+}
+
 
 
@@ -21,12 +21,14 @@
 #include "Evaluator.h"
 #include "Chromosome.h"
 #include "PLS.h"
+#include "ComponentwiseCV.h"
+#include "RowWeights.h"
 
 class PLSEvaluator : public Evaluator {
 public:
 	PLSEvaluator(std::unique_ptr<PLS> pls, uint16_t numReplications, uint16_t maxNComp, const std::vector<uint32_t> &seed,
                VerbosityLevel verbosity, uint16_t innerSegments, uint16_t outerSegments = 1, double testSetSize = 0.0,
-               double sdfact = 1.0);
+               double sdfact = 1.0, uint16_t earlyStop = 0);
 
 	~PLSEvaluator() {}
 
@@ -44,6 +46,10 @@ public:
 	}
 
 	Evaluator* clone() const;
+	Evaluator* cloneWithResponse(const arma::vec &y) const;
+	Evaluator* cloneWithRowWeights(const arma::uvec &rowWeights, const std::vector<uint32_t> &seed) const;
+
+	void reseedSegmentation(const std::vector<uint32_t> &seed);
 
 #ifdef ENABLE_DEBUG_VERBOSITY
 	static uint32_t counter;
@@ -58,16 +64,25 @@ private:
 
 	std::unique_ptr<PLS> pls;
 	uint16_t maxNComp;
+	double testSetSize;
 	std::vector<arma::uvec> segmentation;
+	/* The weights of the observations (NULL if every observation is used once) */
+	std::shared_ptr<const RowWeights> rowWeights;
+	ComponentwiseCV componentwiseCV;
 
 	PLSEvaluator(const PLSEvaluator &other);
+	PLSEvaluator(const PLSEvaluator &other, const arma::vec &y);
+	PLSEvaluator(const PLSEvaluator &other, const RowWeights &rowWeights, const std::vector<uint32_t> &seed);
 
 	/**
 	 * Estimate the SEP
 	 */
 	double estSEP(uint16_t maxNComp);
 
-	void initSegmentation(double testSetSize, const std::vector<uint32_t> &seed);
+	/**
+	 * Initialize the segmentation for the rows 0, ..., numRows - 1
+	 */
+	void initSegmentation(double testSetSize, arma::uword numRows, const std::vector<uint32_t> &seed);
 
 };
 
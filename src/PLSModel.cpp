@@ -0,0 +1,148 @@
+//
+//  PLSModel.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <algorithm>
+#include <vector>
+#include <RcppArmadillo.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "Logger.h"
+#include "PLSModel.h"
+
+const arma::uword PLSModel::BLOCK_SIZE;
+const arma::uword PLSModel::MIN_BLOCKS_PER_THREAD;
+
+PLSModel::PLSModel(const arma::uvec &columns, const arma::vec &coefficients, double intercept, uint16_t ncomp) :
+	columns(columns), coefficients(coefficients), intercept(intercept), ncomp(ncomp) {
+	if(this->columns.n_elem != this->coefficients.n_elem) {
+		throw std::invalid_argument("The number of coefficients must match the number of selected columns");
+	}
+}
+
+PLSModel PLSModel::fit(PLSMethod method, const arma::mat &X, const arma::vec &Y, const arma::uvec &columns, uint16_t ncomp) {
+	std::unique_ptr<PLS> pls = PLS::getInstance(method, X, Y);
+
+	pls->viewSelectColumns(columns);
+	pls->viewSelectAllRows();
+	pls->fit(ncomp);
+
+	ncomp = pls->getResultNComp();
+
+	return PLSModel(columns, pls->getCoefficients().col(ncomp - 1), pls->getIntercepts()[ncomp - 1], ncomp);
+}
+
+void PLSModel::predict(const double* newX, arma::uword n, arma::uword p, double* pred, uint16_t numThreads) const {
+	if(this->columns.n_elem > 0 && this->columns.max() >= p) {
+		throw std::invalid_argument("The new data has less columns than required by the model");
+	}
+
+	arma::uword numBlocks = (n + PLSModel::BLOCK_SIZE - 1) / PLSModel::BLOCK_SIZE;
+	arma::uword maxThreads = numBlocks / PLSModel::MIN_BLOCKS_PER_THREAD;
+
+	if(maxThreads < numThreads) {
+		numThreads = (maxThreads > 0) ? maxThreads : 1;
+	}
+
+#ifdef HAVE_PTHREAD_H
+	if(numThreads > 1) {
+		std::vector<pthread_t> threads(numThreads - 1);
+		std::vector<PLSModel::PredictionJob> jobs(numThreads);
+		std::vector<bool> started(numThreads - 1, false);
+		arma::uword blocksPerThread = numBlocks / numThreads;
+		arma::uword remainingBlocks = numBlocks % numThreads;
+		arma::uword firstRow = 0;
+
+		/* Every thread gets a contiguous range of blocks */
+		for(uint16_t i = 0; i < numThreads; ++i) {
+			arma::uword numRows = (blocksPerThread + ((i < remainingBlocks) ? 1 : 0)) * PLSModel::BLOCK_SIZE;
+
+			jobs[i].model = this;
+			jobs[i].newX = newX;
+			jobs[i].n = n;
+			jobs[i].pred = pred;
+			jobs[i].firstRow = firstRow;
+			jobs[i].lastRow = std::min(firstRow + numRows, n);
+			firstRow = jobs[i].lastRow;
+		}
+
+		for(uint16_t i = 0; i < numThreads - 1; ++i) {
+			started[i] = (pthread_create(&threads[i], NULL, &PLSModel::predictionThreadStart, &jobs[i + 1]) == 0);
+
+			/* If the thread could not be started, the main thread has to do the work */
+			if(!started[i]) {
+				this->predictRows(newX, n, pred, jobs[i + 1].firstRow, jobs[i + 1].lastRow);
+			}
+		}
+
+		this->predictRows(newX, n, pred, jobs[0].firstRow, jobs[0].lastRow);
+
+		for(uint16_t i = 0; i < numThreads - 1; ++i) {
+			if(started[i]) {
+				pthread_join(threads[i], NULL);
+			}
+		}
+
+		return;
+	}
+#endif
+
+	this->predictRows(newX, n, pred, 0, n);
+}
+
+void* PLSModel::predictionThreadStart(void* obj) {
+	PLSModel::PredictionJob* job = static_cast<PLSModel::PredictionJob*>(obj);
+	job->model->predictRows(job->newX, job->n, job->pred, job->firstRow, job->lastRow);
+	return NULL;
+}
+
+inline void PLSModel::predictRows(const double* newX, arma::uword n, double* pred, arma::uword firstRow, arma::uword lastRow) const {
+	for(arma::uword row = firstRow; row < lastRow; row += PLSModel::BLOCK_SIZE) {
+		this->predictBlock(newX, n, pred, row, std::min(PLSModel::BLOCK_SIZE, lastRow - row));
+	}
+}
+
+/**
+ * Compute the predictions for rows [firstRow, firstRow + blockSize).
+ *
+ * Four columns are accumulated at once, so the block of predictions is only
+ * loaded and stored once per four columns. The inner loops are plain
+ * contiguous multiply-adds the compiler can vectorize.
+ */
+inline void PLSModel::predictBlock(const double* newX, arma::uword n, double* pred, arma::uword firstRow, arma::uword blockSize) const {
+	double* out = pred + firstRow;
+	const arma::uword* cols = this->columns.memptr();
+	const double* coefs = this->coefficients.memptr();
+	const arma::uword numCols = this->columns.n_elem;
+	arma::uword j = 0, i;
+
+	std::fill(out, out + blockSize, this->intercept);
+
+	for(; j + 4 <= numCols; j += 4) {
+		const double* x0 = newX + cols[j] * n + firstRow;
+		const double* x1 = newX + cols[j + 1] * n + firstRow;
+		const double* x2 = newX + cols[j + 2] * n + firstRow;
+		const double* x3 = newX + cols[j + 3] * n + firstRow;
+		const double c0 = coefs[j], c1 = coefs[j + 1], c2 = coefs[j + 2], c3 = coefs[j + 3];
+
+		for(i = 0; i < blockSize; ++i) {
+			out[i] += c0 * x0[i] + c1 * x1[i] + c2 * x2[i] + c3 * x3[i];
+		}
+	}
+
+	for(; j < numCols; ++j) {
+		const double* x0 = newX + cols[j] * n + firstRow;
+		const double c0 = coefs[j];
+
+		for(i = 0; i < blockSize; ++i) {
+			out[i] += c0 * x0[i];
+		}
+	}
+}
@@ -0,0 +1,87 @@
+//
+//  PLSModel.h
+//  gaselect
+//
+//
+
+#ifndef GenAlgPLS_PLSModel_h
+#define GenAlgPLS_PLSModel_h
+
+#include "config.h"
+
+#include <RcppArmadillo.h>
+
+#include "PLS.h"
+
+/**
+ * A fitted PLS model for a fixed variable subset and a fixed number of components.
+ *
+ * The model only stores what is needed for prediction: the selected columns,
+ * the regression coefficients and the intercept (which already includes
+ * the centering of X and y). Therefore predictions can be computed without
+ * the training data and without refitting.
+ */
+class PLSModel {
+public:
+	/**
+	 * @param columns The (0-based) indices of the selected columns in the original X matrix
+	 * @param coefficients The coefficients for the selected columns
+	 * @param intercept The intercept term
+	 * @param ncomp The number of components the coefficients were obtained with
+	 */
+	PLSModel(const arma::uvec &columns, const arma::vec &coefficients, double intercept, uint16_t ncomp);
+
+	/**
+	 * Fit a PLS model with `ncomp` components to the given columns of X.
+	 *
+	 * @param ncomp The 1-based number of components (0 ... as many as possible)
+	 */
+	static PLSModel fit(PLSMethod method, const arma::mat &X, const arma::vec &Y, const arma::uvec &columns, uint16_t ncomp);
+
+	/**
+	 * Predict the response for the n x p matrix newX (column-major) and
+	 * store the result in pred (which must have room for n values).
+	 * Only the selected columns of newX are accessed.
+	 *
+	 * @param numThreads The maximum number of threads to use
+	 */
+	void predict(const double* newX, arma::uword n, arma::uword p, double* pred, uint16_t numThreads = 1) const;
+
+	const arma::uvec& getColumns() const { return this->columns; }
+	const arma::vec& getCoefficients() const { return this->coefficients; }
+	double getIntercept() const { return this->intercept; }
+	uint16_t getNComp() const { return this->ncomp; }
+
+private:
+	/*
+	 * Number of rows processed at once. The partial predictions for a block
+	 * stay in the L1 cache while the selected columns are streamed through.
+	 */
+	static const arma::uword BLOCK_SIZE = 512;
+
+	/*
+	 * Do not bother starting threads for less blocks per thread than this
+	 */
+	static const arma::uword MIN_BLOCKS_PER_THREAD = 8;
+
+	struct PredictionJob {
+		const PLSModel* model;
+		const double* newX;
+		arma::uword n;
+		double* pred;
+		arma::uword firstRow;
+		arma::uword lastRow;
+	};
+
+	const arma::uvec columns;
+	const arma::vec coefficients;
+	const double intercept;
+	const uint16_t ncomp;
+
+	void predictRows(const double* newX, arma::uword n, double* pred, arma::uword firstRow, arma::uword lastRow) const;
+	void predictBlock(const double* newX, arma::uword n, double* pred, arma::uword firstRow, arma::uword blockSize) const;
+
+	static void* predictionThreadStart(void* obj);
+};
+
+#endif
@@ -12,40 +12,31 @@
 #include <stdexcept>
 #include <RcppArmadillo.h>
 #include "PLSSimpls.h"
+#include "SimdKernels.h"
 
-const double PLSSimpls::NORM_TOL = 1e-25;
+const double SimplsStepper::NORM_TOL = 1e-25;
 
 PLSSimpls::PLSSimpls(const arma::mat &X, const arma::vec &Y) : PLS(X, Y) {
 }
 
+PLSSimpls::PLSSimpls(const std::shared_ptr<const arma::mat> &X, const arma::vec &Y, const arma::uvec &rows) : PLS(X, Y, rows) {
+}
+
 PLSSimpls::~PLSSimpls() {
 }
 
 std::unique_ptr<PLS> PLSSimpls::clone() const {
-	return std::unique_ptr<PLS>(new PLSSimpls(arma::mat(this->X), arma::mat(this->Y)));
+	return std::unique_ptr<PLS>(new PLSSimpls(this->X, this->Y, this->rows));
 }
 
-inline void PLSSimpls::centerView() {
-	// center X and Y
-
-	switch(this->currentViewState) {
-		case PLS::UNKNOWN:
-			this->viewX = this->X;
-			this->viewY = this->Y;
-			break;
-		case PLS::COLUMNS:
-			this->viewX = this->viewXCol;
-			this->viewY = this->Y;
-			break;
-		default:
-			break;
-	}
-
-	this->Xmean = arma::mean(this->viewX);
-	this->Ymean = arma::mean(this->viewY);
+std::unique_ptr<PLS> PLSSimpls::cloneWithResponse(const arma::vec &Y) const {
+	return std::unique_ptr<PLS>(new PLSSimpls(this->X, Y, this->rows));
+}
 
-	this->viewX.each_row() -= this->Xmean;
-	this->viewY -= this->Ymean;
+std::unique_ptr<PLS> PLSSimpls::cloneWithRows(const arma::uvec &rows) const {
+	/* The rows are relative to the rows used by this object */
+	arma::uvec absoluteRows = (this->rows.n_elem > 0) ? arma::uvec(this->rows.elem(rows)) : rows;
+	return std::unique_ptr<PLS>(new PLSSimpls(this->X, this->Y.elem(rows), absoluteRows));
 }
 
 /* Small highly optimized functions */
@@ -68,23 +59,7 @@ inline void stabilizedGramSchmidt(arma::mat &V, arma::uword col) {
  * s = s - v * v.t() * s
  */
 inline void manualDeflate(arma::vec& s, arma::vec &v) {
-	double *vm = v.memptr();
-	double *sm = s.memptr();
-	arma::uword i;
-	double dot = 0, norm = 0;
-
-	for (i = 0; i < s.n_elem; ++i) {
-		norm += vm[i] * vm[i];
-		dot += vm[i] * sm[i];
-	}
-
-	dot /= norm;
-	norm = sqrt(norm);
-
-	for (i = 0; i < s.n_elem; ++i) {
-		sm[i] -= vm[i] * dot;
-		vm[i] /= norm;
-	}
+	SimdKernels::deflate(s.memptr(), v.memptr(), s.n_elem);
 }
 
 /**
@@ -93,10 +68,7 @@ inline void manualDeflate(arma::vec& s, arma::vec &v) {
  * without the need of any memory copying whatsoever.
  */
 inline void updateCoefs(double *Cm, const arma::vec& s, const double a, const arma::uword col) {
-	const double *sm = s.memptr();
-	for (arma::uword i = 0, n = col * s.n_elem, o = (col - 1) * s.n_elem; i < s.n_elem; ++o, ++n, ++i) {
-		Cm[n] = Cm[o] + sm[i] * a;
-	}
+	SimdKernels::addScaled(Cm + col * s.n_elem, Cm + (col - 1) * s.n_elem, s.memptr(), a, s.n_elem);
 }
 }
 
@@ -104,63 +76,105 @@ inline void updateCoefs(double *Cm, const arma::vec& s, const double a, const ar
  * ncomp is 1-based!!!
  */
 void PLSSimpls::fit(uint16_t ncomp) {
-	uint16_t maxNComp = ((this->viewX.n_cols < this->viewX.n_rows) ? this->viewX.n_cols : this->viewX.n_rows - 1);
+	const arma::mat &viewX = this->getCurrentViewX();
+	uint16_t maxNComp = ((viewX.n_cols < viewX.n_rows) ? viewX.n_cols : viewX.n_rows - 1);
 	if(ncomp == 0 || ncomp > maxNComp) {
 		ncomp = maxNComp;
 	}
 
+	switch(this->currentViewState) {
+		case PLS::ROWS:
+			/* The row view is a private copy of the data, so it is centered in place instead of being copied again */
+			this->stepper.initInPlace(this->viewX, this->viewY, ncomp);
+			this->currentViewState = PLS::CENTERED_ROWS;
+			break;
+		case PLS::CENTERED_ROWS:
+			this->stepper.restart(this->viewY, ncomp);
+			break;
+		default:
+			this->initStepper(this->stepper, ncomp);
+			break;
+	}
+
+	for(uint16_t i = 0; i < ncomp; ++i) {
+		this->stepper.step();
+	}
+
+	this->resultNComp = ncomp;
+}
+
+void SimplsStepper::init(const arma::mat &X, const arma::vec &Y, uint16_t maxNComp) {
+	/*
+	 * Center a copy of X, because the data of the view must not be changed
+	 */
+	this->ownX = X;
+	this->initInPlace(this->ownX, Y, maxNComp);
+}
+
+void SimplsStepper::initInPlace(arma::mat &X, const arma::vec &Y, uint16_t maxNComp) {
 	/*
-	 * Center X and Y views
+	 * Center X and Y
 	 */
-	this->centerView();
+	this->Xmean = arma::mean(X);
+	X.each_row() -= this->Xmean;
+	this->X = &X;
+
+	this->restart(Y, maxNComp);
+}
+
+void SimplsStepper::restart(const arma::vec &Y, uint16_t maxNComp) {
+	this->Ymean = arma::mean(Y);
+	this->Y = Y - this->Ymean;
 
 	/*
 	 * Init neccessary matrices and vectors
 	 * Variable names are according to the original paper by S. de Jong (1993)
 	 */
+	this->coef.zeros(this->X->n_cols, maxNComp);
+	this->intercepts.zeros(maxNComp);
+	this->V.set_size(this->X->n_cols, maxNComp);
 
-	this->coef.zeros(this->viewX.n_cols, ncomp);
-	this->intercepts.zeros(ncomp);
-	this->V.set_size(this->viewX.n_cols, ncomp);
-
-	arma::vec S = this->viewX.t() * this->viewY; // Cross product
+	this->S = this->X->t() * this->Y; // Cross product
+	this->ncomp = 0;
+}
 
-	// Working vectors
-	arma::vec t; // X block factor scores
+void SimplsStepper::step() {
+	const uint16_t i = this->ncomp;
 	double tnorm = 1.0;
 	double q;
 
-	for(uint16_t i = 0; i < ncomp; ++i) {
-		arma::vec v = this->V.unsafe_col(i);
-		t = this->viewX * S;
+	if(i >= this->coef.n_cols) {
+		throw std::out_of_range("Can not add more components than specified when initializing the fit");
+	}
 
-		t -= arma::mean(t); // Center y block factor scores
-		tnorm = arma::norm(t, 2); // Calculate norm
+	arma::vec v = this->V.unsafe_col(i);
+	this->t = *this->X * this->S;
 
-		// The norm of t can be zero (or close to it). This is unacceptable.
-		if (tnorm < PLSSimpls::NORM_TOL) {
-			throw std::underflow_error("All block-factor scores are (almost) zero.");
-		}
+	this->t -= arma::mean(this->t); // Center y block factor scores
+	tnorm = arma::norm(this->t, 2); // Calculate norm
 
-		t /= tnorm;  // Normalize scores
+	// The norm of t can be zero (or close to it). This is unacceptable.
+	if (tnorm < SimplsStepper::NORM_TOL) {
+		throw std::underflow_error("All block-factor scores are (almost) zero.");
+	}
 
-		v = this->viewX.t() * t; // Calculate x loadings
-		q = arma::dot(this->viewY, t); // Calculate y loadings
+	this->t /= tnorm;  // Normalize scores
 
-		if(i > 0) {
-			stabilizedGramSchmidt(this->V, i); // Make v orthogonal to previous loadings
-			updateCoefs(this->coef.memptr(), S, q / tnorm, i);
-//			this->coef.col(i) = this->coef.col(i - 1) + S * q / tnorm;
-		} else {
-			this->coef.col(i) = S * q / tnorm;
-		}
+	v = this->X->t() * this->t; // Calculate x loadings
+	q = arma::dot(this->Y, this->t); // Calculate y loadings
 
+	if(i > 0) {
+		stabilizedGramSchmidt(this->V, i); // Make v orthogonal to previous loadings
+		updateCoefs(this->coef.memptr(), this->S, q / tnorm, i);
+//		this->coef.col(i) = this->coef.col(i - 1) + S * q / tnorm;
+	} else {
+		this->coef.col(i) = this->S * q / tnorm;
+	}
 
-		/* deflate S and norm v */
-		manualDeflate(S, v);
+	/* deflate S and norm v */
+	manualDeflate(this->S, v);
 
-		this->intercepts[i] = this->Ymean - arma::dot(this->Xmean, this->coef.col(i));
-	}
+	this->intercepts[i] = this->Ymean - arma::dot(this->Xmean, this->coef.col(i));
 
-	this->resultNComp = ncomp;
+	++this->ncomp;
 }
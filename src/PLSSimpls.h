@@ -14,31 +14,66 @@
 #include <RcppArmadillo.h>
 #include "PLS.h"
 
+/**
+ * Incremental SIMPLS fit (S. de Jong, 1993)
+ */
+class SimplsStepper : public PLSStepper {
+public:
+	SimplsStepper() : X(NULL) {};
+	~SimplsStepper() {};
+
+	void init(const arma::mat &X, const arma::vec &Y, uint16_t maxNComp);
+	void step();
+
+	/**
+	 * Start a new fit without copying X: X is centered in place and must not be changed
+	 * until the fit is finished
+	 */
+	void initInPlace(arma::mat &X, const arma::vec &Y, uint16_t maxNComp);
+
+	/**
+	 * Start a new fit for the data X was centered in place for by the last call to `initInPlace`
+	 */
+	void restart(const arma::vec &Y, uint16_t maxNComp);
+
+private:
+	static const double NORM_TOL;
+
+	arma::mat ownX; // Centered copy of X (only used by `init`)
+	const arma::mat *X; // Centered X
+	arma::vec Y; // Centered Y
+	arma::rowvec Xmean; // Column means of X
+	double Ymean; // mean of Y
+
+	arma::vec S; // Cross product (deflated after each component)
+	arma::mat V; // Orthogonal loadings
+	arma::vec t; // X block factor scores
+};
+
 class PLSSimpls : public PLS {
 public:
 	PLSSimpls(const arma::mat &X, const arma::vec &Y);
+	PLSSimpls(const std::shared_ptr<const arma::mat> &X, const arma::vec &Y, const arma::uvec &rows = arma::uvec());
 	~PLSSimpls();
 
 	void fit(uint16_t ncomp = 0);
-	const arma::mat& getCoefficients() const { return this->coef; }
-	const arma::vec& getIntercepts() const { return this->intercepts; };
+	const arma::mat& getCoefficients() const { return this->stepper.getCoefficients(); }
+	const arma::vec& getIntercepts() const { return this->stepper.getIntercepts(); };
 
 	virtual std::unique_ptr<PLS> clone() const;
+	virtual std::unique_ptr<PLS> cloneWithResponse(const arma::vec &Y) const;
+	virtual std::unique_ptr<PLS> cloneWithRows(const arma::uvec &rows) const;
 
-private:
-	static const double NORM_TOL;
-	arma::mat coef; // Matrix with coefficients
-	arma::vec intercepts; // n x ncomp matrix with intercept terms
-	double Ymean; // mean of Y
-	arma::rowvec Xmean; // Column means of X
-
-	void centerView();
+	virtual std::unique_ptr<PLSStepper> createStepper() const {
+		return std::unique_ptr<PLSStepper>(new SimplsStepper());
+	}
 
+private:
 	/*
-	 * Following private variables are only for fitting, but it is faster to not
-	 * destroy them after each fit
+	 * The stepper is kept as member, because it is faster to not
+	 * destroy the working matrices after each fit
 	 */
-	arma::mat V; // Orthogonal loadings
+	SimplsStepper stepper;
 };
 
 #endif
@@ -0,0 +1,159 @@
+//
+//  ParallelReplicates.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <vector>
+#include <memory>
+#include <RcppArmadillo.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "Logger.h"
+#include "SingleThreadPopulation.h"
+#include "EDAPopulation.h"
+#include "ParallelReplicates.h"
+
+/*
+ * R user interrupt handling helpers
+ */
+static inline void replicates_check_interrupt_impl(void* /*dummy*/) {
+	R_CheckUserInterrupt();
+}
+
+static inline bool replicates_check_interrupt() {
+	return (R_ToplevelExec(replicates_check_interrupt_impl, NULL) == FALSE);
+}
+
+ParallelReplicates::ParallelReplicates(const Control &ctrl, uint16_t numThreads) :
+	ctrl(ctrl.chromosomeSize, ctrl.populationSize, ctrl.numGenerations, ctrl.elitism, ctrl.minVariables,
+		 ctrl.maxVariables, ctrl.mutationProbability, 1, ctrl.maxDuplicateEliminationTries, ctrl.badSolutionThreshold,
+		 ctrl.crossover, ctrl.fitnessScaling, OFF, std::string(), ctrl.mutationWeighting, ctrl.engine,
+		 ctrl.learningRate, ctrl.selectionRatio, ctrl.freeColumns, ctrl.forcedColumns, ctrl.numColumns,
+		 ctrl.minPopulationSize, ctrl.idleTask),
+	numThreads((numThreads < 1) ? 1 : numThreads), numReplicates(0), nextReplicate(0), interrupted(false)
+{
+}
+
+std::unique_ptr<Population> ParallelReplicates::createPopulation(::Evaluator &evaluator, const std::vector<uint32_t> &seed,
+																 bool checkUserInterrupt) const {
+	std::unique_ptr<Population> pop;
+
+	if(this->ctrl.engine == ENGINE_EDA) {
+		pop.reset(new EDAPopulation(this->ctrl, evaluator, seed, checkUserInterrupt));
+	} else {
+		pop.reset(new SingleThreadPopulation(this->ctrl, evaluator, seed, checkUserInterrupt));
+	}
+
+	return pop;
+}
+
+void ParallelReplicates::runReplicates(uint32_t numReplicates) {
+	this->numReplicates = numReplicates;
+	this->nextReplicate = 0;
+	this->interrupted = false;
+	this->errorMessage.clear();
+
+#ifdef HAVE_PTHREAD_H
+	std::vector<pthread_t> threads(this->numThreads - 1);
+	uint16_t t, spawnedThreads = 0;
+
+	if(pthread_mutex_init(&this->mutex, NULL) != 0) {
+		throw ThreadingError("Mutex for synchronization could not be initialized");
+	}
+
+	GAout.enableThreadSafety(true);
+	GAerr.enableThreadSafety(true);
+
+	for(t = 0; t < threads.size(); ++t) {
+		if(pthread_create(&threads[spawnedThreads], NULL, &ParallelReplicates::workerThreadStart, (void *) this) == 0) {
+			++spawnedThreads;
+		}
+	}
+
+	this->work(true);
+
+	for(t = 0; t < spawnedThreads; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+
+	GAout.enableThreadSafety(false);
+	GAerr.enableThreadSafety(false);
+
+	pthread_mutex_destroy(&this->mutex);
+
+	if(spawnedThreads < threads.size()) {
+		GAerr << "Warning: Only " << spawnedThreads << " threads could be spawned" << std::endl;
+	}
+#else
+	this->work(true);
+#endif
+
+	if(!this->errorMessage.empty()) {
+		throw std::runtime_error(this->errorMessage);
+	}
+}
+
+#ifdef HAVE_PTHREAD_H
+void* ParallelReplicates::workerThreadStart(void* obj) {
+	static_cast<ParallelReplicates*>(obj)->work(false);
+	return NULL;
+}
+#endif
+
+inline void ParallelReplicates::lock() {
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&this->mutex);
+#endif
+}
+
+inline void ParallelReplicates::unlock() {
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&this->mutex);
+#endif
+}
+
+bool ParallelReplicates::takeNextReplicate(uint32_t &index) {
+	bool available;
+
+	this->lock();
+
+	available = !this->interrupted && this->errorMessage.empty() && this->nextReplicate < this->numReplicates;
+	if(available) {
+		index = this->nextReplicate++;
+	}
+
+	this->unlock();
+
+	return available;
+}
+
+void ParallelReplicates::work(bool mainThread) {
+	uint32_t index;
+	bool finished;
+
+	while(this->takeNextReplicate(index)) {
+		try {
+			finished = this->runReplicate(index, mainThread);
+		} catch(const std::exception &e) {
+			finished = true;
+
+			this->lock();
+			if(this->errorMessage.empty()) {
+				this->errorMessage = e.what();
+			}
+			this->unlock();
+		}
+
+		if(!finished || (mainThread && replicates_check_interrupt())) {
+			this->lock();
+			this->interrupted = true;
+			this->unlock();
+		}
+	}
+}
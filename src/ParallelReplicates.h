@@ -0,0 +1,108 @@
+//
+//  ParallelReplicates.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_ParallelReplicates_h
+#define gaselect_ParallelReplicates_h
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "Control.h"
+#include "Evaluator.h"
+#include "Population.h"
+
+/**
+ * Run many independent replicates of the genetic algorithm (e.g., for permuted responses
+ * or resampled observations) concurrently.
+ *
+ * The replicates are distributed among the threads, where every replicate is run with a
+ * single threaded population and without any output. Only the main thread checks for
+ * user interrupts.
+ */
+class ParallelReplicates {
+public:
+	class ThreadingError : public std::runtime_error {
+	public:
+		ThreadingError(const char* what) : std::runtime_error(what) {};
+		virtual ~ThreadingError() throw() {};
+	};
+
+	/**
+	 * @param ctrl The control object for the GA (the number of threads, the verbosity level
+	 *			and the telemetry file are ignored, as every replicate runs silently in a single thread)
+	 * @param numThreads The number of threads to use (including the main thread)
+	 */
+	ParallelReplicates(const Control &ctrl, uint16_t numThreads);
+	virtual ~ParallelReplicates() {};
+
+	bool wasInterrupted() const { return this->interrupted; }
+
+protected:
+	/* The control object for a single replicate */
+	const Control ctrl;
+
+	/**
+	 * Run the replicates 0, ..., numReplicates - 1 and wait until all are finished
+	 *
+	 * @throws std::runtime_error if a replicate failed
+	 */
+	void runReplicates(uint32_t numReplicates);
+
+	/**
+	 * Create the (single threaded) population for a replicate according to the search engine
+	 */
+	std::unique_ptr<Population> createPopulation(::Evaluator &evaluator, const std::vector<uint32_t> &seed,
+												 bool checkUserInterrupt) const;
+
+	/**
+	 * Run a single replicate
+	 *
+	 * @param checkUserInterrupt True if the replicate is run in the main thread and may check for user interrupts
+	 * @return false if the replicate was interrupted
+	 */
+	virtual bool runReplicate(uint32_t index, bool checkUserInterrupt) = 0;
+
+private:
+	const uint16_t numThreads;
+
+	uint32_t numReplicates;
+	uint32_t nextReplicate;
+	bool interrupted;
+	std::string errorMessage;
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t mutex;
+
+	static void* workerThreadStart(void* obj);
+#endif
+
+	/**
+	 * Run replicates until none are left
+	 *
+	 * @param mainThread If true, the worker checks for user interrupts
+	 */
+	void work(bool mainThread);
+
+	/**
+	 * Get the index of the next replicate to run
+	 *
+	 * @return false if no replicates are left
+	 */
+	bool takeNextReplicate(uint32_t &index);
+
+	void lock();
+	void unlock();
+};
+
+#endif
@@ -0,0 +1,109 @@
+//
+//  PermutationTest.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <vector>
+#include <limits>
+#include <memory>
+#include <algorithm>
+#include <RcppArmadillo.h>
+
+#include "Population.h"
+#include "PermutationTest.h"
+
+PermutationTest::PermutationTest(const Control &ctrl, const ::Evaluator &evaluator, const arma::mat &X, const arma::vec &y,
+								 const std::vector<uint32_t> &seed, uint16_t numThreads) :
+	ParallelReplicates(ctrl, numThreads), evaluator(evaluator), y(y), seed(seed)
+{
+	if(this->ctrl.mutationWeighting == MUTATION_UNIVARIATE) {
+		/* The weights must only cover the variables spanned by the chromosomes */
+		if(this->ctrl.freeColumns.empty()) {
+			this->relevance.reset(new UnivariateRelevance(X));
+		} else {
+			arma::uvec freeColumns(this->ctrl.freeColumns.size());
+			for(arma::uword j = 0; j < freeColumns.n_elem; ++j) {
+				freeColumns[j] = this->ctrl.freeColumns[j];
+			}
+
+			this->freeX = X.cols(freeColumns);
+			this->relevance.reset(new UnivariateRelevance(this->freeX));
+		}
+	}
+}
+
+void PermutationTest::run(uint32_t numPermutations, RNG &rng) {
+	uint32_t i, j, k;
+
+	/*
+	 * Draw all permutations and seeds up front in the main thread, so the
+	 * result does not depend on the order in which the threads process the replicates
+	 */
+	this->replicates.resize(numPermutations + 1);
+
+	this->replicates[0].y = this->y;
+	this->replicates[0].seed = this->seed;
+
+	for(i = 1; i <= numPermutations; ++i) {
+		Replicate &rep = this->replicates[i];
+		rep.y = this->y;
+
+		/* Fisher-Yates shuffle */
+		for(j = rep.y.n_elem - 1; j > 0; --j) {
+			k = (uint32_t) rng(0.0, (double) (j + 1));
+			if(k > j) {
+				k = j;
+			}
+			std::swap(rep.y[j], rep.y[k]);
+		}
+
+		rep.seed.reserve(RNG::SEED_SIZE);
+		for(j = 0; j < RNG::SEED_SIZE; ++j) {
+			rep.seed.push_back(rng());
+		}
+	}
+
+	for(i = 0; i <= numPermutations; ++i) {
+		this->replicates[i].bestFitness = std::numeric_limits<double>::quiet_NaN();
+	}
+
+	this->runReplicates(numPermutations + 1);
+}
+
+std::vector<double> PermutationTest::getNullDistribution() const {
+	std::vector<double> nullDistribution;
+	nullDistribution.reserve(this->replicates.size() - 1);
+
+	for(std::vector<Replicate>::const_iterator it = this->replicates.begin() + 1; it != this->replicates.end(); ++it) {
+		nullDistribution.push_back(it->bestFitness);
+	}
+
+	return nullDistribution;
+}
+
+bool PermutationTest::runReplicate(uint32_t index, bool checkUserInterrupt) {
+	Replicate &replicate = this->replicates[index];
+	std::unique_ptr<::Evaluator> eval(this->evaluator.cloneWithResponse(replicate.y));
+	std::unique_ptr<Population> pop = this->createPopulation(*eval, replicate.seed, checkUserInterrupt);
+
+	if(this->relevance) {
+		pop->setVariableWeights((*this->relevance)(replicate.y));
+	}
+
+	pop->run();
+
+	if(pop->wasInterrupted()) {
+		return false;
+	}
+
+	Population::SortedChromosomes result = pop->getResult();
+
+	if(!result.empty()) {
+		replicate.bestFitness = result.rbegin()->getFitness();
+	}
+
+	return true;
+}
@@ -0,0 +1,83 @@
+//
+//  PermutationTest.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_PermutationTest_h
+#define gaselect_PermutationTest_h
+
+#include "config.h"
+
+#include <vector>
+#include <memory>
+#include <RcppArmadillo.h>
+
+#include "Control.h"
+#include "Evaluator.h"
+#include "RNG.h"
+#include "UnivariateRelevance.h"
+#include "ParallelReplicates.h"
+
+/**
+ * Run the genetic algorithm for the original response and for a number of randomly
+ * permuted responses to obtain the null distribution of the best fitness.
+ *
+ * All replicates use clones of the same evaluator (see Evaluator::cloneWithResponse),
+ * i.e., everything that only depends on X (the data, the segmentation, column statistics)
+ * is set up only once.
+ */
+class PermutationTest : public ParallelReplicates {
+public:
+	/**
+	 * @param ctrl The control object for the GA
+	 * @param evaluator The evaluator for the original response
+	 * @param X The data matrix (only used for univariate mutation weights)
+	 * @param y The original response
+	 * @param seed The seed for the population of the original response
+	 * @param numThreads The number of threads to use (including the main thread)
+	 */
+	PermutationTest(const Control &ctrl, const ::Evaluator &evaluator, const arma::mat &X, const arma::vec &y,
+					const std::vector<uint32_t> &seed, uint16_t numThreads);
+
+	/**
+	 * Run the GA for the original and `numPermutations` permuted responses.
+	 *
+	 * @param rng The RNG used to draw the permutations and the seeds of the replicates
+	 */
+	void run(uint32_t numPermutations, RNG &rng);
+
+	/**
+	 * The best fitness found for the original response
+	 */
+	double getObservedFitness() const { return this->replicates[0].bestFitness; }
+
+	/**
+	 * The best fitness found for every permuted response
+	 * (NaN if the replicate was not run because of an interrupt)
+	 */
+	std::vector<double> getNullDistribution() const;
+
+protected:
+	bool runReplicate(uint32_t index, bool checkUserInterrupt);
+
+private:
+	struct Replicate {
+		arma::vec y;
+		std::vector<uint32_t> seed;
+		double bestFitness;
+	};
+
+	const ::Evaluator &evaluator;
+	const arma::vec &y;
+	const std::vector<uint32_t> &seed;
+
+	/* The columns spanned by the chromosomes (only if some columns are forced in or out) */
+	arma::mat freeX;
+	std::unique_ptr<UnivariateRelevance> relevance;
+
+	/* Replicate 0 is the original response */
+	std::vector<Replicate> replicates;
+};
+
+#endif
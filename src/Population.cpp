@@ -0,0 +1,113 @@
+//
+//  Population.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <vector>
+#include <cmath>
+#include <RcppArmadillo.h>
+
+#include "Logger.h"
+#include "ShuffledSet.h"
+#include "LocalityOrder.h"
+#include "Population.h"
+
+const double Population::POPULATION_GROWTH_FACTOR = 1.5;
+const double Population::POPULATION_SHRINK_FACTOR = 0.8;
+
+uint32_t Population::mateBatch(ChVecIt begin, ChildBatch &batch, ::Evaluator &evaluator, RNG &rng, ShuffledSet &shuffledSet, double sumFitness) {
+	const size_t numChildren = batch.open.size();
+	std::vector<size_t> slots;
+	std::vector<size_t> candidates;
+	std::vector<bool> isCandidate(numChildren, false);
+	std::vector<arma::uvec> columnSubsets;
+	uint32_t numEvaluations = 0;
+	size_t i, j;
+
+	for(i = 0; i < numChildren; ++i) {
+		if(batch.open[i]) {
+			slots.push_back(i);
+		}
+	}
+
+	/*
+	 * Mate two parents for every pair of open slots
+	 * If the number of open slots is odd, the last slot gets both children (as in the regular mating)
+	 */
+	for(i = 0; i < slots.size(); i += 2) {
+		Chromosome *child1 = *(begin + slots[i]);
+		Chromosome *child2 = (i + 1 < slots.size()) ? *(begin + slots[i + 1]) : child1;
+		Chromosome *parent1 = this->drawChromosomeFromCurrentGeneration(rng(0.0, sumFitness));
+		Chromosome *parent2;
+
+		do {
+			parent2 = this->drawChromosomeFromCurrentGeneration(rng(0.0, sumFitness));
+		} while(parent1 == parent2);
+
+		parent1->mateWith(*parent2, rng, *child1, *child2);
+
+		const double minParentFitness = ((parent1->getFitness() > parent2->getFitness()) ? parent1->getFitness() : parent2->getFitness());
+		const double cutoff = minParentFitness - this->ctrl.badSolutionThreshold * fabs(minParentFitness);
+
+		child1->mutate(rng, this->mutationSampler.get());
+		batch.cutoffs[slots[i]] = cutoff;
+
+		if(child2 != child1) {
+			child2->mutate(rng, this->mutationSampler.get());
+			batch.cutoffs[slots[i + 1]] = cutoff;
+		}
+	}
+
+	/*
+	 * Duplicates of accepted children or of other children in this batch are generated anew
+	 * (or reset to a random point if this was tried too often)
+	 */
+	for(i = 0; i < slots.size(); ++i) {
+		Chromosome *child = *(begin + slots[i]);
+		bool duplicated = false;
+
+		if(this->ctrl.maxDuplicateEliminationTries > 0) {
+			for(j = 0; j < numChildren && !duplicated; ++j) {
+				duplicated = (j != slots[i]) && (!batch.open[j] || isCandidate[j]) && (**(begin + j) == *child);
+			}
+		}
+
+		if(duplicated) {
+			if(++batch.tries[slots[i]] <= this->ctrl.maxDuplicateEliminationTries) {
+				continue;
+			}
+			child->randomlyReset(rng, shuffledSet);
+		}
+
+		batch.tries[slots[i]] = 0;
+		isCandidate[slots[i]] = true;
+		candidates.push_back(slots[i]);
+		columnSubsets.push_back(child->toColumnSubset());
+	}
+
+	const std::vector<size_t> order = LocalityOrder::order(columnSubsets);
+
+	for(std::vector<size_t>::const_iterator it = order.begin(); it != order.end(); ++it) {
+		const size_t slot = candidates[*it];
+
+		try {
+			++numEvaluations;
+			if(evaluator.evaluate(**(begin + slot)) > batch.cutoffs[slot]) {
+				batch.open[slot] = false;
+			} else if(++batch.discarded > Population::MAX_DISCARDED_SOLUTIONS_RATIO * numChildren) {
+				GAout << GAout.lock() << "Warning: The algorithm may be stuck. Try increasing the badSolutionThreshold!\n" << GAout.unlock();
+				batch.discarded = 0;
+				batch.open[slot] = false;
+			}
+		} catch(const ::Evaluator::EvaluatorException& ee) {
+			if(this->ctrl.verbosity >= VERBOSE) {
+				GAout << GAout.lock() << "Could not evaluate chromosome: " << ee.what() << "\n" << GAout.unlock();
+			}
+		}
+	}
+
+	return numEvaluations;
+}
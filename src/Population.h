@@ -14,6 +14,10 @@
 #include <set>
 #include <utility>
 #include <algorithm>
+#include <memory>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
 
 #include "Logger.h"
 #include "RNG.h"
@@ -21,6 +25,9 @@
 #include "Evaluator.h"
 #include "Control.h"
 #include "OnlineStddev.h"
+#include "Telemetry.h"
+#include "SnapshotWriter.h"
+#include "WeightedSampler.h"
 
 #ifdef ENABLE_DEBUG_VERBOSITY
 #define IF_DEBUG(expr) if(this->ctrl.verbosity == DEBUG_GA || this->ctrl.verbosity == DEBUG_ALL) { expr; }
@@ -47,6 +54,10 @@ protected:
 	static const uint8_t MAX_DISCARDED_SOLUTIONS_RATIO = 20;
 	static const int16_t DEFAULT_SCALING_MEAN = 6;
 
+	/* How the population size changes after a generation with resp. without improvement */
+	static const double POPULATION_GROWTH_FACTOR;
+	static const double POPULATION_SHRINK_FACTOR;
+
 	const Control& ctrl;
 	::Evaluator& evaluator;
 	const std::vector<uint32_t> &seed;
@@ -55,22 +66,59 @@ protected:
 	std::vector<double> currentGenFitnessMap;
 	double minEliteFitness;
 	bool interrupted;
+	std::unique_ptr<Telemetry> telemetry;
+	std::unique_ptr<SnapshotWriter> snapshots;
+
+	/*
+	 * The sampler used for weighted mutation (NULL if all variables are equally likely)
+	 * It is only modified between generations, so it can be shared by all threads.
+	 */
+	std::unique_ptr<WeightedSampler> mutationSampler;
+
+	/* Cache statistics of evaluators (e.g., per-thread clones) that no longer exist */
+	::Evaluator::CacheStatistics retiredCacheStatistics;
+
+	/*
+	 * The number of children in the current generation (at most ctrl.populationSize, see `adaptPopulationSize`).
+	 * All buffers are allocated for the maximum size, only the first `populationSize` entries are used.
+	 */
+	uint16_t populationSize;
+
+	/* The number of used entries in the fitness map (the children and the elite) */
+	uint32_t fitnessMapSize;
 
 private:
 	OnlineStddev fitStats;
 	ChVec currentGeneration;
 	std::vector<double> fitnessHistory;
 
+	/* The (smoothed) number of times each variable was included in a chromosome */
+	std::vector<double> inclusionCounts;
+
 public:
 	Population(const Control &ctrl, ::Evaluator &evaluator, const std::vector<uint32_t> &seed) :
 		ctrl(ctrl), evaluator(evaluator), seed(seed), currentGenFitnessMap(ctrl.populationSize + ctrl.elitism, 0.0),
-		interrupted(false) {
+		interrupted(false), populationSize(ctrl.populationSize), fitnessMapSize(0) {
 		this->currentGeneration.reserve(this->ctrl.populationSize + this->ctrl.elitism);
 
 		this->minEliteFitness = 0.0;
 
 		this->fitnessHistory.reserve(3 * this->ctrl.numGenerations);
 
+		if(!this->ctrl.telemetryFile.empty()) {
+			this->telemetry.reset(new Telemetry(this->ctrl.telemetryFile, this->ctrl.numGenerations, this->ctrl.numThreads));
+		}
+
+		if(!this->ctrl.snapshotFile.empty()) {
+			this->snapshots.reset(new SnapshotWriter(this->ctrl.snapshotFile, this->ctrl));
+		}
+
+		if(this->ctrl.mutationWeighting == MUTATION_FREQUENCY) {
+			/* Start with a count of 1 for every variable, i.e., uniform weights */
+			this->inclusionCounts.assign(this->ctrl.chromosomeSize, 1.0);
+			this->mutationSampler.reset(new WeightedSampler(this->inclusionCounts));
+		}
+
 		switch (this->ctrl.fitnessScaling) {
 			case EXP:
 				this->transformFitness = &Population::transformFitnessExp;
@@ -82,6 +130,10 @@ public:
 	}
 	
 	virtual ~Population() {
+		if(this->telemetry) {
+			this->telemetry->finish(this->interrupted);
+		}
+
 		for(ChVecIt it = this->currentGeneration.begin(); it != this->currentGeneration.end(); ++it) {
 			delete *it;
 		}
@@ -93,18 +145,68 @@ public:
 		return this->interrupted;
 	}
 
+	/**
+	 * Set the relevance of each variable used for weighted mutation.
+	 * This has no effect unless the mutation weighting is MUTATION_UNIVARIATE.
+	 *
+	 * @param weights A non-negative weight for every variable
+	 */
+	inline void setVariableWeights(const std::vector<double> &weights) {
+		if(this->ctrl.mutationWeighting == MUTATION_UNIVARIATE) {
+			if(weights.size() != this->ctrl.chromosomeSize) {
+				throw std::invalid_argument("The number of variable weights must match the chromosome size");
+			}
+			this->mutationSampler.reset(new WeightedSampler(weights));
+		}
+	}
+
+	/**
+	 * Evaluate the given variable subsets and add them to the elite before the algorithm is run.
+	 * This way they are part of every generation and take part in mating from the first generation on.
+	 * Subsets that can not be evaluated are ignored.
+	 *
+	 * @param subsets The positions of the selected variables in the chromosome
+	 */
+	inline void seedElite(const std::vector<arma::uvec> &subsets) {
+		ShuffledSet shuffledSet(this->ctrl.chromosomeSize);
+		RNG rng(this->seed);
+
+		for(std::vector<arma::uvec>::const_iterator it = subsets.begin(); it != subsets.end(); ++it) {
+			Chromosome ch(this->ctrl, shuffledSet, rng, false);
+			ch.setVariables(*it);
+
+			try {
+				this->evaluator.evaluate(ch);
+				this->addChromosomeToElite(ch);
+			} catch(const ::Evaluator::EvaluatorException &ee) {
+				IF_DEBUG(GAout << "Seed could not be evaluated: " << ee.what() << std::endl)
+			}
+		}
+	}
+
 	inline const std::vector<double>& getFitnessEvolution() {
 		return this->fitnessHistory;
 	};
 
+	/**
+	 * The statistics of the caches of all evaluators used by the population
+	 */
+	inline ::Evaluator::CacheStatistics getCacheStatistics() const {
+		::Evaluator::CacheStatistics stats(this->retiredCacheStatistics);
+		this->evaluator.addCacheStatistics(stats);
+		return stats;
+	}
+
 	inline SortedChromosomes getResult() const {
 		SortedChromosomes result(this->elite);
 		
 		/*
 		 * result.insert(begin(), end()) can not be used because we need to
-		 * insert the VALUE and not the pointer to a chromosome
+		 * insert the VALUE and not the pointer to a chromosome.
+		 * Only the part of the current generation that is in use is considered.
 		 */
-		for(ChVec::const_iterator it = this->currentGeneration.begin(); it != this->currentGeneration.end(); ++it) {
+		const ChVec::const_iterator end = this->currentGeneration.begin() + this->fitnessMapSize;
+		for(ChVec::const_iterator it = this->currentGeneration.begin(); it != end; ++it) {
 			result.insert(**it);
 		}
 		
@@ -122,13 +224,91 @@ private:
 		return fitness;
 	}
 
+	/**
+	 * Add the elite to the current generation and the fitness map (after the new generation was added)
+	 * and update the inclusion counts and the fitness history
+	 *
+	 * @param double sumFitness The sum of the (transformed) fitness of the new generation
+	 * @param double minFitness The transformed minimum fitness
+	 * @return The sum of the (transformed) fitness of the whole current generation
+	 */
+	inline double finishCurrentGeneration(double sumFitness, double fitMean, double fitSD, double minFitness) {
+		uint16_t i = this->populationSize;
+		double fitt;
+
+		/*
+		 * Add all chromosomes from the elite
+		 */
+		for(SortedChromosomes::iterator eliteIt = this->elite.begin(); eliteIt != this->elite.end(); ++eliteIt, ++i) {
+			*(this->currentGeneration[i]) = *(eliteIt);
+
+			this->fitStats.update(this->currentGeneration[i]->getFitness());
+
+			fitt = (eliteIt->getFitness() - fitMean) / fitSD;
+			sumFitness += (this->*transformFitness)(fitt) - minFitness;
+
+			this->currentGenFitnessMap[i] = sumFitness;
+
+			IF_DEBUG(
+				GAout << (std::stringstream() << std::fixed << std::setw(4) << i).rdbuf()
+				<< TAB_DELIMITER << sumFitness << "\n";
+			)
+		}
+
+		IF_DEBUG(GAout << std::endl)
+
+		this->fitnessMapSize = i;
+
+		if(this->ctrl.mutationWeighting == MUTATION_FREQUENCY) {
+			for(i = 0; i < this->populationSize; ++i) {
+				this->currentGeneration[i]->addToInclusionCounts(this->inclusionCounts);
+			}
+			this->mutationSampler->setWeights(this->inclusionCounts);
+		}
+
+		this->fitnessHistory.push_back(this->elite.rbegin()->getFitness());
+		this->fitnessHistory.push_back(this->fitStats.mean());
+		this->fitnessHistory.push_back(this->fitStats.stddev());
+
+		return sumFitness;
+	}
+
 protected:
+	/*
+	 * The state of a range of children generated in batches (see `mateBatch`)
+	 */
+	struct ChildBatch {
+		std::vector<bool> open;			// The slot has no accepted child yet
+		std::vector<uint8_t> tries;		// The number of duplicates generated for the slot
+		std::vector<double> cutoffs;	// The minimum fitness of the child in the slot
+		uint32_t discarded;				// The number of discarded children
+
+		ChildBatch(uint16_t numChildren) : open(numChildren, true), tries(numChildren, 0), cutoffs(numChildren, 0.0), discarded(0) {}
+
+		inline bool isComplete() const {
+			return std::find(this->open.begin(), this->open.end(), true) == this->open.end();
+		}
+	};
+
 	inline void initCurrentGeneration(ShuffledSet &shuffledSet, RNG &rng) {
 		for(uint32_t i = this->ctrl.elitism + this->ctrl.populationSize; i > 0; --i) {
 			this->currentGeneration.push_back(new Chromosome(this->ctrl, shuffledSet, rng, false));
 		}
 	}
 
+	/**
+	 * Generate a new child for every open slot of the batch and evaluate all children in locality order
+	 * (see LocalityOrder), so children sharing many variables are evaluated back-to-back.
+	 * Two open slots share the same parents. The children are accepted or discarded by the same rules as
+	 * in the regular mating, discarded children and duplicates are generated anew in the next call.
+	 *
+	 * @param ChVecIt begin The first chromosome of the range of children
+	 * @param ChildBatch batch The state of the range (updated)
+	 * @param double sumFitness The sum of the fitness map of the current generation
+	 * @return The number of evaluations performed
+	 */
+	uint32_t mateBatch(ChVecIt begin, ChildBatch &batch, ::Evaluator &evaluator, RNG &rng, ShuffledSet &shuffledSet, double sumFitness);
+
 	/**
 	 * Update the current generation as well as the fitness map of the current generation
 	 *
@@ -141,7 +321,7 @@ protected:
 		double sumFitness = 0.0, fitt, fitMean, fitSD;
 
 		if (first) {
-			for(; i < this->ctrl.populationSize; ++i) {
+			for(; i < this->populationSize; ++i) {
 				this->fitStats.update(newGeneration[i]->getFitness());
 			}
 		}
@@ -166,7 +346,7 @@ protected:
 		 * neglectable, as the number of chromosomes is usally much greater than
 		 * the number of elite chromosomes
 		 */
-		for(i = 0; i < this->ctrl.populationSize; ++i) {
+		for(i = 0; i < this->populationSize; ++i) {
 			if(updateElite == true) {
 				this->addChromosomeToElite(*newGeneration[i]);
 			}
@@ -186,16 +366,107 @@ protected:
 			)
 		}
 
-		/*
-		 * Add all chromosomes from the elite
-		 */
-		for(SortedChromosomes::iterator eliteIt = this->elite.begin(); eliteIt != this->elite.end(); ++eliteIt, ++i) {
-			*(this->currentGeneration[i]) = *(eliteIt);
+		return this->finishCurrentGeneration(sumFitness, fitMean, fitSD, minFitness);
+	}
 
-			this->fitStats.update(this->currentGeneration[i]->getFitness());
+	/**
+	 * The part of the new generation processed by a single thread (see `updateCurrentGenerationSlice`)
+	 */
+	struct GenerationSlice {
+		uint16_t begin;
+		uint16_t end;
+		double minFitness;
+		OnlineStddev fitStats;
+
+		/* The indices of the chromosomes that may enter the elite */
+		std::vector<uint16_t> eliteCandidates;
+	};
 
-			fitt = (eliteIt->getFitness() - fitMean) / fitSD;
-			sumFitness += (this->*transformFitness)(fitt) - minFitness;
+	/**
+	 * Process the chromosomes [slice.begin, slice.end) of the new generation, i.e., copy them to the
+	 * current generation, store their transformed fitness in the fitness map, accumulate their fitness
+	 * statistics and filter the chromosomes that are good enough to enter the elite.
+	 *
+	 * Disjoint slices can be processed concurrently (the elite and the statistics of the previous
+	 * generation are only read). Afterwards `mergeCurrentGenerationSlices` must be called.
+	 * This can not be used for the initial generation.
+	 */
+	inline void updateCurrentGenerationSlice(const ChVec &newGeneration, GenerationSlice &slice) {
+		const double fitMean = this->fitStats.mean();
+		const double fitSD = this->fitStats.stddev();
+		const bool eliteFull = (this->elite.size() >= this->ctrl.elitism);
+		double fitt;
+
+		slice.minFitness = std::numeric_limits<double>::infinity();
+		slice.fitStats.reset();
+		slice.eliteCandidates.clear();
+
+		for(uint16_t i = slice.begin; i < slice.end; ++i) {
+			const double fitness = newGeneration[i]->getFitness();
+
+			if(fitness < slice.minFitness) {
+				slice.minFitness = fitness;
+			}
+
+			if(this->ctrl.elitism > 0 && (!eliteFull || fitness > this->minEliteFitness)) {
+				slice.eliteCandidates.push_back(i);
+			}
+
+			*(this->currentGeneration[i]) = *(newGeneration[i]);
+
+			slice.fitStats.update(fitness);
+
+			fitt = (fitness - fitMean) / fitSD;
+			this->currentGenFitnessMap[i] = (this->*transformFitness)(fitt);
+		}
+	}
+
+	/**
+	 * Combine the slices (which must cover the whole new generation and be ordered by their begin)
+	 * to finish the update of the current generation, the elite and the fitness map.
+	 *
+	 * The result is the same as from `updateCurrentGeneration(newGeneration, minFitness, false, updateElite)`
+	 * (up to the rounding of the fitness statistics).
+	 */
+	inline double mergeCurrentGenerationSlices(const ChVec &newGeneration, const std::vector<const GenerationSlice*> &slices, bool updateElite) {
+		std::vector<const GenerationSlice*>::const_iterator slice;
+		std::vector<uint16_t>::const_iterator candidate;
+		uint16_t i = 0;
+		double sumFitness = 0.0;
+		double fitMean = this->fitStats.mean();
+		double fitSD = this->fitStats.stddev();
+		double minFitness = std::numeric_limits<double>::infinity();
+
+		this->fitStats.reset();
+
+		for(slice = slices.begin(); slice != slices.end(); ++slice) {
+			if((*slice)->minFitness < minFitness) {
+				minFitness = (*slice)->minFitness;
+			}
+			this->fitStats.merge((*slice)->fitStats);
+		}
+
+		if(this->ctrl.elitism > 0 && this->elite.size() > 0 && minFitness > this->elite.rbegin()->getFitness()) {
+			minFitness = this->elite.rbegin()->getFitness();
+		}
+
+		minFitness = (minFitness - fitMean) / fitSD;
+		minFitness = (this->*transformFitness)(minFitness);
+
+		/* Insert the candidates in the same order as `updateCurrentGeneration` would */
+		if(updateElite == true) {
+			for(slice = slices.begin(); slice != slices.end(); ++slice) {
+				for(candidate = (*slice)->eliteCandidates.begin(); candidate != (*slice)->eliteCandidates.end(); ++candidate) {
+					this->addChromosomeToElite(*newGeneration[*candidate]);
+				}
+			}
+		}
+
+		IF_DEBUG(GAout << "Fitness map:\n")
+
+		/* The map holds the transformed fitness, only the cumulative sum is left to do */
+		for(i = 0; i < this->populationSize; ++i) {
+			sumFitness += this->currentGenFitnessMap[i] - minFitness;
 
 			this->currentGenFitnessMap[i] = sumFitness;
 
@@ -205,22 +476,93 @@ protected:
 			)
 		}
 
-		IF_DEBUG(GAout << std::endl)
+		return this->finishCurrentGeneration(sumFitness, fitMean, fitSD, minFitness);
+	}
+	
+	/**
+	 * Publish the statistics of the current generation to the telemetry file (if any)
+	 * and write the current generation to the snapshot file (if any)
+	 *
+	 * @param uint16_t generation The number of the current generation (0 for the initial generation)
+	 * @param uint64_t numEvaluations The total number of evaluations done so far
+	 * @param double threadUtilization The ratio of time the threads spent working in the last generation
+	 * @param CacheStatistics cacheStats The cache statistics of all evaluators (if NULL, only the population's evaluator)
+	 */
+	inline void publishProgress(uint16_t generation, uint64_t numEvaluations, double threadUtilization = 1.0,
+								const ::Evaluator::CacheStatistics *cacheStats = NULL) {
+		if(this->telemetry && this->fitnessHistory.size() >= 3) {
+			std::vector<double>::const_iterator last = this->fitnessHistory.end();
+			const double cacheHitRate = (cacheStats != NULL) ? cacheStats->hitRate() : this->getCacheStatistics().hitRate();
+			this->telemetry->update(generation, *(last - 3), *(last - 2), *(last - 1), numEvaluations,
+									threadUtilization, cacheHitRate);
+		}
 
-		this->fitnessHistory.push_back(this->elite.rbegin()->getFitness());
-		this->fitnessHistory.push_back(this->fitStats.mean());
-		this->fitnessHistory.push_back(this->fitStats.stddev());
+		if(this->snapshots && generation % this->ctrl.snapshotInterval == 0) {
+			this->snapshots->write(generation, this->currentGeneration.begin(), this->currentGeneration.begin() + this->fitnessMapSize);
+		}
+	}
 
-		return sumFitness;
+	/**
+	 * The current generation is printed if the verbosity is high enough, unless it is written to a snapshot file
+	 */
+	inline bool printsGenerations() const {
+		return this->ctrl.verbosity >= VERBOSE && this->ctrl.verbosity != DEBUG_EVAL && !this->snapshots;
 	}
-	
+
+	/**
+	 * Delete or add chromosomes at the end of the generation so it holds exactly `populationSize` chromosomes
+	 */
+	inline void resizeGeneration(ChVec &generation, ShuffledSet &shuffledSet, RNG &rng) const {
+		while(generation.size() > this->populationSize) {
+			delete generation.back();
+			generation.pop_back();
+		}
+
+		while(generation.size() < this->populationSize) {
+			generation.push_back(new Chromosome(this->ctrl, shuffledSet, rng, false));
+		}
+	}
+
+	/**
+	 * Adapt the number of children of the next generation to the progress of the search.
+	 * If the best fitness improved in the last generation, the population grows (up to
+	 * ctrl.populationSize) to exploit the progress, otherwise it shrinks (down to ctrl.minPopulationSize)
+	 * so no evaluations are wasted on a converged population.
+	 *
+	 * @return true if the size of the population changed
+	 */
+	inline bool adaptPopulationSize() {
+		if(this->ctrl.minPopulationSize >= this->ctrl.populationSize || this->fitnessHistory.size() < 6) {
+			return false;
+		}
+
+		const uint16_t oldSize = this->populationSize;
+		const double best = *(this->fitnessHistory.end() - 3);
+		const double previousBest = *(this->fitnessHistory.end() - 6);
+		double newSize;
+
+		if(best > previousBest) {
+			newSize = std::ceil(this->populationSize * Population::POPULATION_GROWTH_FACTOR);
+		} else {
+			newSize = std::floor(this->populationSize * Population::POPULATION_SHRINK_FACTOR);
+		}
+
+		this->populationSize = (uint16_t) std::max<double>(this->ctrl.minPopulationSize, std::min<double>(this->ctrl.populationSize, newSize));
+
+		if(this->populationSize != oldSize && this->ctrl.verbosity >= ON) {
+			GAout << "Population size: " << this->populationSize << std::endl;
+		}
+
+		return (this->populationSize != oldSize);
+	}
+
 	/**
 	 * Pick a chromosome from the current generation at random
 	 * where the probability to pick a chromosome is taken from
 	 * the currentGenFitnessMap
 	 */
 	inline Chromosome* drawChromosomeFromCurrentGeneration(double rand) const {
-		int imin = 0, imax = static_cast<int>(this->currentGenFitnessMap.size());
+		int imin = 0, imax = static_cast<int>(this->fitnessMapSize);
 		int imid = 0;
 		
 		/*
@@ -263,7 +605,8 @@ protected:
 
 	inline void printCurrentGeneration() {
 		int i = 0;
-		for(ChVecIt it = this->currentGeneration.begin(); it != this->currentGeneration.end(); ++it) {
+		const ChVecIt end = this->currentGeneration.begin() + this->fitnessMapSize;
+		for(ChVecIt it = this->currentGeneration.begin(); it != end; ++it) {
 			GAout << (std::stringstream() << std::fixed << std::setw(4) << i++ << ": ").rdbuf();
 			this->printChromosomeFitness(GAout, **it);
 		}
@@ -0,0 +1,87 @@
+//
+//  RowWeights.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_RowWeights_h
+#define gaselect_RowWeights_h
+
+#include "config.h"
+
+#include <vector>
+#include <stdexcept>
+#include <RcppArmadillo.h>
+
+/**
+ * Integer weights (multiplicities) of the observations, e.g., of a bootstrap resample.
+ *
+ * The weighted observations are represented by a list of row indices where every row is repeated
+ * as often as its weight says, with all copies of a row next to each other. To avoid that copies
+ * of the same observation are used for fitting and for validation, segmentations are built
+ * over the distinct rows and then expanded to the copies.
+ */
+class RowWeights {
+public:
+	RowWeights(const arma::uvec &weights) {
+		arma::uword i, j, k = 0, n = arma::accu(weights);
+
+		if(n == 0) {
+			throw std::invalid_argument("At least one observation must have a positive weight");
+		}
+
+		this->rows.set_size(n);
+		this->offsets.set_size(weights.n_elem - arma::accu(weights == 0));
+		this->distinctWeights.set_size(this->offsets.n_elem);
+		n = 0;
+
+		for(i = 0; i < weights.n_elem; ++i) {
+			if(weights[i] > 0) {
+				this->offsets[k] = n;
+				this->distinctWeights[k++] = weights[i];
+
+				for(j = 0; j < weights[i]; ++j) {
+					this->rows[n++] = i;
+				}
+			}
+		}
+	}
+
+	/**
+	 * The row index of every weighted observation
+	 */
+	const arma::uvec& getRows() const { return this->rows; }
+
+	/**
+	 * The number of rows with a positive weight
+	 */
+	arma::uword getNumDistinct() const { return this->offsets.n_elem; }
+
+	/**
+	 * Replace the indices of the distinct rows in the segmentation by the indices of all
+	 * their copies in the list of weighted observations
+	 */
+	void expandSegmentation(std::vector<arma::uvec> &segmentation) const {
+		arma::uword i, j, n;
+
+		for(std::vector<arma::uvec>::iterator segIt = segmentation.begin(); segIt != segmentation.end(); ++segIt) {
+			arma::uvec expanded(arma::accu(this->distinctWeights.elem(*segIt)));
+			n = 0;
+
+			for(i = 0; i < segIt->n_elem; ++i) {
+				for(j = 0; j < this->distinctWeights[(*segIt)[i]]; ++j) {
+					expanded[n++] = this->offsets[(*segIt)[i]] + j;
+				}
+			}
+
+			*segIt = expanded;
+		}
+	}
+
+private:
+	arma::uvec rows;
+	arma::uvec offsets;
+	arma::uvec distinctWeights;
+};
+
+#endif
@@ -0,0 +1,373 @@
+//
+//  SimdKernels.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <cmath>
+#include <RcppArmadillo.h>
+
+#include "SimdKernels.h"
+
+#if (defined HAVE_X86_SIMD_DISPATCH && (defined __x86_64__ || defined __i386__))
+#define SIMD_KERNELS_X86 1
+#include <immintrin.h>
+#elif (defined __aarch64__ && defined __ARM_NEON)
+#define SIMD_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+/*
+ * Scalar variants (also used for the remainder of the vectorized variants)
+ */
+double sumSquaredDiffScalar(const double *a, const double *b, arma::uword n) {
+	double sum = 0, d;
+	for(arma::uword i = 0; i < n; ++i) {
+		d = a[i] - b[i];
+		sum += d * d;
+	}
+	return sum;
+}
+
+void deflateScalar(double *s, double *v, arma::uword n) {
+	arma::uword i;
+	double dot = 0, norm = 0;
+
+	for (i = 0; i < n; ++i) {
+		norm += v[i] * v[i];
+		dot += v[i] * s[i];
+	}
+
+	dot /= norm;
+	norm = sqrt(norm);
+
+	for (i = 0; i < n; ++i) {
+		s[i] -= v[i] * dot;
+		v[i] /= norm;
+	}
+}
+
+void addScaledScalar(double *out, const double *in, const double *x, double a, arma::uword n) {
+	for(arma::uword i = 0; i < n; ++i) {
+		out[i] = in[i] + x[i] * a;
+	}
+}
+
+#ifdef HAVE_BUILTIN_POPCOUNTLL
+uint32_t popcountScalar(const IntChromosome *parts, uint16_t n) {
+	uint32_t count = 0;
+	for(uint16_t i = 0; i < n; ++i) {
+		count += __builtin_popcountll(parts[i]);
+	}
+	return count;
+}
+#endif
+
+#ifdef SIMD_KERNELS_X86
+/*
+ * SSE4.2 (only the popcnt instruction is used)
+ */
+#ifdef HAVE_BUILTIN_POPCOUNTLL
+__attribute__((target("popcnt")))
+uint32_t popcountPOPCNT(const IntChromosome *parts, uint16_t n) {
+	uint32_t count = 0;
+	for(uint16_t i = 0; i < n; ++i) {
+		count += __builtin_popcountll(parts[i]);
+	}
+	return count;
+}
+#endif
+
+/*
+ * AVX2 with FMA
+ */
+__attribute__((target("avx2,fma")))
+inline double horizontalSumAVX2(__m256d x) {
+	double tmp[4];
+	_mm256_storeu_pd(tmp, x);
+	return (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+}
+
+__attribute__((target("avx2,fma")))
+double sumSquaredDiffAVX2(const double *a, const double *b, arma::uword n) {
+	__m256d acc0 = _mm256_setzero_pd();
+	__m256d acc1 = _mm256_setzero_pd();
+	__m256d d0, d1;
+	arma::uword i = 0;
+
+	for(; i + 8 <= n; i += 8) {
+		d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+		d1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+		acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+		acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+	}
+
+	if(i + 4 <= n) {
+		d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+		acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+		i += 4;
+	}
+
+	return horizontalSumAVX2(_mm256_add_pd(acc0, acc1)) + sumSquaredDiffScalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+void deflateAVX2(double *s, double *v, arma::uword n) {
+	__m256d normAcc = _mm256_setzero_pd();
+	__m256d dotAcc = _mm256_setzero_pd();
+	__m256d vv, dotv, normv;
+	arma::uword i = 0, vecEnd = n - n % 4;
+	double dot, norm;
+
+	for(; i < vecEnd; i += 4) {
+		vv = _mm256_loadu_pd(v + i);
+		normAcc = _mm256_fmadd_pd(vv, vv, normAcc);
+		dotAcc = _mm256_fmadd_pd(vv, _mm256_loadu_pd(s + i), dotAcc);
+	}
+
+	norm = horizontalSumAVX2(normAcc);
+	dot = horizontalSumAVX2(dotAcc);
+
+	for(; i < n; ++i) {
+		norm += v[i] * v[i];
+		dot += v[i] * s[i];
+	}
+
+	dot /= norm;
+	norm = sqrt(norm);
+
+	dotv = _mm256_set1_pd(dot);
+	normv = _mm256_set1_pd(norm);
+
+	for(i = 0; i < vecEnd; i += 4) {
+		vv = _mm256_loadu_pd(v + i);
+		_mm256_storeu_pd(s + i, _mm256_fnmadd_pd(vv, dotv, _mm256_loadu_pd(s + i)));
+		_mm256_storeu_pd(v + i, _mm256_div_pd(vv, normv));
+	}
+
+	for(; i < n; ++i) {
+		s[i] -= v[i] * dot;
+		v[i] /= norm;
+	}
+}
+
+__attribute__((target("avx2,fma")))
+void addScaledAVX2(double *out, const double *in, const double *x, double a, arma::uword n) {
+	const __m256d av = _mm256_set1_pd(a);
+	arma::uword i = 0;
+
+	for(; i + 4 <= n; i += 4) {
+		_mm256_storeu_pd(out + i, _mm256_fmadd_pd(_mm256_loadu_pd(x + i), av, _mm256_loadu_pd(in + i)));
+	}
+
+	addScaledScalar(out + i, in + i, x + i, a, n - i);
+}
+
+/*
+ * AVX-512 (foundation only)
+ */
+__attribute__((target("avx512f")))
+inline double horizontalSumAVX512(__m512d x) {
+	double tmp[8];
+	_mm512_storeu_pd(tmp, x);
+	return ((tmp[0] + tmp[1]) + (tmp[2] + tmp[3])) + ((tmp[4] + tmp[5]) + (tmp[6] + tmp[7]));
+}
+
+__attribute__((target("avx512f")))
+double sumSquaredDiffAVX512(const double *a, const double *b, arma::uword n) {
+	__m512d acc = _mm512_setzero_pd();
+	__m512d d;
+	arma::uword i = 0;
+
+	for(; i + 8 <= n; i += 8) {
+		d = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+		acc = _mm512_fmadd_pd(d, d, acc);
+	}
+
+	return horizontalSumAVX512(acc) + sumSquaredDiffScalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+void deflateAVX512(double *s, double *v, arma::uword n) {
+	__m512d normAcc = _mm512_setzero_pd();
+	__m512d dotAcc = _mm512_setzero_pd();
+	__m512d vv, dotv, normv;
+	arma::uword i = 0, vecEnd = n - n % 8;
+	double dot, norm;
+
+	for(; i < vecEnd; i += 8) {
+		vv = _mm512_loadu_pd(v + i);
+		normAcc = _mm512_fmadd_pd(vv, vv, normAcc);
+		dotAcc = _mm512_fmadd_pd(vv, _mm512_loadu_pd(s + i), dotAcc);
+	}
+
+	norm = horizontalSumAVX512(normAcc);
+	dot = horizontalSumAVX512(dotAcc);
+
+	for(; i < n; ++i) {
+		norm += v[i] * v[i];
+		dot += v[i] * s[i];
+	}
+
+	dot /= norm;
+	norm = sqrt(norm);
+
+	dotv = _mm512_set1_pd(dot);
+	normv = _mm512_set1_pd(norm);
+
+	for(i = 0; i < vecEnd; i += 8) {
+		vv = _mm512_loadu_pd(v + i);
+		_mm512_storeu_pd(s + i, _mm512_fnmadd_pd(vv, dotv, _mm512_loadu_pd(s + i)));
+		_mm512_storeu_pd(v + i, _mm512_div_pd(vv, normv));
+	}
+
+	for(; i < n; ++i) {
+		s[i] -= v[i] * dot;
+		v[i] /= norm;
+	}
+}
+
+__attribute__((target("avx512f")))
+void addScaledAVX512(double *out, const double *in, const double *x, double a, arma::uword n) {
+	const __m512d av = _mm512_set1_pd(a);
+	arma::uword i = 0;
+
+	for(; i + 8 <= n; i += 8) {
+		_mm512_storeu_pd(out + i, _mm512_fmadd_pd(_mm512_loadu_pd(x + i), av, _mm512_loadu_pd(in + i)));
+	}
+
+	addScaledScalar(out + i, in + i, x + i, a, n - i);
+}
+#endif
+
+#ifdef SIMD_KERNELS_NEON
+/*
+ * NEON (always available on AArch64)
+ */
+double sumSquaredDiffNEON(const double *a, const double *b, arma::uword n) {
+	float64x2_t acc0 = vdupq_n_f64(0.0);
+	float64x2_t acc1 = vdupq_n_f64(0.0);
+	float64x2_t d0, d1;
+	arma::uword i = 0;
+
+	for(; i + 4 <= n; i += 4) {
+		d0 = vsubq_f64(vld1q_f64(a + i), vld1q_f64(b + i));
+		d1 = vsubq_f64(vld1q_f64(a + i + 2), vld1q_f64(b + i + 2));
+		acc0 = vfmaq_f64(acc0, d0, d0);
+		acc1 = vfmaq_f64(acc1, d1, d1);
+	}
+
+	return vaddvq_f64(vaddq_f64(acc0, acc1)) + sumSquaredDiffScalar(a + i, b + i, n - i);
+}
+
+void deflateNEON(double *s, double *v, arma::uword n) {
+	float64x2_t normAcc = vdupq_n_f64(0.0);
+	float64x2_t dotAcc = vdupq_n_f64(0.0);
+	float64x2_t vv, dotv, normv;
+	arma::uword i = 0, vecEnd = n - n % 2;
+	double dot, norm;
+
+	for(; i < vecEnd; i += 2) {
+		vv = vld1q_f64(v + i);
+		normAcc = vfmaq_f64(normAcc, vv, vv);
+		dotAcc = vfmaq_f64(dotAcc, vv, vld1q_f64(s + i));
+	}
+
+	norm = vaddvq_f64(normAcc);
+	dot = vaddvq_f64(dotAcc);
+
+	for(; i < n; ++i) {
+		norm += v[i] * v[i];
+		dot += v[i] * s[i];
+	}
+
+	dot /= norm;
+	norm = sqrt(norm);
+
+	dotv = vdupq_n_f64(dot);
+	normv = vdupq_n_f64(norm);
+
+	for(i = 0; i < vecEnd; i += 2) {
+		vv = vld1q_f64(v + i);
+		vst1q_f64(s + i, vfmsq_f64(vld1q_f64(s + i), vv, dotv));
+		vst1q_f64(v + i, vdivq_f64(vv, normv));
+	}
+
+	for(; i < n; ++i) {
+		s[i] -= v[i] * dot;
+		v[i] /= norm;
+	}
+}
+
+void addScaledNEON(double *out, const double *in, const double *x, double a, arma::uword n) {
+	const float64x2_t av = vdupq_n_f64(a);
+	arma::uword i = 0;
+
+	for(; i + 2 <= n; i += 2) {
+		vst1q_f64(out + i, vfmaq_f64(vld1q_f64(in + i), vld1q_f64(x + i), av));
+	}
+
+	addScaledScalar(out + i, in + i, x + i, a, n - i);
+}
+#endif
+}
+
+SimdKernels::Level SimdKernels::level = SimdKernels::SCALAR;
+SimdKernels::SumSquaredDiffFun SimdKernels::sumSquaredDiffFun = &sumSquaredDiffScalar;
+SimdKernels::DeflateFun SimdKernels::deflateFun = &deflateScalar;
+SimdKernels::AddScaledFun SimdKernels::addScaledFun = &addScaledScalar;
+#ifdef HAVE_BUILTIN_POPCOUNTLL
+SimdKernels::PopcountFun SimdKernels::popcountFun = &popcountScalar;
+#else
+SimdKernels::PopcountFun SimdKernels::popcountFun = NULL;
+#endif
+
+void SimdKernels::init() {
+#ifdef SIMD_KERNELS_X86
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("popcnt")) {
+		SimdKernels::level = SimdKernels::SSE42;
+#ifdef HAVE_BUILTIN_POPCOUNTLL
+		SimdKernels::popcountFun = &popcountPOPCNT;
+#endif
+	}
+
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		SimdKernels::level = SimdKernels::AVX2;
+		SimdKernels::sumSquaredDiffFun = &sumSquaredDiffAVX2;
+		SimdKernels::deflateFun = &deflateAVX2;
+		SimdKernels::addScaledFun = &addScaledAVX2;
+	}
+
+	if(__builtin_cpu_supports("avx512f")) {
+		SimdKernels::level = SimdKernels::AVX512;
+		SimdKernels::sumSquaredDiffFun = &sumSquaredDiffAVX512;
+		SimdKernels::deflateFun = &deflateAVX512;
+		SimdKernels::addScaledFun = &addScaledAVX512;
+	}
+#elif (defined SIMD_KERNELS_NEON)
+	SimdKernels::level = SimdKernels::NEON;
+	SimdKernels::sumSquaredDiffFun = &sumSquaredDiffNEON;
+	SimdKernels::deflateFun = &deflateNEON;
+	SimdKernels::addScaledFun = &addScaledNEON;
+#endif
+}
+
+const char* SimdKernels::getLevelName() {
+	switch(SimdKernels::level) {
+		case SimdKernels::NEON:
+			return "NEON";
+		case SimdKernels::SSE42:
+			return "SSE4.2";
+		case SimdKernels::AVX2:
+			return "AVX2";
+		case SimdKernels::AVX512:
+			return "AVX-512";
+		default:
+			return "scalar";
+	}
+}
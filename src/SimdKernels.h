@@ -0,0 +1,89 @@
+//
+//  SimdKernels.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_SimdKernels_h
+#define gaselect_SimdKernels_h
+
+#include "config.h"
+
+#include <RcppArmadillo.h>
+
+/**
+ * Small numerical kernels used in the innermost loops, available in several
+ * variants for different instruction set extensions.
+ *
+ * The variant is selected once when the library is loaded (see `init`) based on the
+ * features of the CPU, so the package can be built for a generic target and still
+ * use wide vector instructions where available. Until `init` is called, the scalar
+ * variants are used.
+ *
+ * Because the vectorized variants sum in a different order, results may differ in the
+ * last bits between machines with different instruction sets.
+ */
+class SimdKernels {
+public:
+	enum Level {
+		SCALAR = 0,
+		NEON,
+		SSE42,
+		AVX2,
+		AVX512
+	};
+
+	/**
+	 * Select the best variant for the current CPU
+	 */
+	static void init();
+
+	static Level getLevel() { return SimdKernels::level; }
+	static const char* getLevelName();
+
+	/**
+	 * sum((a - b)^2)
+	 */
+	static double sumSquaredDiff(const double *a, const double *b, arma::uword n) {
+		return SimdKernels::sumSquaredDiffFun(a, b, n);
+	}
+
+	/**
+	 * Deflate the vector s according to the formula
+	 * v = v / norm(v)
+	 * s = s - v * v.t() * s
+	 */
+	static void deflate(double *s, double *v, arma::uword n) {
+		SimdKernels::deflateFun(s, v, n);
+	}
+
+	/**
+	 * out = in + a * x
+	 */
+	static void addScaled(double *out, const double *in, const double *x, double a, arma::uword n) {
+		SimdKernels::addScaledFun(out, in, x, a, n);
+	}
+
+#ifdef HAVE_BUILTIN_POPCOUNTLL
+	/**
+	 * The total number of set bits in the n integers
+	 */
+	static uint32_t popcount(const IntChromosome *parts, uint16_t n) {
+		return SimdKernels::popcountFun(parts, n);
+	}
+#endif
+
+private:
+	typedef double (*SumSquaredDiffFun)(const double*, const double*, arma::uword);
+	typedef void (*DeflateFun)(double*, double*, arma::uword);
+	typedef void (*AddScaledFun)(double*, const double*, const double*, double, arma::uword);
+	typedef uint32_t (*PopcountFun)(const IntChromosome*, uint16_t);
+
+	static Level level;
+	static SumSquaredDiffFun sumSquaredDiffFun;
+	static DeflateFun deflateFun;
+	static AddScaledFun addScaledFun;
+	static PopcountFun popcountFun;
+};
+
+#endif
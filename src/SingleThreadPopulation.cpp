@@ -37,7 +37,8 @@ inline bool check_interrupt() {
 	return (R_ToplevelExec(check_interrupt_impl, NULL) == FALSE);
 }
 
-SingleThreadPopulation::SingleThreadPopulation(const Control &ctrl, ::Evaluator &evaluator, const std::vector<uint32_t> &seed) : Population(ctrl, evaluator, seed) {}
+SingleThreadPopulation::SingleThreadPopulation(const Control &ctrl, ::Evaluator &evaluator, const std::vector<uint32_t> &seed, bool checkUserInterrupt) :
+	Population(ctrl, evaluator, seed), checkUserInterrupt(checkUserInterrupt) {}
 
 
 void SingleThreadPopulation::run() {
@@ -63,6 +64,7 @@ void SingleThreadPopulation::run() {
 
 	uint32_t discSol1 = 0;
 	uint32_t discSol2 = 0;
+	uint64_t numEvaluations = 0;
 	uint32_t maxDiscardedSolutions = Population::MAX_DISCARDED_SOLUTIONS_RATIO * this->ctrl.populationSize;
 
 	newGeneration.reserve(this->ctrl.populationSize);
@@ -77,6 +79,7 @@ void SingleThreadPopulation::run() {
 		/* Check if chromosome is already in the initial population */
 		if(std::find_if(newGeneration.begin(), newGeneration.end(), CompChromsomePtr(tmpChromosome1)) == newGeneration.end()) {
 			try {
+				++numEvaluations;
 				this->evaluator.evaluate(*tmpChromosome1);
 
 				if(tmpChromosome1->getFitness() < minFitness) {
@@ -96,7 +99,7 @@ void SingleThreadPopulation::run() {
 			delete tmpChromosome1;
 		}
 
-		if(check_interrupt()) {
+		if(this->checkUserInterrupt && check_interrupt()) {
 			this->interrupted = true;
 		}
 	}
@@ -108,8 +111,9 @@ void SingleThreadPopulation::run() {
 	 * and copy old generation to new generation
 	 */
 	sumFitness = this->updateCurrentGeneration(newGeneration, minFitness, true);
+	this->publishProgress(0, numEvaluations);
 
-	if(this->ctrl.verbosity >= VERBOSE && this->ctrl.verbosity != DEBUG_EVAL) {
+	if(this->printsGenerations()) {
 		this->printCurrentGeneration();
 	}
 	
@@ -127,9 +131,11 @@ void SingleThreadPopulation::run() {
 		child1It = newGeneration.begin();
 		child2It = newGeneration.rbegin();
 
+		if(this->ctrl.evaluationOrder == ORDER_LOCALITY) {
+			numEvaluations += this->mateInLocalityOrder(newGeneration, rng, shuffledSet, sumFitness, minFitness);
+		}
 
-
-		while(child1It < child2It.base() && !this->interrupted) {
+		while(this->ctrl.evaluationOrder == ORDER_MATING && child1It < child2It.base() && !this->interrupted) {
 			childrenDifferent = (child1It + 1 != child2It.base());
 
 			tmpChromosome1 = this->drawChromosomeFromCurrentGeneration(rng(0.0, sumFitness));
@@ -141,10 +147,10 @@ void SingleThreadPopulation::run() {
 			
 			minParentFitness = ((tmpChromosome1->getFitness() > tmpChromosome2->getFitness()) ? tmpChromosome1->getFitness() : tmpChromosome2->getFitness());
 
-			(*child1It)->mutate(rng);
+			(*child1It)->mutate(rng, this->mutationSampler.get());
 
 			if (childrenDifferent) {
-				(*child2It)->mutate(rng);
+				(*child2It)->mutate(rng, this->mutationSampler.get());
 			}
 
 			/*
@@ -170,6 +176,7 @@ void SingleThreadPopulation::run() {
 				child1Tries = 0;
 
 				try {
+					++numEvaluations;
 					if((this->evaluator.evaluate(**child1It) > cutoff) || (discSol1 > maxDiscardedSolutions)) {
 						if((*child1It)->getFitness() < minFitness) {
 							minFitness = (*child1It)->getFitness();
@@ -205,6 +212,7 @@ void SingleThreadPopulation::run() {
 				child2Tries = 0;
 
 				try {
+					++numEvaluations;
 					if((this->evaluator.evaluate(**child2It) > cutoff) || (discSol2 > maxDiscardedSolutions)) {
 						if((*child2It)->getFitness() < minFitness) {
 							minFitness = (*child2It)->getFitness();
@@ -228,7 +236,7 @@ void SingleThreadPopulation::run() {
 				}
 			}
 
-			if(check_interrupt()) {
+			if(this->checkUserInterrupt && check_interrupt()) {
 				this->interrupted = true;
 			}
 		}
@@ -238,11 +246,16 @@ void SingleThreadPopulation::run() {
 		 * and copy old generation to new generation
 		 */		
 		sumFitness = this->updateCurrentGeneration(newGeneration, minFitness, false);
+		this->publishProgress(this->ctrl.numGenerations - i + 1, numEvaluations);
 
-		if(this->ctrl.verbosity >= VERBOSE && this->ctrl.verbosity != DEBUG_EVAL) {
+		if(this->printsGenerations()) {
 			this->printCurrentGeneration();
 		}
 
+		if(this->adaptPopulationSize()) {
+			this->resizeGeneration(newGeneration, shuffledSet, rng);
+		}
+
 		discSol1 = 0;
 		discSol2 = 0;
 	}
@@ -251,3 +264,29 @@ void SingleThreadPopulation::run() {
 		delete *it;
 	}
 }
+
+uint32_t SingleThreadPopulation::mateInLocalityOrder(ChVec &newGeneration, RNG &rng, ShuffledSet &shuffledSet, double sumFitness, double &minFitness) {
+	ChildBatch batch(newGeneration.size());
+	uint32_t numEvaluations = 0;
+
+	while(!batch.isComplete() && !this->interrupted) {
+		numEvaluations += this->mateBatch(newGeneration.begin(), batch, this->evaluator, rng, shuffledSet, sumFitness);
+
+		if(this->checkUserInterrupt && check_interrupt()) {
+			this->interrupted = true;
+		}
+	}
+
+	/* Only the accepted children are evaluated if the user interrupted the algorithm */
+	for(size_t i = 0; i < newGeneration.size(); ++i) {
+		if(!batch.open[i]) {
+			if(newGeneration[i]->getFitness() < minFitness) {
+				minFitness = newGeneration[i]->getFitness();
+			}
+
+			this->addChromosomeToElite(*newGeneration[i]);
+		}
+	}
+
+	return numEvaluations;
+}
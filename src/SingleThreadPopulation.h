@@ -18,11 +18,24 @@
 
 class SingleThreadPopulation : public Population {
 public:
-	SingleThreadPopulation(const Control &ctrl, ::Evaluator &evaluator, const std::vector<uint32_t> &seed);
+	/**
+	 * @param checkUserInterrupt If false, the population does not check for user interrupts.
+	 *			This must be used if the population is not run in the main R thread.
+	 */
+	SingleThreadPopulation(const Control &ctrl, ::Evaluator &evaluator, const std::vector<uint32_t> &seed, bool checkUserInterrupt = true);
 	~SingleThreadPopulation() {};
 
 	void run();
 private:
+	const bool checkUserInterrupt;
+
+	/**
+	 * Generate all children of the new generation in batches evaluated in locality order
+	 *
+	 * @param double minFitness Is updated with the minimum fitness of the children
+	 * @return The number of evaluations performed
+	 */
+	uint32_t mateInLocalityOrder(ChVec &newGeneration, RNG &rng, ShuffledSet &shuffledSet, double sumFitness, double &minFitness);
 };
 
 
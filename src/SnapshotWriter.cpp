@@ -0,0 +1,163 @@
+//
+//  SnapshotWriter.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <RcppArmadillo.h>
+
+#include "Logger.h"
+#include "SnapshotWriter.h"
+
+SnapshotWriter::SnapshotWriter(const std::string &path, const Control &ctrl) :
+	path(path), rowBytes((ctrl.chromosomeSize + BITS_PER_BYTE - 1) / BITS_PER_BYTE), file(NULL), failed(false)
+#ifdef HAVE_PTHREAD_H
+	, writerRunning(false), finished(false)
+#endif
+{
+	std::vector<char> header;
+	std::vector<uint16_t>::const_iterator it;
+
+	this->file = fopen(path.c_str(), "wb");
+
+	if(this->file == NULL) {
+		GAerr << "Warning: Snapshot file '" << path << "' could not be opened -- no snapshots are written" << std::endl;
+		return;
+	}
+
+	header.insert(header.end(), "GASNAP01", "GASNAP01" + 8);
+	SnapshotWriter::append(header, SnapshotWriter::VERSION);
+	SnapshotWriter::append(header, (int32_t) ctrl.chromosomeSize);
+	SnapshotWriter::append(header, (int32_t) ctrl.numColumns);
+	SnapshotWriter::append(header, (int32_t) ctrl.freeColumns.size());
+	SnapshotWriter::append(header, (int32_t) ctrl.forcedColumns.size());
+
+	for(it = ctrl.freeColumns.begin(); it != ctrl.freeColumns.end(); ++it) {
+		SnapshotWriter::append(header, (int32_t) *it);
+	}
+
+	for(it = ctrl.forcedColumns.begin(); it != ctrl.forcedColumns.end(); ++it) {
+		SnapshotWriter::append(header, (int32_t) *it);
+	}
+
+	this->writeBuffer(header);
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_init(&this->mutex, NULL);
+	pthread_cond_init(&this->changed, NULL);
+
+	/* Without the background thread, the snapshots are written by the calling thread */
+	this->writerRunning = (pthread_create(&this->writerThread, NULL, &SnapshotWriter::writerThreadStart, (void*) this) == 0);
+#endif
+}
+
+SnapshotWriter::~SnapshotWriter() {
+	if(this->file == NULL) {
+		return;
+	}
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&this->mutex);
+	this->finished = true;
+	pthread_cond_broadcast(&this->changed);
+	pthread_mutex_unlock(&this->mutex);
+
+	if(this->writerRunning) {
+		pthread_join(this->writerThread, NULL);
+	}
+
+	pthread_cond_destroy(&this->changed);
+	pthread_mutex_destroy(&this->mutex);
+#endif
+
+	if(fclose(this->file) != 0) {
+		this->failed = true;
+	}
+
+	if(this->failed) {
+		GAerr << "Warning: Snapshot file '" << this->path << "' could not be written completely" << std::endl;
+	}
+}
+
+void SnapshotWriter::write(uint16_t generation, std::vector<Chromosome*>::const_iterator begin, std::vector<Chromosome*>::const_iterator end) {
+	if(this->file == NULL) {
+		return;
+	}
+
+	const size_t numChromosomes = end - begin;
+	std::vector<char> buffer;
+	std::vector<Chromosome*>::const_iterator it;
+
+	buffer.reserve(2 * sizeof(int32_t) + numChromosomes * (sizeof(double) + this->rowBytes));
+
+	SnapshotWriter::append(buffer, (int32_t) generation);
+	SnapshotWriter::append(buffer, (int32_t) numChromosomes);
+
+	for(it = begin; it != end; ++it) {
+		SnapshotWriter::append(buffer, (*it)->getFitness());
+	}
+
+	const size_t bitsOffset = buffer.size();
+	buffer.resize(bitsOffset + numChromosomes * this->rowBytes, 0);
+
+	for(it = begin; it != end; ++it) {
+		(*it)->packBits(reinterpret_cast<uint8_t*>(&buffer[bitsOffset + (it - begin) * this->rowBytes]));
+	}
+
+#ifdef HAVE_PTHREAD_H
+	if(this->writerRunning) {
+		pthread_mutex_lock(&this->mutex);
+		while(this->pending.size() >= SnapshotWriter::MAX_PENDING) {
+			pthread_cond_wait(&this->changed, &this->mutex);
+		}
+		this->pending.push_back(std::vector<char>());
+		this->pending.back().swap(buffer);
+		pthread_cond_broadcast(&this->changed);
+		pthread_mutex_unlock(&this->mutex);
+		return;
+	}
+#endif
+
+	this->writeBuffer(buffer);
+}
+
+void SnapshotWriter::writeBuffer(const std::vector<char> &buffer) {
+	if(!this->failed && fwrite(&buffer[0], 1, buffer.size(), this->file) != buffer.size()) {
+		this->failed = true;
+	}
+}
+
+#ifdef HAVE_PTHREAD_H
+void* SnapshotWriter::writerThreadStart(void *obj) {
+	SnapshotWriter *writer = static_cast<SnapshotWriter*>(obj);
+	std::vector<char> buffer;
+
+	pthread_mutex_lock(&writer->mutex);
+	while(true) {
+		while(writer->pending.empty() && !writer->finished) {
+			pthread_cond_wait(&writer->changed, &writer->mutex);
+		}
+
+		if(writer->pending.empty()) {
+			break;
+		}
+
+		buffer.swap(writer->pending.front());
+		writer->pending.pop_front();
+		pthread_cond_broadcast(&writer->changed);
+
+		/* The file is only accessed by this thread while it is running */
+		pthread_mutex_unlock(&writer->mutex);
+		writer->writeBuffer(buffer);
+		pthread_mutex_lock(&writer->mutex);
+	}
+	pthread_mutex_unlock(&writer->mutex);
+
+	return NULL;
+}
+#endif
@@ -0,0 +1,91 @@
+//
+//  SnapshotWriter.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_SnapshotWriter_h
+#define gaselect_SnapshotWriter_h
+
+#include "config.h"
+
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "Control.h"
+#include "Chromosome.h"
+
+/**
+ * Write the chromosomes and their fitness to a binary snapshot file, to be read by `readSnapshots` in R.
+ *
+ * All numbers are stored in the native byte order. The file starts with the header
+ *		char magic[8] ("GASNAP01"), int32 version, int32 chromosomeSize, int32 numColumns,
+ *		int32 numFree, int32 numForced, int32 freeColumns[numFree], int32 forcedColumns[numForced]
+ * followed by one record per snapshot
+ *		int32 generation, int32 numChromosomes, double fitness[numChromosomes],
+ *		uint8 bits[numChromosomes][(chromosomeSize + 7) / 8]
+ * where bit i (least significant bit first) of a row is variable i of the chromosome.
+ *
+ * The snapshot is copied into a buffer by the calling thread and written to the file by a background
+ * thread (if threads are available), so the algorithm only waits if the disk can not keep up.
+ */
+class SnapshotWriter {
+public:
+	static const int32_t VERSION = 1;
+
+	/**
+	 * If the file can not be opened, a warning is issued and no snapshots are written
+	 */
+	SnapshotWriter(const std::string &path, const Control &ctrl);
+
+	/**
+	 * Write all pending snapshots and close the file
+	 */
+	~SnapshotWriter();
+
+	/**
+	 * Write a snapshot of the given chromosomes
+	 */
+	void write(uint16_t generation, std::vector<Chromosome*>::const_iterator begin, std::vector<Chromosome*>::const_iterator end);
+
+private:
+	/* The number of snapshots waiting to be written before `write` blocks */
+	static const size_t MAX_PENDING = 4;
+
+	const std::string path;
+	const size_t rowBytes;
+	FILE *file;
+	bool failed;
+
+#ifdef HAVE_PTHREAD_H
+	std::deque<std::vector<char> > pending;
+	pthread_t writerThread;
+	pthread_mutex_t mutex;
+	pthread_cond_t changed;
+	bool writerRunning;
+	bool finished;
+
+	static void* writerThreadStart(void *obj);
+#endif
+
+	/**
+	 * Write the buffer to the file (only called by a single thread)
+	 */
+	void writeBuffer(const std::vector<char> &buffer);
+
+	template<class T> static void append(std::vector<char> &buffer, const T &value) {
+		const char *bytes = reinterpret_cast<const char*>(&value);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	SnapshotWriter(const SnapshotWriter&);
+	SnapshotWriter& operator=(const SnapshotWriter&);
+};
+
+#endif
@@ -0,0 +1,133 @@
+//
+//  StabilitySelection.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <RcppArmadillo.h>
+
+#include "Population.h"
+#include "StabilitySelection.h"
+
+StabilitySelection::StabilitySelection(const Control &ctrl, const ::Evaluator &evaluator, const std::vector<double> &variableWeights,
+									   uint16_t numThreads) :
+	ParallelReplicates(ctrl, numThreads), evaluator(evaluator), variableWeights(variableWeights)
+{
+}
+
+void StabilitySelection::run(uint32_t numResamples, arma::uword numObservations, bool replace, RNG &rng) {
+	uint32_t i, j;
+	arma::uword k, l;
+	const arma::uword subsampleSize = (numObservations < 2) ? numObservations : numObservations / 2;
+	std::vector<arma::uword> shuffled(numObservations);
+
+	/*
+	 * Draw all resamples and seeds up front in the main thread, so the
+	 * result does not depend on the order in which the threads process the replicates
+	 */
+	this->replicates.resize(numResamples);
+
+	for(i = 0; i < numResamples; ++i) {
+		Replicate &rep = this->replicates[i];
+		rep.rowWeights.zeros(numObservations);
+		rep.finished = false;
+
+		if(replace == true) {
+			for(k = 0; k < numObservations; ++k) {
+				l = (arma::uword) rng(0.0, (double) numObservations);
+				if(l >= numObservations) {
+					l = numObservations - 1;
+				}
+				++rep.rowWeights[l];
+			}
+		} else {
+			/* Partial Fisher-Yates shuffle */
+			for(k = 0; k < numObservations; ++k) {
+				shuffled[k] = k;
+			}
+
+			for(k = 0; k < subsampleSize; ++k) {
+				l = k + (arma::uword) rng(0.0, (double) (numObservations - k));
+				if(l >= numObservations) {
+					l = numObservations - 1;
+				}
+				std::swap(shuffled[k], shuffled[l]);
+				rep.rowWeights[shuffled[k]] = 1;
+			}
+		}
+
+		rep.seed.reserve(RNG::SEED_SIZE);
+		for(j = 0; j < RNG::SEED_SIZE; ++j) {
+			rep.seed.push_back(rng());
+		}
+	}
+
+	this->runReplicates(numResamples);
+}
+
+arma::vec StabilitySelection::getSelectionFrequencies() const {
+	arma::vec frequencies(this->ctrl.numColumns);
+	arma::uword numFinished = 0;
+
+	frequencies.zeros();
+
+	for(std::vector<Replicate>::const_iterator it = this->replicates.begin(); it != this->replicates.end(); ++it) {
+		if(it->finished == true) {
+			++numFinished;
+			for(arma::uword j = 0; j < it->bestSubset.n_elem; ++j) {
+				frequencies[it->bestSubset[j]] += 1.0;
+			}
+		}
+	}
+
+	if(numFinished > 0) {
+		frequencies /= (double) numFinished;
+	}
+
+	return frequencies;
+}
+
+std::vector<arma::uvec> StabilitySelection::getSubsets() const {
+	std::vector<arma::uvec> subsets;
+	subsets.reserve(this->replicates.size());
+
+	for(std::vector<Replicate>::const_iterator it = this->replicates.begin(); it != this->replicates.end(); ++it) {
+		if(it->finished == true) {
+			subsets.push_back(it->bestSubset);
+		}
+	}
+
+	return subsets;
+}
+
+bool StabilitySelection::runReplicate(uint32_t index, bool checkUserInterrupt) {
+	Replicate &replicate = this->replicates[index];
+	std::unique_ptr<::Evaluator> eval(this->evaluator.cloneWithRowWeights(replicate.rowWeights, replicate.seed));
+	std::unique_ptr<Population> pop = this->createPopulation(*eval, replicate.seed, checkUserInterrupt);
+
+	if(!this->variableWeights.empty()) {
+		pop->setVariableWeights(this->variableWeights);
+	}
+
+	pop->run();
+
+	if(pop->wasInterrupted()) {
+		return false;
+	}
+
+	Population::SortedChromosomes result = pop->getResult();
+
+	if(!result.empty()) {
+		replicate.bestSubset = result.rbegin()->toColumnSubset();
+	}
+
+	/* The replicate is only complete once the best subset is stored */
+	replicate.finished = true;
+
+	return true;
+}
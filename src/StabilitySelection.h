@@ -0,0 +1,75 @@
+//
+//  StabilitySelection.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_StabilitySelection_h
+#define gaselect_StabilitySelection_h
+
+#include "config.h"
+
+#include <vector>
+#include <RcppArmadillo.h>
+
+#include "Control.h"
+#include "Evaluator.h"
+#include "RNG.h"
+#include "ParallelReplicates.h"
+
+/**
+ * Run the genetic algorithm on a number of resamples of the observations and count how
+ * often every variable is part of the best subset.
+ *
+ * The resamples are not copies of the data but integer weights of the observations that
+ * are handed to the evaluator (see Evaluator::cloneWithRowWeights), i.e., all replicates
+ * work on the same X matrix.
+ */
+class StabilitySelection : public ParallelReplicates {
+public:
+	/**
+	 * @param ctrl The control object for the GA
+	 * @param evaluator The evaluator for the full data
+	 * @param variableWeights The weights for weighted mutation (ignored if empty)
+	 * @param numThreads The number of threads to use (including the main thread)
+	 */
+	StabilitySelection(const Control &ctrl, const ::Evaluator &evaluator, const std::vector<double> &variableWeights,
+					   uint16_t numThreads);
+
+	/**
+	 * Run the GA for `numResamples` resamples of the `numObservations` observations.
+	 *
+	 * @param replace If true, the resamples are bootstrap samples (drawn with replacement),
+	 *			otherwise they are subsamples of half the observations (drawn without replacement)
+	 * @param rng The RNG used to draw the resamples and the seeds of the replicates
+	 */
+	void run(uint32_t numResamples, arma::uword numObservations, bool replace, RNG &rng);
+
+	/**
+	 * The relative frequency every variable was selected with, among all finished resamples
+	 */
+	arma::vec getSelectionFrequencies() const;
+
+	/**
+	 * The best subset of every finished resample
+	 */
+	std::vector<arma::uvec> getSubsets() const;
+
+protected:
+	bool runReplicate(uint32_t index, bool checkUserInterrupt);
+
+private:
+	struct Replicate {
+		arma::uvec rowWeights;
+		std::vector<uint32_t> seed;
+		arma::uvec bestSubset;
+		bool finished;
+	};
+
+	const ::Evaluator &evaluator;
+	const std::vector<double> &variableWeights;
+
+	std::vector<Replicate> replicates;
+};
+
+#endif
@@ -0,0 +1,134 @@
+//
+//  Telemetry.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <atomic>
+#include <new>
+#include <cstring>
+#include <limits>
+#include <RcppArmadillo.h>
+
+#include "Logger.h"
+#include "Telemetry.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+Telemetry::Telemetry(const std::string &path, uint16_t numGenerations, uint16_t numThreads) :
+	record(NULL), fd(-1), lastEvaluations(0) {
+	this->startTime = this->lastUpdate = std::chrono::steady_clock::now();
+
+#ifdef HAVE_SYS_MMAN_H
+	this->fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if(this->fd < 0) {
+		GAerr << "Warning: Telemetry file '" << path << "' could not be opened -- telemetry is disabled" << std::endl;
+		return;
+	}
+
+	if(ftruncate(this->fd, sizeof(Telemetry::Record)) != 0) {
+		GAerr << "Warning: Telemetry file '" << path << "' could not be resized -- telemetry is disabled" << std::endl;
+		close(this->fd);
+		this->fd = -1;
+		return;
+	}
+
+	void* mapped = mmap(NULL, sizeof(Telemetry::Record), PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+
+	if(mapped == MAP_FAILED) {
+		GAerr << "Warning: Telemetry file '" << path << "' could not be mapped into memory -- telemetry is disabled" << std::endl;
+		close(this->fd);
+		this->fd = -1;
+		return;
+	}
+
+	/* All fields (including the sequence number) start at 0 */
+	this->record = new (mapped) Telemetry::Record();
+
+	std::memcpy(this->record->magic, "GASTAT01", sizeof(this->record->magic));
+	this->record->version = Telemetry::VERSION;
+	this->record->state = RUNNING;
+	this->record->pid = (uint32_t) getpid();
+	this->record->numGenerations = numGenerations;
+	this->record->numThreads = numThreads;
+	this->record->bestFitness = this->record->meanFitness = this->record->stddevFitness = std::numeric_limits<double>::quiet_NaN();
+	this->record->cacheHitRate = std::numeric_limits<double>::quiet_NaN();
+#else
+	GAerr << "Warning: Telemetry files are not supported on this system" << std::endl;
+#endif
+}
+
+Telemetry::~Telemetry() {
+#ifdef HAVE_SYS_MMAN_H
+	if(this->record != NULL) {
+		msync(this->record, sizeof(Telemetry::Record), MS_ASYNC);
+		munmap(this->record, sizeof(Telemetry::Record));
+	}
+	if(this->fd >= 0) {
+		close(this->fd);
+	}
+#endif
+}
+
+/**
+ * Sequence lock: the sequence number is odd while the record is inconsistent.
+ * There is only one writer, so no read-modify-write atomics are necessary.
+ * The odd sequence number must be visible before any of the fields change (hence the
+ * fence after storing it) and the even one only after all fields are written.
+ */
+inline void Telemetry::beginWrite() {
+	const uint32_t sequence = this->record->sequence.load(std::memory_order_relaxed);
+	this->record->sequence.store(sequence + 1, std::memory_order_release);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+inline void Telemetry::endWrite() {
+	const uint32_t sequence = this->record->sequence.load(std::memory_order_relaxed);
+	this->record->sequence.store(sequence + 1, std::memory_order_release);
+}
+
+void Telemetry::update(uint16_t generation, double bestFitness, double meanFitness, double stddevFitness,
+					   uint64_t evaluations, double threadUtilization, double cacheHitRate) {
+	if(this->record == NULL) {
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double sinceLast = std::chrono::duration<double>(now - this->lastUpdate).count();
+
+	this->beginWrite();
+
+	this->record->generation = generation;
+	this->record->evaluations = (double) evaluations;
+	this->record->bestFitness = bestFitness;
+	this->record->meanFitness = meanFitness;
+	this->record->stddevFitness = stddevFitness;
+	this->record->elapsedSeconds = std::chrono::duration<double>(now - this->startTime).count();
+	this->record->evaluationsPerSecond = (sinceLast > 0) ? (evaluations - this->lastEvaluations) / sinceLast : 0.0;
+	this->record->threadUtilization = threadUtilization;
+	this->record->cacheHitRate = cacheHitRate;
+
+	this->endWrite();
+
+	this->lastEvaluations = evaluations;
+	this->lastUpdate = now;
+}
+
+void Telemetry::finish(bool interrupted) {
+	if(this->record == NULL) {
+		return;
+	}
+
+	this->beginWrite();
+	this->record->state = (interrupted ? INTERRUPTED : FINISHED);
+	this->record->elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->startTime).count();
+	this->endWrite();
+}
@@ -0,0 +1,90 @@
+//
+//  Telemetry.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_Telemetry_h
+#define gaselect_Telemetry_h
+
+#include "config.h"
+
+#include <string>
+#include <chrono>
+#include <atomic>
+
+/**
+ * Publish the progress of a run into a small memory-mapped file which can
+ * be polled by other processes (e.g., a job scheduler) while the GA is running.
+ *
+ * The file holds exactly one `Telemetry::Record`. The record is written
+ * by a single thread (the main thread) and protected by a sequence lock:
+ * the writer increments `sequence` before and after updating the fields,
+ * so a reader has a consistent snapshot if it reads the same *even* sequence
+ * number before and after copying the record. The sequence number is a lock-free
+ * atomic, which has the same layout as a plain uint32_t.
+ * All values are stored in the native byte order of the machine running the GA.
+ */
+class Telemetry {
+public:
+	enum State {
+		RUNNING = 0,
+		FINISHED = 1,
+		INTERRUPTED = 2
+	};
+
+	struct Record {
+		char magic[8];				// "GASTAT01"
+		uint32_t version;
+		std::atomic<uint32_t> sequence;	// odd while the record is being updated
+		uint32_t state;				// see Telemetry::State
+		uint32_t pid;
+		uint32_t generation;		// 0 is the initial generation
+		uint32_t numGenerations;
+		uint32_t numThreads;
+		uint32_t reserved;
+		double evaluations;			// total number of evaluated subsets so far
+		double bestFitness;
+		double meanFitness;
+		double stddevFitness;
+		double elapsedSeconds;
+		double evaluationsPerSecond;	// over the last generation
+		double cacheHitRate;		// NaN if the evaluator does not use a cache
+		double threadUtilization;	// ratio of busy time to wall time over the last generation
+	};
+
+	static const uint32_t VERSION = 1;
+
+	static_assert(ATOMIC_INT_LOCK_FREE == 2 && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+				  "The sequence number must be a lock-free atomic with the size of a uint32_t");
+
+	/**
+	 * Create (or truncate) the file at `path` and map it into memory.
+	 * If the file can not be mapped, a warning is printed and all further
+	 * calls are no-ops.
+	 */
+	Telemetry(const std::string &path, uint16_t numGenerations, uint16_t numThreads);
+	~Telemetry();
+
+	void update(uint16_t generation, double bestFitness, double meanFitness, double stddevFitness,
+				uint64_t evaluations, double threadUtilization, double cacheHitRate);
+
+	void finish(bool interrupted);
+
+	bool isActive() const { return this->record != NULL; }
+
+private:
+	Record* record;
+	int fd;
+	uint64_t lastEvaluations;
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point lastUpdate;
+
+	inline void beginWrite();
+	inline void endWrite();
+
+	Telemetry(const Telemetry&);
+	Telemetry& operator=(const Telemetry&);
+};
+
+#endif
@@ -0,0 +1,185 @@
+//
+//  ThreadTuner.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#ifdef HAVE_PTHREAD_H
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <pthread.h>
+
+#include "RNG.h"
+#include "ShuffledSet.h"
+#include "ThreadTuner.h"
+
+const double ThreadTuner::MIN_RELATIVE_GAIN = 0.05;
+
+std::map<uint64_t, ThreadTuner::Decision> ThreadTuner::decisions;
+
+ThreadTuner::ThreadTuner(const Control &ctrl, ::Evaluator &evaluator, uint64_t fingerprint) :
+	ctrl(ctrl), evaluator(evaluator), dataFingerprint(fingerprint), cached(false)
+{
+}
+
+uint64_t ThreadTuner::fingerprint(const void *data, size_t bytes, uint64_t hash) {
+	const unsigned char *it = static_cast<const unsigned char*>(data);
+	const unsigned char *end = it + bytes;
+
+	for(; it != end; ++it) {
+		hash ^= *it;
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+uint16_t ThreadTuner::tune(uint16_t maxThreads, const std::vector<uint32_t> &seed) {
+	const uint64_t key = ThreadTuner::fingerprint(&maxThreads, sizeof(maxThreads), this->dataFingerprint);
+	std::map<uint64_t, Decision>::const_iterator known = ThreadTuner::decisions.find(key);
+	Decision decision;
+	uint16_t numThreads;
+	double bestThroughput = 0.0;
+
+	this->trials.clear();
+
+	if(known != ThreadTuner::decisions.end()) {
+		this->cached = true;
+		this->trials = known->second.trials;
+		return known->second.numThreads;
+	}
+
+	this->cached = false;
+
+	if(maxThreads <= 1) {
+		return 1;
+	}
+
+	/*
+	 * Draw the sample
+	 */
+	RNG rng(seed);
+	ShuffledSet shuffledSet(this->ctrl.chromosomeSize);
+	std::vector<Chromosome*> sample;
+	size_t sampleSize = std::max<size_t>(MIN_CHROMOSOMES_PER_THREAD * maxThreads,
+										 std::min<size_t>(this->ctrl.populationSize, MAX_SAMPLE_SIZE));
+
+	sample.reserve(sampleSize);
+	for(; sampleSize > 0; --sampleSize) {
+		sample.push_back(new Chromosome(this->ctrl, shuffledSet, rng));
+	}
+
+	/* Warm up the caches (and the lazily initialized parts of the evaluator) */
+	ThreadArgs warmup;
+	warmup.evaluator = &this->evaluator;
+	warmup.begin = sample.begin();
+	warmup.end = sample.begin() + std::min<size_t>(MIN_CHROMOSOMES_PER_THREAD, sample.size());
+	ThreadTuner::evaluateRange(warmup);
+
+	/*
+	 * Try 1, 2, 4, ... threads and the maximum
+	 */
+	decision.numThreads = 1;
+	numThreads = 1;
+
+	while(true) {
+		Trial trial;
+		trial.numThreads = numThreads;
+		trial.throughput = this->measure(numThreads, sample);
+		this->trials.push_back(trial);
+
+		if(trial.throughput > bestThroughput) {
+			bestThroughput = trial.throughput;
+		}
+
+		if(numThreads == maxThreads) {
+			break;
+		}
+		numThreads = std::min<uint32_t>(2 * numThreads, maxThreads);
+	}
+
+	/*
+	 * Use the smallest number of threads that is within MIN_RELATIVE_GAIN of the
+	 * highest throughput (the trials are ordered by the number of threads)
+	 */
+	for(std::vector<Trial>::const_iterator it = this->trials.begin(); it != this->trials.end(); ++it) {
+		if(it->throughput >= (1.0 - MIN_RELATIVE_GAIN) * bestThroughput) {
+			decision.numThreads = it->numThreads;
+			break;
+		}
+	}
+
+	for(std::vector<Chromosome*>::iterator it = sample.begin(); it != sample.end(); ++it) {
+		delete *it;
+	}
+
+	decision.trials = this->trials;
+	ThreadTuner::decisions[key] = decision;
+
+	return decision.numThreads;
+}
+
+double ThreadTuner::measure(uint16_t numThreads, const std::vector<Chromosome*> &sample) const {
+	std::vector<std::unique_ptr<::Evaluator> > clones(numThreads - 1);
+	std::vector<ThreadArgs> args(numThreads);
+	std::vector<pthread_t> threads(numThreads - 1);
+	std::vector<bool> spawned(numThreads - 1, false);
+	const size_t perThread = sample.size() / numThreads;
+	uint16_t t;
+
+	/* The clones are created before the clock starts, as in the genetic algorithm */
+	for(t = 0; t < numThreads; ++t) {
+		if(t + 1 < numThreads) {
+			clones[t].reset(this->evaluator.clone());
+			args[t].evaluator = clones[t].get();
+		} else {
+			args[t].evaluator = &this->evaluator;
+		}
+		args[t].begin = sample.begin() + t * perThread;
+		args[t].end = (t + 1 < numThreads) ? args[t].begin + perThread : sample.end();
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for(t = 0; t + 1 < numThreads; ++t) {
+		spawned[t] = (pthread_create(&threads[t], NULL, &ThreadTuner::evaluateThreadStart, (void *) &args[t]) == 0);
+		if(!spawned[t]) {
+			ThreadTuner::evaluateRange(args[t]);
+		}
+	}
+
+	ThreadTuner::evaluateRange(args[numThreads - 1]);
+
+	for(t = 0; t + 1 < numThreads; ++t) {
+		if(spawned[t]) {
+			pthread_join(threads[t], NULL);
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	return (seconds > 0) ? sample.size() / seconds : 0.0;
+}
+
+void* ThreadTuner::evaluateThreadStart(void *args) {
+	ThreadTuner::evaluateRange(*static_cast<ThreadArgs*>(args));
+	return NULL;
+}
+
+void ThreadTuner::evaluateRange(const ThreadArgs &args) {
+	for(std::vector<Chromosome*>::const_iterator it = args.begin; it != args.end; ++it) {
+		try {
+			args.evaluator->evaluate(**it);
+		} catch(const std::exception &e) {
+			/* Failed evaluations take time as well, but they do not matter here (and must not leave the thread) */
+		}
+	}
+}
+
+#endif
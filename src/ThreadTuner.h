@@ -0,0 +1,111 @@
+//
+//  ThreadTuner.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_ThreadTuner_h
+#define gaselect_ThreadTuner_h
+
+#include "config.h"
+
+#ifdef HAVE_PTHREAD_H
+
+#include <vector>
+#include <map>
+
+#include "Chromosome.h"
+#include "Evaluator.h"
+#include "Control.h"
+
+/**
+ * Choose the number of threads for the genetic algorithm by measuring the throughput
+ * (evaluations per second) of the evaluator.
+ *
+ * A sample of random chromosomes (like the ones of the initial generation) is evaluated
+ * with 1, 2, 4, ... and the maximum number of threads. Every thread evaluates its own part
+ * of the sample with its own clone of the evaluator, just like the threads of the
+ * MultiThreadedPopulation do. After all numbers of threads are measured, the smallest
+ * number of threads whose throughput is within MIN_RELATIVE_GAIN of the highest throughput
+ * is chosen, because more threads only compete for the memory bandwidth and BLAS threads.
+ *
+ * The decision is remembered for the rest of the R session, keyed by a fingerprint of the
+ * data and the evaluator settings, so repeated runs do not have to tune again.
+ */
+class ThreadTuner {
+public:
+	struct Trial {
+		uint16_t numThreads;
+		double throughput;		// Evaluations per second
+	};
+
+	static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+	/**
+	 * @param ctrl The control object used to generate the sample chromosomes
+	 * @param evaluator The evaluator (it is cloned for every thread)
+	 * @param fingerprint Identifies the data and the evaluator settings (see `fingerprint`)
+	 */
+	ThreadTuner(const Control &ctrl, ::Evaluator &evaluator, uint64_t fingerprint);
+
+	/**
+	 * Get the best number of threads (between 1 and maxThreads)
+	 */
+	uint16_t tune(uint16_t maxThreads, const std::vector<uint32_t> &seed);
+
+	/**
+	 * The measured throughput for every number of threads that was tried
+	 */
+	const std::vector<Trial>& getTrials() const { return this->trials; }
+
+	/**
+	 * True if the decision was taken from an earlier run
+	 */
+	bool isCached() const { return this->cached; }
+
+	/**
+	 * Update the FNV-1a hash with the given bytes
+	 */
+	static uint64_t fingerprint(const void *data, size_t bytes, uint64_t hash = FNV_OFFSET_BASIS);
+
+private:
+	static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+	/* The sample has at least this many chromosomes per thread */
+	static const uint16_t MIN_CHROMOSOMES_PER_THREAD = 8;
+	static const uint16_t MAX_SAMPLE_SIZE = 256;
+
+	/* Fewer threads are chosen if they are at most this much slower than the fastest */
+	static const double MIN_RELATIVE_GAIN;
+
+	struct Decision {
+		uint16_t numThreads;
+		std::vector<Trial> trials;
+	};
+
+	struct ThreadArgs {
+		::Evaluator *evaluator;
+		std::vector<Chromosome*>::const_iterator begin;
+		std::vector<Chromosome*>::const_iterator end;
+	};
+
+	static std::map<uint64_t, Decision> decisions;
+
+	const Control &ctrl;
+	::Evaluator &evaluator;
+	const uint64_t dataFingerprint;
+	std::vector<Trial> trials;
+	bool cached;
+
+	/**
+	 * Evaluate all chromosomes in the sample with the given number of threads and
+	 * return the throughput
+	 */
+	double measure(uint16_t numThreads, const std::vector<Chromosome*> &sample) const;
+
+	static void* evaluateThreadStart(void *args);
+	static void evaluateRange(const ThreadArgs &args);
+};
+
+#endif
+#endif
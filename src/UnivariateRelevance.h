@@ -0,0 +1,60 @@
+//
+//  UnivariateRelevance.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_UnivariateRelevance_h
+#define gaselect_UnivariateRelevance_h
+
+#include "config.h"
+
+#include <vector>
+#include <cmath>
+#include <RcppArmadillo.h>
+
+/**
+ * Compute the absolute correlation of every column of X with a response.
+ * The column statistics only depend on X and are computed once, so the relevance
+ * for many different responses (e.g., permuted responses) only costs a single
+ * matrix-vector product.
+ */
+class UnivariateRelevance {
+public:
+	UnivariateRelevance(const arma::mat &X) : X(X), Xmean(arma::mean(X, 0)), Xnorm(X.n_cols) {
+		for(arma::uword j = 0; j < X.n_cols; ++j) {
+			this->Xnorm[j] = arma::norm(X.col(j) - this->Xmean[j], 2);
+		}
+	}
+
+	/**
+	 * Columns with zero variance (or a constant response) get a relevance of 0.
+	 */
+	std::vector<double> operator()(const arma::vec &y) const {
+		std::vector<double> relevance(this->X.n_cols, 0.0);
+		const double ymean = arma::mean(y);
+		const double yNorm = arma::norm(y - ymean, 2);
+
+		if(yNorm == 0.0) {
+			return relevance;
+		}
+
+		/* X_c' y_c = X' y_c, because y_c sums to 0 */
+		const arma::rowvec cov = (y - ymean).t() * this->X;
+
+		for(arma::uword j = 0; j < this->X.n_cols; ++j) {
+			if(this->Xnorm[j] > 0.0) {
+				relevance[j] = std::abs(cov[j]) / (this->Xnorm[j] * yNorm);
+			}
+		}
+
+		return relevance;
+	}
+
+private:
+	const arma::mat &X;
+	const arma::rowvec Xmean;
+	arma::vec Xnorm;
+};
+
+#endif
@@ -22,13 +22,14 @@ double UserFunEvaluator::evaluate(Chromosome &ch) {
 }
 
 double UserFunEvaluator::evaluate(arma::uvec &columnSubset) {
-	Rcpp::LogicalVector logVec(columnSubset.n_elem, false);
+	/* The (1-based) column indices select the same columns as the logical vector of a chromosome */
+	Rcpp::IntegerVector varSubset(columnSubset.n_elem);
 
 	for(arma::uword i = 0; i < columnSubset.n_elem; ++i) {
-		logVec[columnSubset[i]] = true;
+		varSubset[i] = columnSubset[i] + 1;
 	}
 	
-	SEXP rawFitness = this->userFun(Rcpp::wrap(logVec));
+	SEXP rawFitness = this->userFun(varSubset);
 	if(!Rf_isNumeric(rawFitness)) {
 		throw Evaluator::EvaluatorException("The evaluation function did not return a numeric value.");
 	}
@@ -0,0 +1,419 @@
+//
+//  UserFunWorkerEvaluator.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#ifdef HAVE_USER_FUN_WORKERS
+
+#include <cmath>
+#include <ctime>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <algorithm>
+#include <fcntl.h>
+#include <spawn.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "Logger.h"
+#include "UserFunWorkerEvaluator.h"
+
+extern char **environ;
+
+UserFunWorkerPool::UserFunWorkerPool(const std::string &command, const std::string &workerDir, arma::uword numColumns, uint16_t maxWorkers) :
+	command(command), workerDir(workerDir), numColumns(numColumns), bytesPerSubset((numColumns + BITS_PER_BYTE - 1) / BITS_PER_BYTE),
+	maxWorkers(std::max<uint16_t>(maxWorkers, 1)), numStarted(0), failed(false)
+{
+	pthread_mutex_init(&this->mutex, NULL);
+}
+
+UserFunWorkerPool::~UserFunWorkerPool() {
+	for(std::vector<Worker*>::iterator it = this->workers.begin(); it != this->workers.end(); ++it) {
+		this->terminate(*it, true);
+		delete *it;
+	}
+
+	pthread_mutex_destroy(&this->mutex);
+}
+
+UserFunWorkerPool::Worker* UserFunWorkerPool::acquire() {
+	Worker *worker = NULL;
+
+	pthread_mutex_lock(&this->mutex);
+	if(!this->idle.empty()) {
+		worker = this->idle.back();
+		this->idle.pop_back();
+	}
+	pthread_mutex_unlock(&this->mutex);
+
+	if(worker == NULL) {
+		/* Starting a worker takes a while, so the other threads are not blocked meanwhile */
+		worker = this->start();
+
+		pthread_mutex_lock(&this->mutex);
+		this->workers.push_back(worker);
+		pthread_mutex_unlock(&this->mutex);
+	}
+
+	return worker;
+}
+
+void UserFunWorkerPool::release(Worker *worker) {
+	pthread_mutex_lock(&this->mutex);
+	this->idle.push_back(worker);
+	pthread_mutex_unlock(&this->mutex);
+}
+
+void UserFunWorkerPool::discard(Worker *worker) {
+	pthread_mutex_lock(&this->mutex);
+	this->workers.erase(std::remove(this->workers.begin(), this->workers.end(), worker), this->workers.end());
+	pthread_mutex_unlock(&this->mutex);
+
+	this->terminate(worker, false);
+	delete worker;
+}
+
+void UserFunWorkerPool::fail(const std::string &message) {
+	bool first = false;
+
+	pthread_mutex_lock(&this->mutex);
+	if(!this->failed) {
+		this->error = message;
+		this->failed = true;
+		first = true;
+	}
+	pthread_mutex_unlock(&this->mutex);
+
+	/* Otherwise the search would silently go on with a fitness of -Inf for every subset */
+	if(first) {
+		GAerr << GAerr.lock() << "Warning: The R workers evaluating the user supplied function failed (" << message
+			<< "). All further subsets get a fitness of -Inf.\n" << GAerr.unlock();
+	}
+}
+
+std::string UserFunWorkerPool::getError() {
+	pthread_mutex_lock(&this->mutex);
+	std::string message(this->error);
+	pthread_mutex_unlock(&this->mutex);
+	return message;
+}
+
+void UserFunWorkerPool::pack(const arma::uvec &columnSubset, std::vector<unsigned char> &buffer) const {
+	const size_t offset = buffer.size();
+
+	buffer.resize(offset + this->bytesPerSubset, 0);
+	for(arma::uword i = 0; i < columnSubset.n_elem; ++i) {
+		buffer[offset + (columnSubset[i] / BITS_PER_BYTE)] |= (unsigned char) (1 << (columnSubset[i] % BITS_PER_BYTE));
+	}
+}
+
+void UserFunWorkerPool::send(Worker *worker, const std::vector<unsigned char> &packedSubsets, uint32_t numSubsets) {
+	UserFunWorkerPool::writeAll(worker->toWorker, &numSubsets, sizeof(numSubsets));
+	UserFunWorkerPool::writeAll(worker->toWorker, packedSubsets.data(), packedSubsets.size());
+}
+
+void UserFunWorkerPool::receive(Worker *worker, double *fitness, uint32_t numSubsets) {
+	UserFunWorkerPool::readAll(worker->fromWorker, fitness, numSubsets * sizeof(double));
+}
+
+UserFunWorkerPool::Worker* UserFunWorkerPool::start() {
+	std::ostringstream prefix;
+	prefix << this->workerDir << "/worker" << this->numStarted++;
+
+	std::unique_ptr<Worker> worker(new Worker());
+	worker->pid = -1;
+	worker->toWorker = -1;
+	worker->fromWorker = -1;
+	worker->fifoPrefix = prefix.str();
+
+	const std::string dataFile = this->workerDir + "/data.rds";
+	const std::string inPath = worker->fifoPrefix + ".in";
+	const std::string outPath = worker->fifoPrefix + ".out";
+
+	if(mkfifo(inPath.c_str(), S_IRUSR | S_IWUSR) != 0 || mkfifo(outPath.c_str(), S_IRUSR | S_IWUSR) != 0) {
+		std::string reason(strerror(errno));
+		this->terminate(worker.get(), false);
+		throw WorkerError("Could not create the FIFOs for the R worker process: " + reason);
+	}
+
+	/* Rscript passes the arguments after the expression on to commandArgs(trailingOnly = TRUE) */
+	const char* argv[] = {
+		this->command.c_str(), "-e", "gaselect:::runUserFunctionWorker()",
+		dataFile.c_str(), inPath.c_str(), outPath.c_str(), NULL
+	};
+
+	int spawnError = posix_spawn(&worker->pid, this->command.c_str(), NULL, NULL, const_cast<char* const*>(argv), environ);
+	if(spawnError != 0) {
+		worker->pid = -1;
+		this->terminate(worker.get(), false);
+		throw WorkerError("Could not start the R worker process: " + std::string(strerror(spawnError)));
+	}
+
+	/*
+	 * Opening the FIFO for writing fails until the worker opened it for reading. Meanwhile it is
+	 * checked if the worker is still alive.
+	 */
+	const time_t started = time(NULL);
+	while((worker->toWorker = open(inPath.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC)) < 0) {
+		int status;
+
+		if(errno != ENXIO && errno != EINTR) {
+			std::string reason(strerror(errno));
+			this->terminate(worker.get(), false);
+			throw WorkerError("Could not connect to the R worker process: " + reason);
+		}
+
+		if(waitpid(worker->pid, &status, WNOHANG) == worker->pid) {
+			worker->pid = -1;
+			this->terminate(worker.get(), false);
+			throw WorkerError("The R worker process terminated during startup (is gaselect installed for Rscript?)");
+		}
+
+		if(time(NULL) - started > STARTUP_TIMEOUT) {
+			this->terminate(worker.get(), false);
+			throw WorkerError("The R worker process did not start in time");
+		}
+
+		usleep(STARTUP_POLL_INTERVAL);
+	}
+
+	fcntl(worker->toWorker, F_SETFL, fcntl(worker->toWorker, F_GETFL) & ~O_NONBLOCK);
+
+	/* The worker opens its end for writing right after the other FIFO */
+	worker->fromWorker = open(outPath.c_str(), O_RDONLY | O_CLOEXEC);
+
+	/* The worker answers with the number of columns once the data is loaded */
+	int32_t workerColumns = 0;
+	try {
+		if(worker->fromWorker < 0) {
+			throw WorkerError("Could not connect to the R worker process: " + std::string(strerror(errno)));
+		}
+
+		UserFunWorkerPool::readAll(worker->fromWorker, &workerColumns, sizeof(workerColumns));
+
+		if(workerColumns < 0 || (arma::uword) workerColumns != this->numColumns) {
+			throw WorkerError("The R worker process loaded data with a different number of variables");
+		}
+	} catch(const WorkerError &we) {
+		this->terminate(worker.get(), false);
+		throw;
+	}
+
+	return worker.release();
+}
+
+void UserFunWorkerPool::terminate(Worker *worker, bool graceful) {
+	if(worker->toWorker >= 0) {
+		if(graceful) {
+			uint32_t stop = 0;
+			try {
+				UserFunWorkerPool::writeAll(worker->toWorker, &stop, sizeof(stop));
+			} catch(const WorkerError &we) {
+				/* The worker is already gone */
+			}
+		}
+		close(worker->toWorker);
+		worker->toWorker = -1;
+	}
+
+	if(worker->fromWorker >= 0) {
+		close(worker->fromWorker);
+		worker->fromWorker = -1;
+	}
+
+	if(worker->pid > 0) {
+		/* A worker which is not terminated gracefully may be stuck in the user function */
+		if(!graceful) {
+			kill(worker->pid, SIGTERM);
+		}
+
+		const time_t stopped = time(NULL);
+		while(waitpid(worker->pid, NULL, WNOHANG) == 0) {
+			if(time(NULL) - stopped > STARTUP_TIMEOUT) {
+				kill(worker->pid, SIGKILL);
+				waitpid(worker->pid, NULL, 0);
+				break;
+			}
+			usleep(STARTUP_POLL_INTERVAL);
+		}
+		worker->pid = -1;
+	}
+
+	unlink((worker->fifoPrefix + ".in").c_str());
+	unlink((worker->fifoPrefix + ".out").c_str());
+}
+
+void UserFunWorkerPool::writeAll(int fd, const void *data, size_t bytes) {
+	const char *it = static_cast<const char*>(data);
+	sigset_t pipeSignal, oldMask, pending;
+	int error = 0;
+
+	/* A terminated worker must not raise SIGPIPE (R would handle it on an arbitrary thread) */
+	sigemptyset(&pipeSignal);
+	sigaddset(&pipeSignal, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &pipeSignal, &oldMask);
+
+	while(bytes > 0) {
+		ssize_t written = write(fd, it, bytes);
+		if(written < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			error = errno;
+			break;
+		}
+		it += written;
+		bytes -= written;
+	}
+
+	if(error == EPIPE && sigpending(&pending) == 0 && sigismember(&pending, SIGPIPE)) {
+		int signal;
+		sigwait(&pipeSignal, &signal);
+	}
+	pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
+	if(error != 0) {
+		throw WorkerError("The R worker process does not accept requests: " + std::string(strerror(error)));
+	}
+}
+
+void UserFunWorkerPool::readAll(int fd, void *data, size_t bytes) {
+	char *it = static_cast<char*>(data);
+
+	while(bytes > 0) {
+		ssize_t received = read(fd, it, bytes);
+		if(received < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			throw WorkerError("Could not read the answer of the R worker process: " + std::string(strerror(errno)));
+		} else if(received == 0) {
+			throw WorkerError("The R worker process terminated unexpectedly");
+		}
+		it += received;
+		bytes -= received;
+	}
+}
+
+UserFunWorkerEvaluator::~UserFunWorkerEvaluator() {
+	if(this->worker != NULL) {
+		this->pool->release(this->worker);
+	}
+}
+
+double UserFunWorkerEvaluator::evaluate(arma::uvec &columnSubset) {
+	double fitness = std::numeric_limits<double>::quiet_NaN();
+
+	if(this->pool->hasFailed()) {
+		return -std::numeric_limits<double>::infinity();
+	}
+
+	this->buffer.clear();
+	this->pool->pack(columnSubset, this->buffer);
+
+	/* A worker which terminated unexpectedly is restarted once */
+	for(int attempt = 0; ; ++attempt) {
+		try {
+			if(this->worker == NULL) {
+				this->worker = this->pool->acquire();
+			}
+
+			this->pool->send(this->worker, this->buffer, 1);
+			this->pool->receive(this->worker, &fitness, 1);
+			break;
+		} catch(const UserFunWorkerPool::WorkerError &we) {
+			if(this->worker != NULL) {
+				this->pool->discard(this->worker);
+				this->worker = NULL;
+			}
+
+			if(attempt > 0) {
+				this->pool->fail(we.what());
+				return -std::numeric_limits<double>::infinity();
+			}
+		}
+	}
+
+	if(std::isnan(fitness)) {
+		throw Evaluator::EvaluatorException("The evaluation function did not return a numeric value.");
+	}
+
+	return fitness;
+}
+
+void UserFunWorkerEvaluator::evaluateBatch(const std::vector<arma::uvec> &columnSubsets, std::vector<double> &fitness) {
+	const size_t numSubsets = columnSubsets.size();
+	std::vector<UserFunWorkerPool::Worker*> workers;
+
+	fitness.assign(numSubsets, std::numeric_limits<double>::quiet_NaN());
+
+	if(numSubsets == 0) {
+		return;
+	}
+
+	if(this->pool->hasFailed()) {
+		fitness.assign(numSubsets, -std::numeric_limits<double>::infinity());
+		return;
+	}
+
+	const size_t perWorker = (numSubsets + this->pool->getMaxWorkers() - 1) / this->pool->getMaxWorkers();
+	const size_t numWorkers = (numSubsets + perWorker - 1) / perWorker;
+
+	/* Like a single evaluation, the batch is retried once with new workers */
+	for(int attempt = 0; ; ++attempt) {
+		try {
+			if(this->worker == NULL) {
+				this->worker = this->pool->acquire();
+			}
+
+			workers.push_back(this->worker);
+			while(workers.size() < numWorkers) {
+				workers.push_back(this->pool->acquire());
+			}
+
+			/* All workers get their part before the first answer is read */
+			for(size_t w = 0; w < numWorkers; ++w) {
+				const size_t end = std::min(numSubsets, (w + 1) * perWorker);
+
+				this->buffer.clear();
+				for(size_t i = w * perWorker; i < end; ++i) {
+					this->pool->pack(columnSubsets[i], this->buffer);
+				}
+
+				this->pool->send(workers[w], this->buffer, (uint32_t) (end - w * perWorker));
+			}
+
+			for(size_t w = 0; w < numWorkers; ++w) {
+				const size_t end = std::min(numSubsets, (w + 1) * perWorker);
+				this->pool->receive(workers[w], &fitness[w * perWorker], (uint32_t) (end - w * perWorker));
+			}
+			break;
+		} catch(const UserFunWorkerPool::WorkerError &we) {
+			/* The state of the other workers is unknown */
+			for(std::vector<UserFunWorkerPool::Worker*>::iterator it = workers.begin(); it != workers.end(); ++it) {
+				this->pool->discard(*it);
+			}
+			workers.clear();
+			this->worker = NULL;
+
+			if(attempt > 0) {
+				this->pool->fail(we.what());
+				fitness.assign(numSubsets, -std::numeric_limits<double>::infinity());
+				return;
+			}
+		}
+	}
+
+	for(size_t w = 1; w < workers.size(); ++w) {
+		this->pool->release(workers[w]);
+	}
+}
+
+#endif
@@ -0,0 +1,170 @@
+//
+//  UserFunWorkerEvaluator.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_UserFunWorkerEvaluator_h
+#define gaselect_UserFunWorkerEvaluator_h
+
+#include "config.h"
+
+#ifdef HAVE_USER_FUN_WORKERS
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+#include <pthread.h>
+#include <sys/types.h>
+#include <RcppArmadillo.h>
+
+#include "Evaluator.h"
+#include "Chromosome.h"
+
+/**
+ * Pool of R processes evaluating a user supplied R function.
+ *
+ * Every worker runs `gaselect:::runUserFunctionWorker()` (see R/userFunctionWorker.R), which loads the
+ * function and the data once from the data file and then answers requests over a pair of FIFOs.
+ * A request is the number of subsets (uint32_t) followed by the subsets packed into bits (the same
+ * layout as `packBits`, ceiling(numColumns / 8) bytes per subset), the answer is the fitness
+ * (double) of every subset. A request for 0 subsets terminates the worker.
+ *
+ * Workers are started on demand and reused after they are released. All workers are terminated
+ * when the pool is destroyed.
+ */
+class UserFunWorkerPool {
+public:
+	class WorkerError : public std::runtime_error {
+	public:
+		WorkerError(const std::string &what) : std::runtime_error(what) {};
+		virtual ~WorkerError() throw() {};
+	};
+
+	struct Worker {
+		pid_t pid;
+		int toWorker;
+		int fromWorker;
+		std::string fifoPrefix;
+	};
+
+	/**
+	 * @param command The path to Rscript
+	 * @param workerDir The directory with the data file (`data.rds`), where the FIFOs are created
+	 * @param numColumns The number of columns of the data
+	 * @param maxWorkers The number of workers a batch is split up to
+	 */
+	UserFunWorkerPool(const std::string &command, const std::string &workerDir, arma::uword numColumns, uint16_t maxWorkers);
+	~UserFunWorkerPool();
+
+	/**
+	 * Get an idle worker or start a new one
+	 *
+	 * @throws WorkerError if the worker could not be started
+	 */
+	Worker* acquire();
+
+	/**
+	 * Return a worker to the pool
+	 */
+	void release(Worker *worker);
+
+	/**
+	 * Terminate a worker which did not answer properly
+	 */
+	void discard(Worker *worker);
+
+	/**
+	 * Send the packed subsets to the worker (without waiting for the answer)
+	 */
+	void send(Worker *worker, const std::vector<unsigned char> &packedSubsets, uint32_t numSubsets);
+
+	/**
+	 * Wait for the fitness of the subsets sent before
+	 */
+	void receive(Worker *worker, double *fitness, uint32_t numSubsets);
+
+	/**
+	 * Pack the subset into bits and append it to the buffer
+	 */
+	void pack(const arma::uvec &columnSubset, std::vector<unsigned char> &buffer) const;
+
+	uint16_t getMaxWorkers() const { return this->maxWorkers; }
+
+	/**
+	 * Mark the pool as failed: the workers could not be restarted. A warning is printed the first time.
+	 */
+	void fail(const std::string &message);
+	bool hasFailed() const { return this->failed; }
+	std::string getError();
+
+private:
+	static const int STARTUP_TIMEOUT = 120; // seconds
+	static const unsigned int STARTUP_POLL_INTERVAL = 10000; // microseconds
+
+	const std::string command;
+	const std::string workerDir;
+	const arma::uword numColumns;
+	const size_t bytesPerSubset;
+	const uint16_t maxWorkers;
+
+	pthread_mutex_t mutex;
+	std::vector<Worker*> workers;
+	std::vector<Worker*> idle;
+	std::atomic<uint32_t> numStarted;
+	std::atomic<bool> failed;
+	std::string error;
+
+	Worker* start();
+	void terminate(Worker *worker, bool graceful);
+
+	static void writeAll(int fd, const void *data, size_t bytes);
+	static void readAll(int fd, void *data, size_t bytes);
+};
+
+/**
+ * Evaluator sending the variable subsets to R worker processes, so that an R function can be used
+ * with several threads. Every clone holds its own worker while it is evaluating, all clones share
+ * the pool.
+ *
+ * If a worker terminates unexpectedly, it is restarted once (for a batch, all its workers are). If
+ * this fails as well, the pool is marked as failed (with a warning) and all subsets get a fitness of
+ * -Inf (exceptions can not leave the threads), which should be checked with `hasFailed` after the search.
+ */
+class UserFunWorkerEvaluator : public Evaluator {
+public:
+	UserFunWorkerEvaluator(std::shared_ptr<UserFunWorkerPool> pool, const VerbosityLevel &verbosity) :
+		Evaluator(verbosity), pool(pool), worker(NULL) {}
+	~UserFunWorkerEvaluator();
+
+	double evaluate(Chromosome &ch) {
+		arma::uvec columnSubset = ch.toColumnSubset();
+		double fitness = this->evaluate(columnSubset);
+		ch.setFitness(fitness);
+		return fitness;
+	};
+
+	double evaluate(arma::uvec &columnSubset);
+
+	/**
+	 * The batch is split among up to `maxWorkers` workers, which evaluate their parts concurrently.
+	 */
+	void evaluateBatch(const std::vector<arma::uvec> &columnSubsets, std::vector<double> &fitness);
+
+	Evaluator* clone() const {
+		return new UserFunWorkerEvaluator(this->pool, this->verbosity);
+	}
+
+	bool hasFailed() const { return this->pool->hasFailed(); }
+	std::string getError() const { return this->pool->getError(); }
+
+private:
+	std::shared_ptr<UserFunWorkerPool> pool;
+	UserFunWorkerPool::Worker *worker;
+	std::vector<unsigned char> buffer;
+};
+
+#endif
+#endif
@@ -0,0 +1,93 @@
+//
+//  WeightedSampler.cpp
+//  gaselect
+//
+//
+
+#include "config.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "WeightedSampler.h"
+
+const double WeightedSampler::MIN_RELATIVE_WEIGHT = 0.01;
+
+void WeightedSampler::setWeights(const std::vector<double> &weights) {
+	const uint16_t n = weights.size();
+	double sum = 0.0, minWeight;
+	uint16_t i;
+
+	if(n == 0) {
+		throw std::invalid_argument("At least one weight is required for weighted sampling");
+	}
+
+	for(i = 0; i < n; ++i) {
+		if(weights[i] < 0.0 || !std::isfinite(weights[i])) {
+			throw std::invalid_argument("The weights must be finite and non-negative");
+		}
+		sum += weights[i];
+	}
+
+	/* If all weights are 0, every index is equally likely */
+	minWeight = (sum > 0.0) ? WeightedSampler::MIN_RELATIVE_WEIGHT * sum / n : 1.0;
+
+	this->weights.resize(n);
+	sum = 0.0;
+
+	for(i = 0; i < n; ++i) {
+		this->weights[i] = std::max(weights[i], minWeight);
+		sum += this->weights[i];
+	}
+
+	/*
+	 * Split the (scaled) probabilities in the ones that are smaller than 1 and the ones
+	 * that are larger than 1 and fill up the small ones with the large ones
+	 */
+	std::vector<uint16_t> small, large;
+	std::vector<double> scaled(n);
+
+	this->prob.resize(n);
+	this->alias.resize(n);
+	small.reserve(n);
+	large.reserve(n);
+
+	for(i = 0; i < n; ++i) {
+		this->weights[i] /= sum;
+		scaled[i] = this->weights[i] * n;
+
+		if(scaled[i] < 1.0) {
+			small.push_back(i);
+		} else {
+			large.push_back(i);
+		}
+	}
+
+	while(!small.empty() && !large.empty()) {
+		uint16_t s = small.back(), l = large.back();
+		small.pop_back();
+
+		this->prob[s] = scaled[s];
+		this->alias[s] = l;
+
+		scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+
+		if(scaled[l] < 1.0) {
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+
+	/* The remaining ones are 1 (up to numerical inaccuracies) */
+	for(std::vector<uint16_t>::iterator it = large.begin(); it != large.end(); ++it) {
+		this->prob[*it] = 1.0;
+		this->alias[*it] = *it;
+	}
+
+	for(std::vector<uint16_t>::iterator it = small.begin(); it != small.end(); ++it) {
+		this->prob[*it] = 1.0;
+		this->alias[*it] = *it;
+	}
+}
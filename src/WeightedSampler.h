@@ -0,0 +1,67 @@
+//
+//  WeightedSampler.h
+//  gaselect
+//
+//
+
+#ifndef gaselect_WeightedSampler_h
+#define gaselect_WeightedSampler_h
+
+#include "config.h"
+
+#include <vector>
+
+#include "RNG.h"
+
+/**
+ * Draw variable indices with probability proportional to a weight
+ * in O(1) using Walker's alias method (with Vose's construction).
+ *
+ * To keep the search explorative, every variable gets at least a weight of
+ * MIN_RELATIVE_WEIGHT times the mean weight.
+ */
+class WeightedSampler {
+public:
+	WeightedSampler(const std::vector<double> &weights) {
+		this->setWeights(weights);
+	}
+
+	/**
+	 * Rebuild the alias table for the given weights (O(p))
+	 */
+	void setWeights(const std::vector<double> &weights);
+
+	/**
+	 * Draw a single index
+	 */
+	uint16_t operator()(RNG &rng) const {
+		double u = rng(0.0, (double) this->prob.size());
+		uint16_t i = (uint16_t) u;
+
+		if(i >= this->prob.size()) {
+			i = this->prob.size() - 1;
+		}
+
+		return ((u - i) < this->prob[i]) ? i : this->alias[i];
+	}
+
+	/**
+	 * The normalized weight (i.e., the probability) of index i
+	 */
+	double getWeight(uint16_t i) const {
+		return this->weights[i];
+	}
+
+	uint16_t size() const {
+		return this->weights.size();
+	}
+
+private:
+	static const double MIN_RELATIVE_WEIGHT;
+
+	std::vector<double> weights;
+	std::vector<double> prob;
+	std::vector<uint16_t> alias;
+};
+
+#endif
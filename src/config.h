@@ -54,6 +54,11 @@
 #undef HAVE_PTHREAD_H
 #endif
 
+// Evaluating R functions in worker processes needs threads and posix_spawn
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_SPAWN_H)
+#define HAVE_USER_FUN_WORKERS 1
+#endif
+
 #ifndef ENABLE_DEBUG_VERBOSITY
 #define ARMA_DONT_PRINT_RUNTIME_ERRORS 1
 #define ARMA_DONT_PRINT_ERRORS 1